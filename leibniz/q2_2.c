@@ -2,42 +2,445 @@
  * @file q2_2.c
  * @brief Calcula uma aproximação de Pi usando a fórmula de Leibniz com paralelismo de threads.
  *
- * Este programa divide o cálculo da série de Leibniz em várias threads para
- * acelerar o processamento. Cada thread calcula uma parte da série, e os
- * resultados parciais são somados de forma segura usando um mutex para produzir
- * a aproximação final de Pi. O tempo de execução de cada thread e o tempo total
- * são medidos e exibidos.
+ * Este programa divide o cálculo da série de Leibniz em blocos (chunks) de tamanho fixo
+ * que são distribuídos dinamicamente entre várias threads. Cada thread retira o próximo
+ * bloco livre de um contador atômico, calcula sua soma parcial e publica o resultado na
+ * tabela de blocos, sem usar locks. A aproximação final de Pi é a soma, em ordem de índice,
+ * de todos os blocos concluídos.
+ *
+ * Opcionalmente (modo streaming), uma thread relatora lê a tabela de blocos em intervalos
+ * configuráveis e emite a estimativa corrente de Pi, o limite de erro dado pelo critério
+ * de séries alternadas e a vazão em termos por segundo. Quando uma tolerância é informada,
+ * o cálculo é interrompido assim que o limite de erro fica abaixo dela.
+ *
+ * Para execuções longas, uma thread de checkpoint grava periodicamente em um arquivo binário
+ * quais blocos já foram concluídos e suas somas parciais. Com a opção de retomada, esses
+ * blocos são carregados do arquivo e pulados pelas threads, de modo que uma execução
+ * interrompida (por exemplo, por SIGTERM) continua de onde parou.
+ *
+ * O cálculo também pode ser distribuído entre processos e máquinas: um coordenador
+ * mantém a tabela de blocos e entrega blocos, por TCP ou por socket Unix, a processos
+ * trabalhadores, que os calculam com suas próprias threads e devolvem as somas parciais.
+ * Blocos de trabalhadores que caem ou excedem o prazo voltam para a fila.
+ *
+ * No modo reprodutível, cada termo é convertido para ponto fixo de 128 bits (120 bits
+ * fracionários) por divisão inteira exata e as somas são feitas com aritmética inteira.
+ * Como a adição inteira é associativa, o resultado é idêntico bit a bit para qualquer
+ * número de threads, tamanho de bloco, ordem de conclusão, compilador ou máquina.
+ *
+ * Além do kernel de referência `partialFormula`, o programa traz variantes do kernel
+ * especializadas em tempo de compilação (por macro) no fator de desenrolamento, no número
+ * de acumuladores e na precisão (float, double, long double e __float128). Um
+ * auto-ajuste opcional mede as variantes da precisão escolhida na própria máquina e usa
+ * a mais rápida no cálculo.
+ *
+ * Há ainda variantes que trocam a divisão de cada termo por uma estimativa vetorial do
+ * recíproco (`rcpps`, ou `vrcp14pd` com AVX-512) refinada por passos de Newton-Raphson,
+ * em três modos de precisão. A opção de verificação compara essas variantes com a
+ * divisão exata e falha se o erro ultrapassar o limite de cada modo.
+ *
+ * O tempo de execução de cada thread e o tempo total são medidos e exibidos.
  */
 
-#define _POSIX_C_SOURCE 199309L
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <pthread.h>
 #include <stdlib.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <string.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <errno.h>
+#include <endian.h>
+#include <netdb.h>
+#include <poll.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/un.h>
 #include <sys/time.h>
 #include <time.h>
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
 
 /**
  * @def SIZE
- * @brief O número total de termos a serem calculados na série de Leibniz.
+ * @brief O número padrão de termos a serem calculados na série de Leibniz.
  */
-#define SIZE 2000000000
+#define SIZE 2000000000LL
 
+/**
+ * @def NUM_THREADS
+ * @brief O número padrão de threads de cálculo.
+ */
 #define NUM_THREADS 8
 
-#define PARTIAL_NUM_TERMS ((SIZE) / (NUM_THREADS))
+/**
+ * @def ARENA_ALIGN
+ * @brief Alinhamento e granularidade da arena dos identificadores de thread (`run_arena`).
+ */
+#define ARENA_ALIGN 64
+
+/**
+ * @def CHUNK_TERMS
+ * @brief O número padrão de termos em cada bloco distribuído às threads.
+ *
+ * Blocos menores deixam a estimativa do modo streaming mais atualizada e balanceiam
+ * melhor a carga; blocos maiores reduzem o custo de coordenação.
+ */
+#define CHUNK_TERMS 1000000LL
+
+/**
+ * @def REPORT_INTERVAL
+ * @brief Intervalo padrão, em segundos, entre dois relatórios de progresso.
+ */
+#define REPORT_INTERVAL 1.0
+
+/**
+ * @def CHECKPOINT_INTERVAL
+ * @brief Intervalo padrão, em segundos, entre dois checkpoints.
+ */
+#define CHECKPOINT_INTERVAL 30.0
+
+/**
+ * @def CHECKPOINT_MAGIC
+ * @brief Assinatura gravada no início de todo arquivo de checkpoint.
+ */
+#define CHECKPOINT_MAGIC "LEIBCKP1"
+
+/**
+ * @def WIRE_MESSAGE_SIZE
+ * @brief Tamanho fixo, em bytes, de cada mensagem trocada entre coordenador e trabalhadores.
+ */
+#define WIRE_MESSAGE_SIZE 48
+
+/**
+ * @def AUTOTUNE_TERMS
+ * @brief Número de termos usados para medir cada variante do kernel no auto-ajuste.
+ */
+#define AUTOTUNE_TERMS 2000000LL
+
+/**
+ * @def AUTOTUNE_REPETITIONS
+ * @brief Quantas vezes cada variante é medida no auto-ajuste; vale a menor medida.
+ */
+#define AUTOTUNE_REPETITIONS 3
+
+/**
+ * @def RCP_CHECK_TERMS
+ * @brief Termos de cada intervalo comparado na verificação das variantes com recíproco.
+ */
+#define RCP_CHECK_TERMS 100000LL
+
+/**
+ * @def FIXED_FRACTION_BITS
+ * @brief Número de bits fracionários das somas em ponto fixo do modo reprodutível.
+ *
+ * Com 120 bits, o truncamento de cada termo erra menos de 2^-120, e o formato ainda
+ * representa somas de módulo até 2^7 em um inteiro de 128 bits com sinal.
+ */
+#define FIXED_FRACTION_BITS 120
+
+/**
+ * @def CHECKPOINT_VERSION
+ * @brief Versão corrente do formato do arquivo de checkpoint.
+ */
+#define CHECKPOINT_VERSION 2
+
+/**
+ * @def MESSAGE_FLAG_FIXED
+ * @brief Bit de `work_message::flags` que indica somas em ponto fixo.
+ */
+#define MESSAGE_FLAG_FIXED 1u
+
+/**
+ * @typedef fixed_t
+ * @brief Número em ponto fixo com `FIXED_FRACTION_BITS` bits fracionários.
+ */
+typedef __int128 fixed_t;
+
+/**
+ * @typedef series_kernel
+ * @brief Assinatura comum aos kernels que somam um intervalo da série (sem o fator 4).
+ */
+typedef long double (*series_kernel)(long long start_term, long long num_terms);
+
+/**
+ * @struct kernel_variant
+ * @brief Descrição de uma variante do kernel especializada em tempo de compilação.
+ */
+typedef struct
+{
+    const char *name;      /**< Nome usado na linha de comando, como `double_u8_a4`. */
+    const char *precision; /**< `float`, `double`, `longdouble` ou `quad`. */
+    int unroll;            /**< Termos por iteração do laço principal. */
+    int accumulators;      /**< Acumuladores independentes. */
+    series_kernel fn;      /**< A função especializada. */
+} kernel_variant;
+
+/**
+ * @enum run_mode
+ * @brief Papel deste processo na execução.
+ */
+typedef enum
+{
+    MODE_LOCAL,       /**< Calcula a série inteira com threads locais. */
+    MODE_COORDINATOR, /**< Distribui blocos a trabalhadores remotos. */
+    MODE_WORKER       /**< Calcula os blocos recebidos de um coordenador. */
+} run_mode;
+
+/**
+ * @enum message_type
+ * @brief Tipos de mensagem do protocolo coordenador/trabalhador.
+ */
+typedef enum
+{
+    MSG_REQUEST = 1, /**< Trabalhador pede um bloco. */
+    MSG_ASSIGN = 2,  /**< Coordenador entrega um bloco. */
+    MSG_RESULT = 3,  /**< Trabalhador devolve a soma de um bloco e pede o próximo. */
+    MSG_DONE = 4     /**< Coordenador encerra o trabalhador. */
+} message_type;
+
+/**
+ * @struct leibniz_config
+ * @brief Parâmetros de execução lidos da linha de comando.
+ */
+typedef struct
+{
+    long long total_terms;       /**< Número total de termos da série. */
+    int num_threads;             /**< Número de threads de cálculo. */
+    long long chunk_terms;       /**< Número de termos por bloco. */
+    double report_interval;      /**< Intervalo entre relatórios em segundos (0 desativa o streaming). */
+    long double tolerance;       /**< Limite de erro que encerra o cálculo antecipadamente (0 desativa). */
+    const char *checkpoint_path; /**< Arquivo de checkpoint (NULL desativa). */
+    double checkpoint_interval;  /**< Intervalo entre checkpoints em segundos. */
+    int resume;                  /**< Se diferente de zero, carrega o checkpoint antes de começar. */
+    run_mode mode;               /**< Local, coordenador ou trabalhador. */
+    const char *address;         /**< Endereço `unix:CAMINHO` ou `HOST:PORTA` do coordenador. */
+    double chunk_deadline;       /**< Prazo, em segundos, antes de reenviar um bloco (0 desativa). */
+    int fixed_point;             /**< Se diferente de zero, usa o kernel reprodutível em ponto fixo. */
+    const char *precision;       /**< Precisão das variantes consideradas pelo auto-ajuste. */
+    const char *kernel_name;     /**< Variante do kernel escolhida pelo nome (NULL usa a referência). */
+    int autotune;                /**< Se diferente de zero, escolhe a variante mais rápida na partida. */
+} leibniz_config;
+
+/**
+ * @struct chunk_table
+ * @brief Agregador sem locks onde as threads publicam as somas parciais de cada bloco.
+ *
+ * Cada bloco é escrito por uma única thread. A soma é gravada em `sums[i]` e só então
+ * `done[i]` é marcado com semântica release; quem lê `done[i]` com acquire enxerga a soma
+ * completa. O contador `next_chunk` entrega o próximo bloco a ser calculado.
+ *
+ * No modo reprodutível, `fixed_sums[i]` guarda a soma exata em ponto fixo e `sums[i]`
+ * apenas sua conversão, usada nos relatórios de progresso.
+ */
+typedef struct
+{
+    long long num_chunks;          /**< Quantidade de blocos da série. */
+    long double *sums;             /**< Soma parcial (sem o fator 4) de cada bloco. */
+    fixed_t *fixed_sums;           /**< Soma parcial em ponto fixo (apenas no modo reprodutível). */
+    _Atomic unsigned char *done;   /**< Indica se o bloco já foi concluído. */
+    _Atomic long long next_chunk;  /**< Próximo bloco a ser distribuído. */
+    _Atomic long long terms_done;  /**< Total de termos já somados. */
+    _Atomic int stop;              /**< Pedido de interrupção antecipada. */
+} chunk_table;
+
+/**
+ * @struct progress_report
+ * @brief Instantâneo do progresso do cálculo entregue aos callbacks de convergência.
+ */
+typedef struct
+{
+    double elapsed;            /**< Segundos desde o início do cálculo. */
+    long long terms_done;      /**< Termos já somados. */
+    long double estimate;      /**< Estimativa corrente de Pi. */
+    long double error_bound;   /**< Limite superior de |Pi - estimativa|. */
+    double terms_per_second;   /**< Vazão desde o relatório anterior. */
+} progress_report;
+
+/**
+ * @typedef progress_callback
+ * @brief Função chamada a cada relatório de progresso.
+ *
+ * @param report O instantâneo do progresso.
+ * @param user_data Ponteiro registrado junto com o callback.
+ * @return Diferente de zero para pedir a interrupção do cálculo.
+ */
+typedef int (*progress_callback)(const progress_report *report, void *user_data);
+
+/**
+ * @struct progress_state
+ * @brief Estado privado do agregador de progresso.
+ *
+ * Guarda quais blocos já foram incorporados à soma corrente e a marca d'água abaixo
+ * da qual todos os blocos estão concluídos, de modo que cada relatório só percorre
+ * os blocos que ainda podem mudar.
+ */
+typedef struct
+{
+    unsigned char *accounted; /**< Blocos já incorporados a `sum`. */
+    long long low_water;      /**< Primeiro bloco ainda não incorporado. */
+    long double sum;          /**< Soma dos blocos incorporados. */
+    fixed_t fixed_sum;        /**< Soma exata dos blocos incorporados (modo reprodutível). */
+} progress_state;
+
+/**
+ * @struct checkpoint_header
+ * @brief Cabeçalho do arquivo de checkpoint.
+ *
+ * O arquivo contém o cabeçalho, um bitmap com um bit por bloco (1 = concluído) e, em
+ * seguida, as somas parciais dos blocos concluídos em ordem de índice, cada uma com
+ * `sum_size` bytes: `long double` no modo padrão ou `fixed_t` no modo reprodutível.
+ * Os campos são gravados na ordem de bytes da máquina.
+ */
+typedef struct
+{
+    char magic[8];        /**< Sempre `CHECKPOINT_MAGIC`. */
+    uint32_t version;     /**< Versão do formato. */
+    uint32_t sum_size;    /**< Tamanho de cada soma parcial gravada. */
+    uint32_t fixed_point; /**< 1 se as somas estão em ponto fixo. */
+    uint32_t reserved;    /**< Sempre zero. */
+    int64_t total_terms;  /**< Número de termos da execução que gerou o arquivo. */
+    int64_t chunk_terms;  /**< Termos por bloco da execução que gerou o arquivo. */
+    int64_t num_chunks;   /**< Número de blocos (bits no bitmap). */
+    int64_t completed;    /**< Número de blocos concluídos (somas gravadas). */
+} checkpoint_header;
+
+/**
+ * @struct work_message
+ * @brief Mensagem do protocolo coordenador/trabalhador.
+ *
+ * No fio, cada mensagem ocupa `WIRE_MESSAGE_SIZE` bytes em big-endian: tipo e flags
+ * (4 bytes cada), bloco, termo inicial e número de termos (8 bytes cada) e a soma parcial
+ * em 16 bytes. Sem `MESSAGE_FLAG_FIXED`, a soma vai como um par de doubles (parte alta e
+ * resto), que preserva a precisão do `long double` independentemente do formato nativo de
+ * cada máquina; com a flag, vão as duas metades do inteiro de 128 bits.
+ */
+typedef struct
+{
+    uint32_t type;        /**< Um dos valores de `message_type`. */
+    uint32_t flags;       /**< `MESSAGE_FLAG_FIXED` no modo reprodutível. */
+    int64_t chunk;        /**< Índice do bloco. */
+    int64_t start_term;   /**< Primeiro termo do bloco (MSG_ASSIGN). */
+    int64_t num_terms;    /**< Número de termos do bloco (MSG_ASSIGN). */
+    long double sum;      /**< Soma parcial do bloco (MSG_RESULT). */
+    fixed_t fixed_sum;    /**< Soma parcial em ponto fixo (MSG_RESULT com `MESSAGE_FLAG_FIXED`). */
+} work_message;
+
+/**
+ * @struct worker_connection
+ * @brief Estado do coordenador para cada trabalhador conectado.
+ */
+typedef struct
+{
+    int fd;                                 /**< Socket do trabalhador. */
+    long long chunk;                        /**< Bloco em cálculo, ou -1. */
+    double assigned_at;                     /**< Instante em que o bloco foi entregue. */
+    int expired;                            /**< O bloco excedeu o prazo e já voltou para a fila. */
+    int waiting;                            /**< O trabalhador pediu um bloco e ainda não recebeu. */
+    unsigned char buffer[WIRE_MESSAGE_SIZE]; /**< Mensagem parcialmente recebida. */
+    size_t buffered;                        /**< Bytes válidos em `buffer`. */
+} worker_connection;
+
+/**
+ * @struct range_task
+ * @brief Fatia de um bloco calculada por uma thread local do trabalhador.
+ */
+typedef struct
+{
+    long long start_term; /**< Primeiro termo da fatia. */
+    long long num_terms;  /**< Número de termos da fatia. */
+    int fixed_point;      /**< 1 se a fatia é somada em ponto fixo. */
+    long double sum;      /**< Soma parcial calculada (modo padrão). */
+    fixed_t fixed_sum;    /**< Soma parcial em ponto fixo (modo reprodutível). */
+} range_task;
+
+/**
+ * @struct range_pool
+ * @brief Threads locais do trabalhador, criadas uma vez por conexão e reutilizadas em
+ * todos os blocos.
+ *
+ * A cada bloco, a thread principal preenche `tasks` e passa pela barreira `start`; as
+ * threads calculam suas fatias e se encontram com ela na barreira `finished`. As barreiras
+ * contam `num_threads + 1` participantes. Com `stop` ligado, as threads saem ao passar
+ * por `start`. Enquanto o pool é criado, `gate` fica trancado e segura as threads antes da
+ * primeira barreira: se alguma delas não puder ser criada, as demais saem por `stop` sem
+ * nunca esperar em `start`.
+ */
+typedef struct
+{
+    pthread_t *threads;        /**< Threads locais. */
+    range_task *tasks;         /**< Fatia de cada thread no bloco corrente. */
+    int num_threads;           /**< Número de threads locais. */
+    int stop;                  /**< Lido pelas threads depois de `start`; encerra o pool. */
+    pthread_barrier_t start;   /**< Libera as threads para o bloco corrente. */
+    pthread_barrier_t finished; /**< Espera todas as fatias do bloco corrente. */
+    pthread_mutex_t gate;       /**< Trancado durante `rangePoolCreate`. */
+} range_pool;
+
+/**
+ * @struct range_worker
+ * @brief Argumento de cada thread de `range_pool`.
+ */
+typedef struct
+{
+    range_pool *pool; /**< Pool da thread. */
+    int index;        /**< Índice da fatia da thread em `pool->tasks`. */
+} range_worker;
+
+/**
+ * @var config
+ * @brief Configuração da execução corrente.
+ */
+leibniz_config config = {SIZE, NUM_THREADS, CHUNK_TERMS, 0.0, 0.0L, NULL, CHECKPOINT_INTERVAL, 0,
+                         MODE_LOCAL, NULL, 0.0, 0, "longdouble", NULL, 0};
+
+/**
+ * @var table
+ * @brief Tabela de blocos compartilhada por todas as threads.
+ */
+chunk_table table;
 
 /**
  * @var result
- * @brief Variável global para armazenar a soma final de todas as aproximações parciais de Pi.
- *        O acesso a esta variável é protegido por um mutex para evitar condições de corrida.
+ * @brief Aproximação final de Pi, calculada pela thread principal após o término das threads.
  */
 long double result = 0;
 
 /**
- * @var mutex
- * @brief Mutex para garantir o acesso exclusivo à variável global `result` pelas threads.
+ * @var callback
+ * @brief Callback de convergência registrado (ou NULL).
+ */
+progress_callback callback = NULL;
+
+/**
+ * @var callback_data
+ * @brief Ponteiro repassado ao callback de convergência.
+ */
+void *callback_data = NULL;
+
+/**
+ * @var finished_mutex
+ * @brief Mutex que protege `finished` e permite acordar as threads auxiliares.
+ */
+pthread_mutex_t finished_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * @var finished_cond
+ * @brief Condição sinalizada quando todas as threads de cálculo terminam.
+ */
+pthread_cond_t finished_cond;
+
+/**
+ * @var finished
+ * @brief Indica que as threads de cálculo terminaram.
  */
-pthread_mutex_t mutex;
+int finished = 0;
 
 /**
  * @fn double calcular_tempo()
@@ -53,25 +456,58 @@ double calcular_tempo()
 }
 
 /**
- * @fn long double partialFormula(int start_term)
+ * @fn int waitFinished(double seconds)
+ * @brief Espera até `seconds` segundos ou até que as threads de cálculo terminem.
+ *
+ * Usada pelas threads auxiliares (relatora e de checkpoint) para dormir entre duas
+ * execuções sem atrasar o encerramento do programa.
+ *
+ * @return Diferente de zero se o cálculo já terminou.
+ */
+int waitFinished(double seconds)
+{
+    struct timespec deadline;
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    long long interval_ns = (long long)(seconds * 1e9);
+    deadline.tv_sec += interval_ns / 1000000000LL;
+    deadline.tv_nsec += interval_ns % 1000000000LL;
+    if (deadline.tv_nsec >= 1000000000L)
+    {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
+    }
+
+    pthread_mutex_lock(&finished_mutex);
+    while (!finished && pthread_cond_timedwait(&finished_cond, &finished_mutex, &deadline) == 0)
+    {
+    }
+    int done = finished;
+    pthread_mutex_unlock(&finished_mutex);
+
+    return done;
+}
+
+/**
+ * @fn long double partialFormula(long long start_term, long long num_terms)
  * @brief Calcula uma soma parcial da série de Leibniz.
  *
  * A fórmula de Leibniz para Pi é: π/4 = 1 - 1/3 + 1/5 - 1/7 + ...
  * Esta função calcula um segmento desta série, começando em `start_term` e
- * continuando por `PARTIAL_NUM_TERMS` iterações.
+ * continuando por `num_terms` iterações. O sinal do primeiro termo depende
+ * da paridade de `start_term`.
  *
  * @param start_term O índice inicial do termo na série a partir do qual o cálculo deve começar.
+ * @param num_terms O número de termos a somar.
  * @return A soma parcial dos termos calculados como um `long double`.
  */
-long double partialFormula(int start_term)
+long double partialFormula(long long start_term, long long num_terms)
 {
-
-    const int num_terms = start_term + PARTIAL_NUM_TERMS;
+    const long long end_term = start_term + num_terms;
 
     long double pi_approximation = 0;
-    double signal = 1.0;
+    double signal = (start_term % 2 == 0) ? 1.0 : -1.0;
 
-    for (int k = start_term; k < num_terms; k++)
+    for (long long k = start_term; k < end_term; k++)
     {
         pi_approximation += signal / (2 * k + 1);
         signal *= -1.0;
@@ -81,99 +517,2055 @@ long double partialFormula(int start_term)
 }
 
 /**
- * @fn void *partialProcessing(void *args)
- * @brief A função de trabalho executada por cada thread.
+ * @fn uint64_t divideWide(uint64_t high, uint64_t low, uint64_t divisor)
+ * @brief Divide o inteiro de 128 bits `high:low` por `divisor`, com `high < divisor`.
  *
- * Esta função recebe o termo inicial para seu cálculo, chama `partialFormula` para
- * obter a soma parcial, mede o tempo de execução dessa tarefa, e então adiciona
- * seu resultado à variável global `result` de forma segura, usando um mutex.
+ * Em x86-64 usa diretamente a instrução `divq`, que faz essa divisão 128/64 em hardware;
+ * nas demais arquiteturas recorre à divisão de `unsigned __int128` do compilador.
+ */
+static inline uint64_t divideWide(uint64_t high, uint64_t low, uint64_t divisor)
+{
+#if defined(__x86_64__)
+    uint64_t quotient, remainder;
+    __asm__("divq %4" : "=a"(quotient), "=d"(remainder) : "a"(low), "d"(high), "rm"(divisor));
+    return quotient;
+#else
+    return (uint64_t)((((unsigned __int128)high << 64) | low) / divisor);
+#endif
+}
+
+/**
+ * @fn fixed_t fixedTerm(uint64_t denominator)
+ * @brief Retorna floor(2^FIXED_FRACTION_BITS / denominator), o módulo de um termo em ponto fixo.
  *
- * @param args Um ponteiro para um inteiro alocado dinamicamente que contém o termo inicial
- *             para o cálculo desta thread. A memória para `args` é liberada dentro da função.
- * @return NULL.
+ * A divisão é feita em dois passos de 64 bits: primeiro a parte alta do quociente e,
+ * com o resto, a parte baixa. O resultado é uma função exata do denominador.
  */
-void *partialProcessing(void *args)
+static inline fixed_t fixedTerm(uint64_t denominator)
 {
-    pthread_t tid = pthread_self();
-    int first_therm = *((int *)args);
-    free(args);
+    const uint64_t numerator_high = 1ULL << (FIXED_FRACTION_BITS - 64);
+    uint64_t quotient_high = numerator_high / denominator;
+    uint64_t remainder = numerator_high % denominator;
+    uint64_t quotient_low = divideWide(remainder, 0, denominator);
+
+    return (fixed_t)(((unsigned __int128)quotient_high << 64) | quotient_low);
+}
+
+/**
+ * @fn fixed_t fixedPartialFormula(long long start_term, long long num_terms)
+ * @brief Versão reprodutível de `partialFormula`, com termos e soma em ponto fixo.
+ *
+ * Cada termo é truncado para `FIXED_FRACTION_BITS` bits fracionários e somado com
+ * aritmética inteira exata, de modo que a soma de um intervalo não depende de como ele
+ * é dividido. Os termos são processados aos pares (positivo e negativo) com dois
+ * acumuladores independentes, o que elimina o estado de sinal do laço e deixa as
+ * divisões de cada iteração livres para executar em paralelo no pipeline.
+ *
+ * @param start_term O índice inicial do termo na série.
+ * @param num_terms O número de termos a somar.
+ * @return A soma parcial em ponto fixo.
+ */
+fixed_t fixedPartialFormula(long long start_term, long long num_terms)
+{
+    long long k = start_term;
+    const long long end_term = start_term + num_terms;
+    fixed_t positive = 0;
+    fixed_t negative = 0;
 
-    double initial_time = calcular_tempo();             // comeca a contar o tempo de inicio
-    long double sum = partialFormula((int)first_therm); // faz o calculo dos valores referentes a essa thread
-    double end_time = calcular_tempo();                 // comeca a contar o tempo de fim
-    double final_time = end_time - initial_time;        // calcula p tempo final
+    if (k < end_term && k % 2 != 0)
+    {
+        negative += fixedTerm(2 * (uint64_t)k + 1);
+        k++;
+    }
 
-    pthread_mutex_lock(&mutex);
-    result += 4 * sum;
-    pthread_mutex_unlock(&mutex);
+    for (; k + 1 < end_term; k += 2)
+    {
+        positive += fixedTerm(2 * (uint64_t)k + 1);
+        negative += fixedTerm(2 * (uint64_t)k + 3);
+    }
 
-    printf("TID: %lu : %.2fs\n", (unsigned long)tid, final_time); // mostrar TID e tempo empregado na thread
+    if (k < end_term)
+    {
+        positive += fixedTerm(2 * (uint64_t)k + 1);
+    }
 
-    return NULL;
+    return positive - negative;
 }
 
 /**
- * @fn int main()
- * @brief Ponto de entrada principal do programa.
+ * @fn long double fixedToLongDouble(fixed_t value)
+ * @brief Converte um valor em ponto fixo para `long double`, com um único arredondamento.
+ */
+long double fixedToLongDouble(fixed_t value)
+{
+    return (long double)value / (long double)((unsigned __int128)1 << FIXED_FRACTION_BITS);
+}
+
+/**
+ * @def DEFINE_SERIES_KERNEL
+ * @brief Gera uma variante do kernel especializada em tipo, desenrolamento e acumuladores.
  *
- * A função `main` inicializa o mutex, cria e gerencia as threads, mede o tempo
- * total de execução, e exibe o resultado final.
- * - Inicializa o mutex.
- * - Inicia a contagem do tempo total.
- * - Cria `NUM_THREADS` threads, passando a cada uma o seu termo inicial para o cálculo.
- *   A última thread é designada para calcular quaisquer termos remanescentes da divisão inteira.
- * - Aguarda a conclusão de todas as threads com `pthread_join`.
- * - Para a contagem do tempo total.
- * - Destrói o mutex.
- * - Imprime o valor aproximado de Pi e o tempo total de execução.
+ * `UNROLL` deve ser par: assim o sinal de cada posição dentro da iteração é uma constante
+ * de compilação (positivo nas posições pares, relativo ao primeiro termo) e o laço não
+ * carrega estado de sinal. Os `ACCS` acumuladores quebram a dependência entre somas
+ * consecutivas; como `UNROLL` e `ACCS` são constantes, o compilador desenrola o laço
+ * interno por completo. O sinal do primeiro termo é aplicado uma única vez, no final.
+ */
+#define DEFINE_SERIES_KERNEL(NAME, TYPE, UNROLL, ACCS)                                  \
+    long double NAME(long long start_term, long long num_terms)                         \
+    {                                                                                   \
+        TYPE acc[ACCS] = {0};                                                           \
+        long long k = start_term;                                                       \
+        const long long end_term = start_term + num_terms;                              \
+                                                                                        \
+        for (; k + (UNROLL) <= end_term; k += (UNROLL))                                 \
+        {                                                                               \
+            const TYPE denominator = (TYPE)(2 * k + 1);                                 \
+            for (int u = 0; u < (UNROLL); u++)                                          \
+            {                                                                           \
+                const TYPE term = (TYPE)1 / (denominator + (TYPE)(2 * u));              \
+                acc[u % (ACCS)] += (u % 2 == 0) ? term : -term;                         \
+            }                                                                           \
+        }                                                                               \
+                                                                                        \
+        TYPE sum = 0;                                                                   \
+        for (int a = 0; a < (ACCS); a++)                                                \
+        {                                                                               \
+            sum += acc[a];                                                              \
+        }                                                                               \
+        for (long long j = k; j < end_term; j++)                                        \
+        {                                                                               \
+            const TYPE term = (TYPE)1 / (TYPE)(2 * j + 1);                              \
+            sum += ((j - start_term) % 2 == 0) ? term : -term;                          \
+        }                                                                               \
+                                                                                        \
+        return (start_term % 2 == 0) ? (long double)sum : -(long double)sum;            \
+    }
+
+/**
+ * @def DEFINE_PRECISION_KERNELS
+ * @brief Gera as variantes de uma precisão para todas as combinações de desenrolamento
+ *        (2, 4, 8) e acumuladores (1, 2, 4) com acumuladores <= desenrolamento.
+ */
+#define DEFINE_PRECISION_KERNELS(PREFIX, TYPE)      \
+    DEFINE_SERIES_KERNEL(PREFIX##_u2_a1, TYPE, 2, 1) \
+    DEFINE_SERIES_KERNEL(PREFIX##_u2_a2, TYPE, 2, 2) \
+    DEFINE_SERIES_KERNEL(PREFIX##_u4_a1, TYPE, 4, 1) \
+    DEFINE_SERIES_KERNEL(PREFIX##_u4_a2, TYPE, 4, 2) \
+    DEFINE_SERIES_KERNEL(PREFIX##_u4_a4, TYPE, 4, 4) \
+    DEFINE_SERIES_KERNEL(PREFIX##_u8_a1, TYPE, 8, 1) \
+    DEFINE_SERIES_KERNEL(PREFIX##_u8_a2, TYPE, 8, 2) \
+    DEFINE_SERIES_KERNEL(PREFIX##_u8_a4, TYPE, 8, 4)
+
+/**
+ * @def PRECISION_VARIANTS
+ * @brief Entradas de `kernel_variants` para as variantes geradas por `DEFINE_PRECISION_KERNELS`.
+ */
+#define PRECISION_VARIANTS(PREFIX, PRECISION)                   \
+    {#PREFIX "_u2_a1", PRECISION, 2, 1, PREFIX##_u2_a1},        \
+        {#PREFIX "_u2_a2", PRECISION, 2, 2, PREFIX##_u2_a2},    \
+        {#PREFIX "_u4_a1", PRECISION, 4, 1, PREFIX##_u4_a1},    \
+        {#PREFIX "_u4_a2", PRECISION, 4, 2, PREFIX##_u4_a2},    \
+        {#PREFIX "_u4_a4", PRECISION, 4, 4, PREFIX##_u4_a4},    \
+        {#PREFIX "_u8_a1", PRECISION, 8, 1, PREFIX##_u8_a1},    \
+        {#PREFIX "_u8_a2", PRECISION, 8, 2, PREFIX##_u8_a2},    \
+        {#PREFIX "_u8_a4", PRECISION, 8, 4, PREFIX##_u8_a4}
+
+DEFINE_PRECISION_KERNELS(float, float)
+DEFINE_PRECISION_KERNELS(double, double)
+DEFINE_PRECISION_KERNELS(longdouble, long double)
+#if defined(__SIZEOF_FLOAT128__)
+DEFINE_PRECISION_KERNELS(quad, __float128)
+#endif
+
+/**
+ * @def RCP_FAST_STEPS
+ * @brief Passos de Newton-Raphson do modo `rcp_rapido` (cerca de 22 bits corretos).
+ *
+ * A estimativa inicial de `rcpps` tem cerca de 12 bits corretos e cada passo dobra esse
+ * número. A de `vrcp14pd` (AVX-512) começa com 14 bits, então ali um passo já dá 28 bits
+ * e dois passos já atingem a precisão plena de double.
+ */
+#define RCP_FAST_STEPS 1
+
+/**
+ * @def RCP_BALANCED_STEPS
+ * @brief Passos de Newton-Raphson do modo `rcp_medio` (cerca de 44 bits corretos).
+ */
+#define RCP_BALANCED_STEPS 2
+
+/**
+ * @def RCP_ACCURATE_STEPS
+ * @brief Passos de Newton-Raphson do modo `rcp_preciso` (precisão plena de double).
+ */
+#define RCP_ACCURATE_STEPS 3
+
+/**
+ * @def RCP_EXACT_STEPS
+ * @brief Valor especial de passos que troca a estimativa por divisão exata.
  *
- * @return EXIT_SUCCESS em caso de sucesso.
+ * Usado apenas como referência na verificação de precisão: mantém exatamente a mesma
+ * estrutura de acumulação, de modo que a diferença medida vem só dos recíprocos.
  */
-int main()
+#define RCP_EXACT_STEPS 0
+
+#if defined(__AVX512F__)
+/**
+ * @fn static inline __m512d reciprocal8(__m512d denominator, int steps)
+ * @brief Recíproco de 8 doubles: estimativa `vrcp14pd` refinada por `steps` passos de Newton.
+ *
+ * Cada passo calcula x' = x + x(1 - dx), que dobra o número de bits corretos; mais de
+ * dois passos não mudam o resultado e são descartados.
+ */
+static inline __m512d reciprocal8(__m512d denominator, int steps)
 {
+    const __m512d one = _mm512_set1_pd(1.0);
+    if (steps == RCP_EXACT_STEPS)
+    {
+        return _mm512_div_pd(one, denominator);
+    }
 
-    // criar um mutex
-    pthread_mutex_init(&mutex, NULL);
-    // criar as threads
-    pthread_t thread[NUM_THREADS];
-    unsigned long args[NUM_THREADS];
+    __m512d x = _mm512_rcp14_pd(denominator);
+    for (int i = 0; i < steps && i < 2; i++)
+    {
+        __m512d error = _mm512_fnmadd_pd(denominator, x, one);
+        x = _mm512_fmadd_pd(x, error, x);
+    }
+    return x;
+}
+#elif defined(__SSE2__)
+/**
+ * @fn static inline void reciprocal4(__m128d first, __m128d second, int steps, __m128d *first_rcp, __m128d *second_rcp)
+ * @brief Recíproco de 4 doubles: estimativa `rcpps` em float refinada por `steps` passos de Newton.
+ *
+ * Os quatro denominadores são convertidos para float para que uma única instrução
+ * `rcpps` produza as quatro estimativas; o refinamento x' = x(2 - dx) é feito em double
+ * com os denominadores exatos.
+ */
+static inline void reciprocal4(__m128d first, __m128d second, int steps, __m128d *first_rcp, __m128d *second_rcp)
+{
+    const __m128d two = _mm_set1_pd(2.0);
+    if (steps == RCP_EXACT_STEPS)
+    {
+        *first_rcp = _mm_div_pd(_mm_set1_pd(1.0), first);
+        *second_rcp = _mm_div_pd(_mm_set1_pd(1.0), second);
+        return;
+    }
 
-    // dividir o tamanho total pelo número de threads
-    long long remainder = SIZE % NUM_THREADS;
+    __m128 estimate = _mm_rcp_ps(_mm_movelh_ps(_mm_cvtpd_ps(first), _mm_cvtpd_ps(second)));
+    __m128d x = _mm_cvtps_pd(estimate);
+    __m128d y = _mm_cvtps_pd(_mm_movehl_ps(estimate, estimate));
+    for (int i = 0; i < steps; i++)
+    {
+        x = _mm_mul_pd(x, _mm_sub_pd(two, _mm_mul_pd(first, x)));
+        y = _mm_mul_pd(y, _mm_sub_pd(two, _mm_mul_pd(second, y)));
+    }
+    *first_rcp = x;
+    *second_rcp = y;
+}
+#endif
 
-    // começamos a calcular o tempo de inicio do procesamento
-    printf("Começando a calcular o valor de pi da série de Leibniz, com %d threads\n", NUM_THREADS);
-    double total_start_time = calcular_tempo();
+/**
+ * @fn static inline long double reciprocalPartialFormula(long long start_term, long long num_terms, int steps)
+ * @brief Soma um intervalo da série usando recíprocos aproximados em vez de divisões.
+ *
+ * Os denominadores são mantidos em vetores de double e avançam por soma, sem conversões
+ * de inteiros no laço. Os termos positivos e negativos ficam em acumuladores separados,
+ * de modo que o sinal também não aparece no laço. Termos que sobram no final do
+ * intervalo são somados com divisão exata. Sem SSE2, cada recíproco é uma divisão em
+ * float refinada pelos mesmos passos, o que preserva a precisão de cada modo.
+ *
+ * @param start_term O índice inicial do termo na série.
+ * @param num_terms O número de termos a somar.
+ * @param steps Passos de Newton-Raphson aplicados à estimativa.
+ * @return A soma parcial (sem o fator 4).
+ */
+static inline long double reciprocalPartialFormula(long long start_term, long long num_terms, int steps)
+{
+    long long k = start_term;
+    const long long end_term = start_term + num_terms;
+    double sum = 0;
 
-    for (int i = 0; i < NUM_THREADS; ++i)
+#if defined(__AVX512F__)
+    if (k + 16 <= end_term)
     {
-        int *init = malloc(sizeof(int));
-        *init = i * PARTIAL_NUM_TERMS;
+        const __m512d offsets = _mm512_set_pd(29, 25, 21, 17, 13, 9, 5, 1);
+        const __m512d step = _mm512_set1_pd(32.0);
+        const __m512d two = _mm512_set1_pd(2.0);
+        __m512d positive_denominator = _mm512_add_pd(_mm512_set1_pd(2.0 * k), offsets);
+        __m512d positive = _mm512_setzero_pd();
+        __m512d negative = _mm512_setzero_pd();
+
+        for (; k + 16 <= end_term; k += 16)
+        {
+            __m512d negative_denominator = _mm512_add_pd(positive_denominator, two);
+            positive = _mm512_add_pd(positive, reciprocal8(positive_denominator, steps));
+            negative = _mm512_add_pd(negative, reciprocal8(negative_denominator, steps));
+            positive_denominator = _mm512_add_pd(positive_denominator, step);
+        }
 
-        int terms_to_compute = PARTIAL_NUM_TERMS;
+        sum = _mm512_reduce_add_pd(_mm512_sub_pd(positive, negative));
+    }
+#elif defined(__SSE2__)
+    if (k + 4 <= end_term)
+    {
+        const __m128d step = _mm_set1_pd(8.0);
+        const __m128d two = _mm_set1_pd(2.0);
+        __m128d positive_denominator = _mm_set_pd(2.0 * k + 5, 2.0 * k + 1);
+        __m128d positive = _mm_setzero_pd();
+        __m128d negative = _mm_setzero_pd();
 
-        // A última thread pega os termos restantes
-        if (i == NUM_THREADS - 1)
+        for (; k + 4 <= end_term; k += 4)
         {
-            terms_to_compute += SIZE % NUM_THREADS;
+            __m128d positive_rcp, negative_rcp;
+            reciprocal4(positive_denominator, _mm_add_pd(positive_denominator, two), steps,
+                        &positive_rcp, &negative_rcp);
+            positive = _mm_add_pd(positive, positive_rcp);
+            negative = _mm_add_pd(negative, negative_rcp);
+            positive_denominator = _mm_add_pd(positive_denominator, step);
         }
 
-        pthread_create(&thread[i], NULL, partialProcessing, (void *)init);
+        double lanes[2];
+        _mm_storeu_pd(lanes, _mm_sub_pd(positive, negative));
+        sum = lanes[0] + lanes[1];
+    }
+#else
+    for (; k + 2 <= end_term; k += 2)
+    {
+        double positive_denominator = 2.0 * k + 1;
+        double negative_denominator = positive_denominator + 2;
+        double x = (double)(1.0f / (float)positive_denominator);
+        double y = (double)(1.0f / (float)negative_denominator);
+        if (steps == RCP_EXACT_STEPS)
+        {
+            x = 1.0 / positive_denominator;
+            y = 1.0 / negative_denominator;
+        }
+        for (int i = 0; i < steps; i++)
+        {
+            x = x * (2.0 - positive_denominator * x);
+            y = y * (2.0 - negative_denominator * y);
+        }
+        sum += x - y;
     }
+#endif
 
-    for (int i = 0; i < NUM_THREADS; ++i)
+    // Os blocos vetoriais têm tamanho par, então o primeiro termo restante tem o sinal do primeiro termo.
+    for (long long j = k; j < end_term; j++)
     {
-        pthread_join(thread[i], NULL);
+        double term = 1.0 / (2.0 * j + 1);
+        sum += ((j - k) % 2 == 0) ? term : -term;
     }
 
-    double total_time_end = calcular_tempo();
-    double total_final_time = total_time_end - total_start_time;
+    return (start_term % 2 == 0) ? (long double)sum : -(long double)sum;
+}
 
-    /* Liberar o mutex */
-    pthread_mutex_destroy(&mutex);
+/**
+ * @fn long double reciprocalFastFormula(long long start_term, long long num_terms)
+ * @brief Variante `rcp_rapido` de `reciprocalPartialFormula`.
+ */
+long double reciprocalFastFormula(long long start_term, long long num_terms)
+{
+    return reciprocalPartialFormula(start_term, num_terms, RCP_FAST_STEPS);
+}
 
-    printf("\nValor aproximado de pi: %.15Lf\n", result);
-    printf("Tempo total de execução: %.2fs\n", total_final_time);
+/**
+ * @fn long double reciprocalBalancedFormula(long long start_term, long long num_terms)
+ * @brief Variante `rcp_medio` de `reciprocalPartialFormula`.
+ */
+long double reciprocalBalancedFormula(long long start_term, long long num_terms)
+{
+    return reciprocalPartialFormula(start_term, num_terms, RCP_BALANCED_STEPS);
+}
+
+/**
+ * @fn long double reciprocalAccurateFormula(long long start_term, long long num_terms)
+ * @brief Variante `rcp_preciso` de `reciprocalPartialFormula`.
+ */
+long double reciprocalAccurateFormula(long long start_term, long long num_terms)
+{
+    return reciprocalPartialFormula(start_term, num_terms, RCP_ACCURATE_STEPS);
+}
 
-    return EXIT_SUCCESS;
-}
\ No newline at end of file
+/**
+ * @var kernel_variants
+ * @brief Todas as variantes disponíveis, incluindo a referência `partialFormula`.
+ */
+const kernel_variant kernel_variants[] = {
+    {"referencia", "longdouble", 1, 1, partialFormula},
+    PRECISION_VARIANTS(float, "float"),
+    PRECISION_VARIANTS(double, "double"),
+    PRECISION_VARIANTS(longdouble, "longdouble"),
+#if defined(__SIZEOF_FLOAT128__)
+    PRECISION_VARIANTS(quad, "quad"),
+#endif
+    {"rcp_rapido", "rcp", 4, 2, reciprocalFastFormula},
+    {"rcp_medio", "rcp", 4, 2, reciprocalBalancedFormula},
+    {"rcp_preciso", "rcp", 4, 2, reciprocalAccurateFormula},
+};
+
+/**
+ * @def NUM_KERNEL_VARIANTS
+ * @brief Número de entradas em `kernel_variants`.
+ */
+#define NUM_KERNEL_VARIANTS ((int)(sizeof(kernel_variants) / sizeof(kernel_variants[0])))
+
+/**
+ * @var kernel
+ * @brief Kernel usado pelas threads de cálculo; `partialFormula` a menos que outro seja escolhido.
+ */
+series_kernel kernel = partialFormula;
+
+/**
+ * @fn const kernel_variant *findKernel(const char *name)
+ * @brief Procura uma variante pelo nome.
+ * @return A variante, ou NULL se o nome não existe.
+ */
+const kernel_variant *findKernel(const char *name)
+{
+    for (int i = 0; i < NUM_KERNEL_VARIANTS; i++)
+    {
+        if (strcmp(kernel_variants[i].name, name) == 0)
+        {
+            return &kernel_variants[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @fn const kernel_variant *autotuneKernel(const char *precision)
+ * @brief Mede as variantes de `precision` nesta máquina e retorna a mais rápida.
+ *
+ * Cada variante soma `AUTOTUNE_TERMS` termos `AUTOTUNE_REPETITIONS` vezes e vale o menor
+ * tempo, o que descarta interferências pontuais. Os termos medidos começam longe da
+ * origem, onde os denominadores já têm a magnitude típica de uma execução real.
+ *
+ * @return A variante escolhida, ou NULL se não há variantes dessa precisão.
+ */
+const kernel_variant *autotuneKernel(const char *precision)
+{
+    const kernel_variant *best = NULL;
+    double best_time = 0;
+    volatile long double sink = 0;
+
+    printf("Auto-ajuste do kernel (%s, %lld termos por medida):\n", precision, AUTOTUNE_TERMS);
+    for (int i = 0; i < NUM_KERNEL_VARIANTS; i++)
+    {
+        const kernel_variant *variant = &kernel_variants[i];
+        if (strcmp(variant->precision, precision) != 0)
+        {
+            continue;
+        }
+
+        double fastest = 0;
+        for (int rep = 0; rep < AUTOTUNE_REPETITIONS; rep++)
+        {
+            double initial_time = calcular_tempo();
+            sink += variant->fn(config.total_terms / 2, AUTOTUNE_TERMS);
+            double elapsed = calcular_tempo() - initial_time;
+            if (rep == 0 || elapsed < fastest)
+            {
+                fastest = elapsed;
+            }
+        }
+
+        printf("  %-18s %8.2f Mtermos/s\n", variant->name, AUTOTUNE_TERMS / fastest / 1e6);
+        if (best == NULL || fastest < best_time)
+        {
+            best = variant;
+            best_time = fastest;
+        }
+    }
+
+    (void)sink;
+    return best;
+}
+
+/**
+ * @fn int selectKernel()
+ * @brief Aplica `--kernel` ou `--autoajuste`, definindo o kernel usado pelas threads.
+ * @return 0 em caso de sucesso, -1 se a variante ou a precisão pedida não existe.
+ */
+int selectKernel()
+{
+    const kernel_variant *variant = NULL;
+
+    if (config.kernel_name != NULL)
+    {
+        variant = findKernel(config.kernel_name);
+    }
+    else if (config.autotune)
+    {
+        variant = autotuneKernel(config.precision);
+    }
+    else
+    {
+        return 0;
+    }
+
+    if (variant == NULL)
+    {
+        return -1;
+    }
+
+    kernel = variant->fn;
+    printf("Kernel selecionado: %s\n", variant->name);
+    return 0;
+}
+
+/**
+ * @fn int verifyReciprocalKernels()
+ * @brief Teste de regressão de precisão das variantes com recíproco aproximado.
+ *
+ * Para intervalos em várias ordens de grandeza da série, compara a soma de cada variante
+ * `rcp_*` com a do mesmo kernel usando divisão exata (`RCP_EXACT_STEPS`), que acumula os
+ * termos na mesma ordem. O desvio é medido relativo à soma dos módulos dos termos do
+ * intervalo e precisa ficar abaixo do limite do modo (2^-20, 2^-40 e 2^-48).
+ *
+ * @return 0 se todas as variantes passam, 1 caso contrário.
+ */
+int verifyReciprocalKernels()
+{
+    static const struct
+    {
+        const char *name;
+        long double limit;
+    } checks[] = {
+        {"rcp_rapido", 0x1p-20L},
+        {"rcp_medio", 0x1p-40L},
+        {"rcp_preciso", 0x1p-48L},
+    };
+    static const long long starts[] = {0, 1000, 1000000, 1000000000, 1000000000000LL};
+    int failures = 0;
+
+    printf("Verificando as variantes com recíproco contra a divisão exata:\n");
+    for (size_t c = 0; c < sizeof(checks) / sizeof(checks[0]); c++)
+    {
+        const kernel_variant *variant = findKernel(checks[c].name);
+        long double worst = 0;
+
+        for (size_t i = 0; i < sizeof(starts) / sizeof(starts[0]); i++)
+        {
+            for (long long length = RCP_CHECK_TERMS; length < RCP_CHECK_TERMS + 3; length++)
+            {
+                long double magnitude = 0;
+                for (long long k = starts[i]; k < starts[i] + length; k++)
+                {
+                    magnitude += 1.0L / (2.0L * k + 1.0L);
+                }
+
+                long double exact = reciprocalPartialFormula(starts[i], length, RCP_EXACT_STEPS);
+                long double deviation = variant->fn(starts[i], length) - exact;
+                long double relative = (deviation < 0 ? -deviation : deviation) / magnitude;
+                if (relative > worst)
+                {
+                    worst = relative;
+                }
+            }
+        }
+
+        int ok = worst <= checks[c].limit;
+        failures += !ok;
+        printf("  %-12s erro relativo máximo %.3Le (limite %.3Le) %s\n", variant->name, worst,
+               checks[c].limit, ok ? "OK" : "FALHOU");
+    }
+
+    return failures == 0 ? 0 : 1;
+}
+
+/**
+ * @fn long long chunkStart(long long chunk)
+ * @brief Retorna o índice do primeiro termo de um bloco.
+ */
+long long chunkStart(long long chunk)
+{
+    return chunk * config.chunk_terms;
+}
+
+/**
+ * @fn long long chunkLength(long long chunk)
+ * @brief Retorna o número de termos de um bloco; o último bloco fica com o resto da divisão.
+ */
+long long chunkLength(long long chunk)
+{
+    long long remaining = config.total_terms - chunkStart(chunk);
+    return remaining < config.chunk_terms ? remaining : config.chunk_terms;
+}
+
+/**
+ * @fn void registerProgressCallback(progress_callback fn, void *user_data)
+ * @brief Registra o callback chamado a cada relatório de progresso do modo streaming.
+ */
+void registerProgressCallback(progress_callback fn, void *user_data)
+{
+    callback = fn;
+    callback_data = user_data;
+}
+
+/**
+ * @fn int printProgress(const progress_report *report, void *user_data)
+ * @brief Callback padrão: imprime a estimativa, o limite de erro e a vazão.
+ * @return Sempre 0; a interrupção por tolerância é decidida pela thread relatora.
+ */
+int printProgress(const progress_report *report, void *user_data)
+{
+    (void)user_data;
+    printf("[%7.2fs] termos: %lld | pi ~ %.15Lf | erro <= %.3Le | %.3e termos/s\n",
+           report->elapsed, report->terms_done, report->estimate, report->error_bound,
+           report->terms_per_second);
+    fflush(stdout);
+    return 0;
+}
+
+/**
+ * @fn int initChunkTable()
+ * @brief Aloca a tabela de blocos de acordo com a configuração corrente.
+ * @return 0 em caso de sucesso, -1 se a memória não puder ser alocada.
+ */
+int initChunkTable()
+{
+    table.num_chunks = (config.total_terms + config.chunk_terms - 1) / config.chunk_terms;
+    table.sums = calloc(table.num_chunks, sizeof(long double));
+    table.fixed_sums = config.fixed_point ? calloc(table.num_chunks, sizeof(fixed_t)) : NULL;
+    table.done = calloc(table.num_chunks, sizeof(*table.done));
+    atomic_init(&table.next_chunk, 0);
+    atomic_init(&table.terms_done, 0);
+    atomic_init(&table.stop, 0);
+
+    return (table.sums == NULL || table.done == NULL || (config.fixed_point && table.fixed_sums == NULL)) ? -1 : 0;
+}
+
+/**
+ * @fn void destroyChunkTable()
+ * @brief Libera a memória da tabela de blocos.
+ */
+void destroyChunkTable()
+{
+    free(table.sums);
+    free(table.fixed_sums);
+    free((void *)table.done);
+}
+
+/**
+ * @struct run_arena
+ * @brief Bloco único, alocado em `main`, de onde saem os identificadores das threads de cálculo.
+ *
+ * As threads recebem só NULL como argumento, de modo que a execução não faz nenhum
+ * `malloc` por thread; a arena é liberada junto com a tabela de blocos.
+ */
+typedef struct
+{
+    unsigned char *base; /**< Bloco da arena. */
+    size_t size;         /**< Tamanho de `base`. */
+    size_t used;         /**< Bytes já entregues. */
+} run_arena;
+
+run_arena arena;
+
+/**
+ * @fn int arenaCreate(size_t size)
+ * @brief Aloca a arena com pelo menos `size` bytes, arredondados para ARENA_ALIGN.
+ *
+ * @return 0 em caso de sucesso, -1 se faltar memória.
+ */
+int arenaCreate(size_t size)
+{
+    // Sem threads locais (coordenador), a arena fica com uma linha, para não pedir 0 bytes.
+    arena.size = size > 0 ? (size + ARENA_ALIGN - 1) / ARENA_ALIGN * ARENA_ALIGN : ARENA_ALIGN;
+    arena.used = 0;
+    arena.base = aligned_alloc(ARENA_ALIGN, arena.size);
+    return arena.base != NULL ? 0 : -1;
+}
+
+/**
+ * @fn void *arenaAlloc(size_t size)
+ * @brief Entrega `size` bytes da arena, alinhados a ARENA_ALIGN.
+ *
+ * @return O bloco, ou NULL se a arena não comportar `size` bytes.
+ */
+void *arenaAlloc(size_t size)
+{
+    size_t rounded = (size + ARENA_ALIGN - 1) / ARENA_ALIGN * ARENA_ALIGN;
+    if (arena.base == NULL || rounded > arena.size - arena.used)
+    {
+        return NULL;
+    }
+    void *block = arena.base + arena.used;
+    arena.used += rounded;
+    return block;
+}
+
+/**
+ * @fn void arenaDestroy(void)
+ * @brief Libera a arena.
+ */
+void arenaDestroy(void)
+{
+    free(arena.base);
+    arena.base = NULL;
+}
+
+/**
+ * @fn void publishChunk(long long chunk, long double sum, fixed_t fixed_sum)
+ * @brief Grava a soma de um bloco na tabela e o marca como concluído.
+ *
+ * No modo reprodutível, `sum` é ignorada e substituída pela conversão de `fixed_sum`.
+ */
+void publishChunk(long long chunk, long double sum, fixed_t fixed_sum)
+{
+    if (config.fixed_point)
+    {
+        table.fixed_sums[chunk] = fixed_sum;
+        sum = fixedToLongDouble(fixed_sum);
+    }
+    table.sums[chunk] = sum;
+    atomic_store_explicit(&table.done[chunk], 1, memory_order_release);
+    atomic_fetch_add_explicit(&table.terms_done, chunkLength(chunk), memory_order_relaxed);
+}
+
+/**
+ * @fn void collectProgress(progress_state *state, progress_report *report)
+ * @brief Incorpora os blocos recém-concluídos e calcula a estimativa e seu limite de erro.
+ *
+ * Pelo critério de séries alternadas com termos decrescentes, a soma de qualquer segmento
+ * que começa no termo `a` tem módulo no máximo 1/(2a+1). O erro da estimativa é então
+ * limitado pela soma desse valor para cada bloco já distribuído mas ainda não concluído,
+ * mais o mesmo limite para a cauda que ainda não foi distribuída.
+ *
+ * `next_chunk` é lido antes de `done`: todo bloco abaixo do valor lido já foi entregue a
+ * alguma thread e aparece como concluído ou entra no limite de erro.
+ *
+ * @param state Estado do agregador, atualizado in-place.
+ * @param report Recebe a estimativa, o limite de erro e o número de termos somados.
+ */
+void collectProgress(progress_state *state, progress_report *report)
+{
+    long long dispatched = atomic_load(&table.next_chunk);
+    if (dispatched > table.num_chunks)
+    {
+        dispatched = table.num_chunks;
+    }
+
+    long double bound = 0;
+
+    for (long long i = state->low_water; i < dispatched; i++)
+    {
+        if (state->accounted[i])
+        {
+            continue;
+        }
+
+        if (atomic_load_explicit(&table.done[i], memory_order_acquire))
+        {
+            state->sum += table.sums[i];
+            if (config.fixed_point)
+            {
+                state->fixed_sum += table.fixed_sums[i];
+            }
+            state->accounted[i] = 1;
+        }
+        else
+        {
+            bound += 1.0L / (2.0L * chunkStart(i) + 1.0L);
+        }
+    }
+
+    while (state->low_water < table.num_chunks && state->accounted[state->low_water])
+    {
+        state->low_water++;
+    }
+
+    long long tail_start = dispatched < table.num_chunks ? chunkStart(dispatched) : config.total_terms;
+    bound += 1.0L / (2.0L * tail_start + 1.0L);
+
+    report->estimate = config.fixed_point ? 4 * fixedToLongDouble(state->fixed_sum) : 4 * state->sum;
+    report->error_bound = 4 * bound;
+    report->terms_done = atomic_load_explicit(&table.terms_done, memory_order_relaxed);
+}
+
+/**
+ * @fn void *partialProcessing(void *args)
+ * @brief A função de trabalho executada por cada thread.
+ *
+ * A thread retira blocos do contador `next_chunk` até que a série termine ou que
+ * uma interrupção seja pedida, calcula cada um com o kernel selecionado (ou
+ * `fixedPartialFormula`, no modo reprodutível) e publica a soma parcial na tabela de
+ * blocos. Blocos já concluídos (carregados de um checkpoint) são pulados. Ao final, exibe
+ * o tempo que passou calculando.
+ *
+ * @param args Não utilizado (NULL).
+ * @return NULL.
+ */
+void *partialProcessing(void *args)
+{
+    pthread_t tid = pthread_self();
+    (void)args;
+
+    long long chunks_computed = 0;
+    double initial_time = calcular_tempo(); // comeca a contar o tempo de inicio
+
+    while (!atomic_load_explicit(&table.stop, memory_order_relaxed))
+    {
+        long long chunk = atomic_fetch_add(&table.next_chunk, 1);
+        if (chunk >= table.num_chunks)
+        {
+            break;
+        }
+        if (atomic_load_explicit(&table.done[chunk], memory_order_relaxed))
+        {
+            continue; // bloco carregado do checkpoint
+        }
+
+        if (config.fixed_point)
+        {
+            publishChunk(chunk, 0, fixedPartialFormula(chunkStart(chunk), chunkLength(chunk)));
+        }
+        else
+        {
+            publishChunk(chunk, kernel(chunkStart(chunk), chunkLength(chunk)), 0);
+        }
+        chunks_computed++;
+    }
+
+    double end_time = calcular_tempo();          // comeca a contar o tempo de fim
+    double final_time = end_time - initial_time; // calcula p tempo final
+
+    printf("TID: %lu : %.2fs (%lld blocos)\n", (unsigned long)tid, final_time, chunks_computed); // mostrar TID e tempo empregado na thread
+
+    return NULL;
+}
+
+/**
+ * @fn void *progressReporter(void *args)
+ * @brief Thread relatora do modo streaming.
+ *
+ * A cada `report_interval` segundos monta um `progress_report`, chama o callback
+ * registrado e, se a tolerância configurada for atingida (ou o callback pedir),
+ * sinaliza `stop` para que as threads de cálculo não iniciem novos blocos.
+ * Termina quando a thread principal anuncia o fim do cálculo.
+ *
+ * @param args O instante de início do cálculo, como `double *`.
+ * @return NULL.
+ */
+void *progressReporter(void *args)
+{
+    double start_time = *((double *)args);
+    progress_state state = {calloc(table.num_chunks, 1), 0, 0, 0};
+    if (state.accounted == NULL)
+    {
+        fprintf(stderr, "Memória insuficiente; relatórios de progresso desativados\n");
+        return NULL;
+    }
+    long long last_terms = atomic_load(&table.terms_done);
+    double last_time = start_time;
+
+    while (!waitFinished(config.report_interval))
+    {
+        progress_report report;
+        collectProgress(&state, &report);
+
+        double now = calcular_tempo();
+        report.elapsed = now - start_time;
+        // Dois relatórios no mesmo instante do relógio não têm vazão mensurável.
+        report.terms_per_second = now > last_time ? (report.terms_done - last_terms) / (now - last_time) : 0;
+        last_terms = report.terms_done;
+        last_time = now;
+
+        int stop = callback != NULL && callback(&report, callback_data);
+        if (config.tolerance > 0 && report.error_bound <= config.tolerance)
+        {
+            printf("Tolerância %.3Le atingida; interrompendo o cálculo.\n", config.tolerance);
+            stop = 1;
+        }
+        if (stop)
+        {
+            atomic_store(&table.stop, 1);
+        }
+    }
+
+    free(state.accounted);
+    return NULL;
+}
+
+/**
+ * @fn int writeCheckpoint(const char *path)
+ * @brief Grava em `path` os blocos concluídos até agora e suas somas parciais.
+ *
+ * O arquivo é escrito em `path.tmp`, sincronizado com `fsync` e então renomeado sobre
+ * `path`, de modo que uma interrupção durante a escrita nunca corrompe o checkpoint
+ * anterior. Apenas os blocos cujo `done` já está publicado entram no arquivo.
+ *
+ * @return 0 em caso de sucesso, -1 em caso de erro de E/S.
+ */
+int writeCheckpoint(const char *path)
+{
+    size_t bitmap_size = (size_t)((table.num_chunks + 7) / 8);
+    unsigned char *bitmap = calloc(bitmap_size, 1);
+    size_t sum_size = config.fixed_point ? sizeof(fixed_t) : sizeof(long double);
+    unsigned char *sums = malloc(table.num_chunks * sum_size);
+    if (bitmap == NULL || sums == NULL)
+    {
+        free(bitmap);
+        free(sums);
+        return -1;
+    }
+
+    checkpoint_header header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, CHECKPOINT_MAGIC, sizeof(header.magic));
+    header.version = CHECKPOINT_VERSION;
+    header.sum_size = (uint32_t)sum_size;
+    header.fixed_point = config.fixed_point ? 1 : 0;
+    header.total_terms = config.total_terms;
+    header.chunk_terms = config.chunk_terms;
+    header.num_chunks = table.num_chunks;
+
+    for (long long i = 0; i < table.num_chunks; i++)
+    {
+        if (atomic_load_explicit(&table.done[i], memory_order_acquire))
+        {
+            bitmap[i / 8] |= (unsigned char)(1u << (i % 8));
+            const void *sum = config.fixed_point ? (const void *)&table.fixed_sums[i] : (const void *)&table.sums[i];
+            memcpy(sums + header.completed * sum_size, sum, sum_size);
+            header.completed++;
+        }
+    }
+
+    char tmp_path[4096];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+
+    int status = -1;
+    FILE *file = fopen(tmp_path, "wb");
+    if (file != NULL)
+    {
+        if (fwrite(&header, sizeof(header), 1, file) == 1 &&
+            fwrite(bitmap, 1, bitmap_size, file) == bitmap_size &&
+            fwrite(sums, sum_size, header.completed, file) == (size_t)header.completed &&
+            fflush(file) == 0 && fsync(fileno(file)) == 0)
+        {
+            status = 0;
+        }
+        if (fclose(file) != 0)
+        {
+            status = -1;
+        }
+    }
+
+    if (status == 0 && rename(tmp_path, path) != 0)
+    {
+        status = -1;
+    }
+
+    free(bitmap);
+    free(sums);
+    return status;
+}
+
+/**
+ * @fn long long loadCheckpoint(const char *path)
+ * @brief Carrega um checkpoint para a tabela de blocos.
+ *
+ * Os blocos marcados no bitmap recebem a soma gravada, são marcados como concluídos e
+ * somados a `terms_done`. O checkpoint só é aceito se foi gerado com o mesmo número de
+ * termos, o mesmo tamanho de bloco e o mesmo modo (padrão ou reprodutível) da execução corrente.
+ *
+ * @return O número de blocos carregados, ou -1 se o arquivo for inválido ou incompatível.
+ */
+long long loadCheckpoint(const char *path)
+{
+    FILE *file = fopen(path, "rb");
+    if (file == NULL)
+    {
+        return -1;
+    }
+
+    checkpoint_header header;
+    if (fread(&header, sizeof(header), 1, file) != 1 ||
+        memcmp(header.magic, CHECKPOINT_MAGIC, sizeof(header.magic)) != 0 ||
+        header.version != CHECKPOINT_VERSION || header.fixed_point != (config.fixed_point ? 1u : 0u) ||
+        header.sum_size != (config.fixed_point ? sizeof(fixed_t) : sizeof(long double)) ||
+        header.total_terms != config.total_terms || header.chunk_terms != config.chunk_terms ||
+        header.num_chunks != table.num_chunks || header.completed > header.num_chunks)
+    {
+        fclose(file);
+        return -1;
+    }
+
+    size_t bitmap_size = (size_t)((table.num_chunks + 7) / 8);
+    unsigned char *bitmap = malloc(bitmap_size);
+    long long loaded = -1;
+
+    if (bitmap != NULL && fread(bitmap, 1, bitmap_size, file) == bitmap_size)
+    {
+        loaded = 0;
+        for (long long i = 0; i < table.num_chunks && loaded >= 0; i++)
+        {
+            if (!(bitmap[i / 8] & (1u << (i % 8))))
+            {
+                continue;
+            }
+            long double sum = 0;
+            fixed_t fixed_sum = 0;
+            void *target = config.fixed_point ? (void *)&fixed_sum : (void *)&sum;
+            if (loaded == header.completed || fread(target, header.sum_size, 1, file) != 1)
+            {
+                loaded = -1;
+                break;
+            }
+            publishChunk(i, sum, fixed_sum);
+            loaded++;
+        }
+    }
+
+    free(bitmap);
+    fclose(file);
+    return loaded;
+}
+
+/**
+ * @fn void *checkpointWriter(void *args)
+ * @brief Thread que grava checkpoints periodicamente, fora do caminho das threads de cálculo.
+ *
+ * Grava um checkpoint a cada `checkpoint_interval` segundos enquanto o cálculo está
+ * em andamento. O checkpoint final é gravado pela thread principal.
+ *
+ * @param args Não utilizado (NULL).
+ * @return NULL.
+ */
+void *checkpointWriter(void *args)
+{
+    (void)args;
+
+    while (!waitFinished(config.checkpoint_interval))
+    {
+        if (writeCheckpoint(config.checkpoint_path) != 0)
+        {
+            perror("Falha ao gravar o checkpoint");
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * @fn void handleTermination(int signum)
+ * @brief Tratador de SIGINT/SIGTERM: pede que as threads parem após o bloco corrente.
+ *
+ * Assim a thread principal ainda grava o checkpoint final antes de sair.
+ */
+void handleTermination(int signum)
+{
+    (void)signum;
+    atomic_store(&table.stop, 1);
+}
+
+/**
+ * @fn void encodeMessage(const work_message *message, unsigned char *wire)
+ * @brief Serializa uma mensagem no formato de fio descrito em `work_message`.
+ */
+void encodeMessage(const work_message *message, unsigned char *wire)
+{
+    uint64_t fields[5] = {(uint64_t)message->chunk, (uint64_t)message->start_term,
+                          (uint64_t)message->num_terms, 0, 0};
+    if (message->flags & MESSAGE_FLAG_FIXED)
+    {
+        fields[3] = (uint64_t)((unsigned __int128)message->fixed_sum >> 64);
+        fields[4] = (uint64_t)message->fixed_sum;
+    }
+    else
+    {
+        double high = (double)message->sum;
+        double low = (double)(message->sum - high);
+        memcpy(&fields[3], &high, sizeof(double));
+        memcpy(&fields[4], &low, sizeof(double));
+    }
+
+    uint32_t type = htobe32(message->type);
+    uint32_t flags = htobe32(message->flags);
+    memset(wire, 0, WIRE_MESSAGE_SIZE);
+    memcpy(wire, &type, sizeof(type));
+    memcpy(wire + 4, &flags, sizeof(flags));
+    for (int i = 0; i < 5; i++)
+    {
+        uint64_t field = htobe64(fields[i]);
+        memcpy(wire + 8 + 8 * i, &field, sizeof(field));
+    }
+}
+
+/**
+ * @fn void decodeMessage(const unsigned char *wire, work_message *message)
+ * @brief Desserializa uma mensagem no formato de fio descrito em `work_message`.
+ */
+void decodeMessage(const unsigned char *wire, work_message *message)
+{
+    uint32_t type, flags;
+    uint64_t fields[5];
+    memcpy(&type, wire, sizeof(type));
+    memcpy(&flags, wire + 4, sizeof(flags));
+    for (int i = 0; i < 5; i++)
+    {
+        memcpy(&fields[i], wire + 8 + 8 * i, sizeof(fields[i]));
+        fields[i] = be64toh(fields[i]);
+    }
+
+    double high, low;
+    memcpy(&high, &fields[3], sizeof(double));
+    memcpy(&low, &fields[4], sizeof(double));
+
+    message->type = be32toh(type);
+    message->flags = be32toh(flags);
+    message->chunk = (int64_t)fields[0];
+    message->start_term = (int64_t)fields[1];
+    message->num_terms = (int64_t)fields[2];
+    message->sum = (long double)high + (long double)low;
+    message->fixed_sum = (fixed_t)(((unsigned __int128)fields[3] << 64) | fields[4]);
+}
+
+/**
+ * @fn int sendMessage(int fd, const work_message *message)
+ * @brief Envia uma mensagem completa pelo socket.
+ * @return 0 em caso de sucesso, -1 se a conexão falhou.
+ */
+int sendMessage(int fd, const work_message *message)
+{
+    unsigned char wire[WIRE_MESSAGE_SIZE];
+    encodeMessage(message, wire);
+
+    size_t sent = 0;
+    while (sent < sizeof(wire))
+    {
+        ssize_t n = send(fd, wire + sent, sizeof(wire) - sent, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (n <= 0)
+        {
+            return -1;
+        }
+        sent += (size_t)n;
+    }
+
+    return 0;
+}
+
+/**
+ * @fn int receiveMessage(int fd, work_message *message)
+ * @brief Recebe uma mensagem completa do socket, bloqueando até que ela chegue.
+ * @return 0 em caso de sucesso, -1 se a conexão foi fechada ou falhou.
+ */
+int receiveMessage(int fd, work_message *message)
+{
+    unsigned char wire[WIRE_MESSAGE_SIZE];
+    size_t received = 0;
+    while (received < sizeof(wire))
+    {
+        ssize_t n = recv(fd, wire + received, sizeof(wire) - received, 0);
+        if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (n <= 0)
+        {
+            return -1;
+        }
+        received += (size_t)n;
+    }
+
+    decodeMessage(wire, message);
+    return 0;
+}
+
+/**
+ * @fn int openSocket(const char *address, int listening)
+ * @brief Abre um socket de escuta (coordenador) ou conectado (trabalhador).
+ *
+ * `address` é `unix:CAMINHO` para um socket Unix ou `HOST:PORTA` para TCP. No modo de
+ * escuta, um socket Unix antigo no mesmo caminho é removido antes do `bind`.
+ *
+ * @return O descritor do socket, ou -1 em caso de erro.
+ */
+int openSocket(const char *address, int listening)
+{
+    if (strncmp(address, "unix:", 5) == 0)
+    {
+        struct sockaddr_un addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        if (strlen(address + 5) >= sizeof(addr.sun_path))
+        {
+            return -1;
+        }
+        strcpy(addr.sun_path, address + 5);
+
+        int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0)
+        {
+            return -1;
+        }
+
+        int status;
+        if (listening)
+        {
+            unlink(addr.sun_path);
+            status = bind(fd, (struct sockaddr *)&addr, sizeof(addr));
+            if (status == 0)
+            {
+                status = listen(fd, SOMAXCONN);
+            }
+        }
+        else
+        {
+            status = connect(fd, (struct sockaddr *)&addr, sizeof(addr));
+        }
+
+        if (status != 0)
+        {
+            close(fd);
+            return -1;
+        }
+        return fd;
+    }
+
+    const char *colon = strrchr(address, ':');
+    if (colon == NULL)
+    {
+        return -1;
+    }
+
+    char host[256];
+    size_t host_len = (size_t)(colon - address);
+    if (host_len >= sizeof(host))
+    {
+        return -1;
+    }
+    memcpy(host, address, host_len);
+    host[host_len] = '\0';
+
+    struct addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = listening ? AI_PASSIVE : 0;
+
+    struct addrinfo *list;
+    if (getaddrinfo(host_len > 0 ? host : NULL, colon + 1, &hints, &list) != 0)
+    {
+        return -1;
+    }
+
+    int fd = -1;
+    for (struct addrinfo *ai = list; ai != NULL && fd < 0; ai = ai->ai_next)
+    {
+        fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+        if (fd < 0)
+        {
+            continue;
+        }
+
+        int one = 1;
+        int status;
+        if (listening)
+        {
+            setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+            status = bind(fd, ai->ai_addr, ai->ai_addrlen);
+            if (status == 0)
+            {
+                status = listen(fd, SOMAXCONN);
+            }
+        }
+        else
+        {
+            status = connect(fd, ai->ai_addr, ai->ai_addrlen);
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        }
+
+        if (status != 0)
+        {
+            close(fd);
+            fd = -1;
+        }
+    }
+
+    freeaddrinfo(list);
+    return fd;
+}
+
+/**
+ * @fn void *rangeProcessing(void *args)
+ * @brief Thread local do trabalhador: calcula sua fatia de cada bloco até o pool ser encerrado.
+ *
+ * @param args Ponteiro para o `range_worker` desta thread.
+ * @return NULL.
+ */
+void *rangeProcessing(void *args)
+{
+    range_worker *worker = (range_worker *)args;
+    range_pool *pool = worker->pool;
+    range_task *task = &pool->tasks[worker->index];
+    pthread_mutex_lock(&pool->gate);
+    int abandoned = pool->stop;
+    pthread_mutex_unlock(&pool->gate);
+    while (!abandoned)
+    {
+        pthread_barrier_wait(&pool->start);
+        if (pool->stop)
+        {
+            break;
+        }
+        if (task->fixed_point)
+        {
+            task->fixed_sum = fixedPartialFormula(task->start_term, task->num_terms);
+        }
+        else
+        {
+            task->sum = kernel(task->start_term, task->num_terms);
+        }
+        pthread_barrier_wait(&pool->finished);
+    }
+    return NULL;
+}
+
+/**
+ * @fn int rangePoolCreate(range_pool *pool, range_worker *workers, int num_threads)
+ * @brief Cria as `num_threads` threads locais do trabalhador, que esperam pelo primeiro bloco.
+ *
+ * `workers` deve ter `num_threads` posições e viver enquanto o pool existir.
+ *
+ * @return 0 em caso de sucesso, -1 se faltar memória ou uma thread não puder ser criada.
+ */
+int rangePoolCreate(range_pool *pool, range_worker *workers, int num_threads)
+{
+    pool->threads = malloc(num_threads * sizeof(pthread_t));
+    pool->tasks = calloc(num_threads, sizeof(range_task));
+    pool->num_threads = num_threads;
+    pool->stop = 0;
+    if (pool->threads == NULL || pool->tasks == NULL)
+    {
+        free(pool->threads);
+        free(pool->tasks);
+        return -1;
+    }
+    if (pthread_barrier_init(&pool->start, NULL, num_threads + 1) != 0)
+    {
+        free(pool->threads);
+        free(pool->tasks);
+        return -1;
+    }
+    if (pthread_barrier_init(&pool->finished, NULL, num_threads + 1) != 0)
+    {
+        pthread_barrier_destroy(&pool->start);
+        free(pool->threads);
+        free(pool->tasks);
+        return -1;
+    }
+    pthread_mutex_init(&pool->gate, NULL);
+
+    pthread_mutex_lock(&pool->gate);
+    int created = 0;
+    while (created < num_threads)
+    {
+        workers[created].pool = pool;
+        workers[created].index = created;
+        if (pthread_create(&pool->threads[created], NULL, rangeProcessing, &workers[created]) != 0)
+        {
+            break;
+        }
+        created++;
+    }
+    // Sem todas as threads, as barreiras nunca completariam: as criadas saem pelo `gate`.
+    pool->stop = created < num_threads;
+    pthread_mutex_unlock(&pool->gate);
+    if (!pool->stop)
+    {
+        return 0;
+    }
+
+    for (int i = 0; i < created; i++)
+    {
+        pthread_join(pool->threads[i], NULL);
+    }
+    pthread_barrier_destroy(&pool->start);
+    pthread_barrier_destroy(&pool->finished);
+    pthread_mutex_destroy(&pool->gate);
+    free(pool->threads);
+    free(pool->tasks);
+    return -1;
+}
+
+/**
+ * @fn void rangePoolDestroy(range_pool *pool)
+ * @brief Encerra e espera as threads locais e libera o pool.
+ */
+void rangePoolDestroy(range_pool *pool)
+{
+    pool->stop = 1;
+    pthread_barrier_wait(&pool->start);
+    for (int i = 0; i < pool->num_threads; i++)
+    {
+        pthread_join(pool->threads[i], NULL);
+    }
+    pthread_barrier_destroy(&pool->start);
+    pthread_barrier_destroy(&pool->finished);
+    pthread_mutex_destroy(&pool->gate);
+    free(pool->threads);
+    free(pool->tasks);
+}
+
+/**
+ * @fn void computeRange(work_message *message, range_pool *pool)
+ * @brief Calcula o bloco de `message` dividindo-o entre as threads locais de `pool`.
+ *
+ * As fatias são somadas em ordem, de modo que o resultado não depende da ordem em que
+ * as threads terminam. Só o campo do modo do bloco é somado: `message->sum` ou, com
+ * `MESSAGE_FLAG_FIXED`, `message->fixed_sum`; o outro fica zerado.
+ */
+void computeRange(work_message *message, range_pool *pool)
+{
+    long long start_term = message->start_term;
+    long long num_terms = message->num_terms;
+    long long slice = num_terms / pool->num_threads;
+    int fixed_point = (message->flags & MESSAGE_FLAG_FIXED) != 0;
+
+    for (int i = 0; i < pool->num_threads; i++)
+    {
+        pool->tasks[i].start_term = start_term + i * slice;
+        pool->tasks[i].num_terms = (i == pool->num_threads - 1) ? num_terms - i * slice : slice;
+        pool->tasks[i].fixed_point = fixed_point;
+    }
+    pthread_barrier_wait(&pool->start);
+    pthread_barrier_wait(&pool->finished);
+
+    message->sum = 0;
+    message->fixed_sum = 0;
+    for (int i = 0; i < pool->num_threads; i++)
+    {
+        if (fixed_point)
+        {
+            message->fixed_sum += pool->tasks[i].fixed_sum;
+        }
+        else
+        {
+            message->sum += pool->tasks[i].sum;
+        }
+    }
+}
+
+/**
+ * @fn int runWorker()
+ * @brief Laço do processo trabalhador.
+ *
+ * Conecta-se ao coordenador, pede um bloco, calcula-o com as threads locais e devolve
+ * a soma parcial (o que também pede o próximo bloco), até receber `MSG_DONE` ou perder
+ * a conexão. As threads locais (`range_pool`) são criadas uma vez e atendem todos os
+ * blocos da conexão. O modo de cálculo (padrão ou reprodutível) é ditado pelas flags de cada bloco.
+ *
+ * @return EXIT_SUCCESS ao ser encerrado pelo coordenador, EXIT_FAILURE em caso de erro.
+ */
+int runWorker()
+{
+    int fd = openSocket(config.address, 0);
+    if (fd < 0)
+    {
+        fprintf(stderr, "Não foi possível conectar ao coordenador em %s\n", config.address);
+        return EXIT_FAILURE;
+    }
+
+    range_pool pool;
+    range_worker *workers = malloc(config.num_threads * sizeof(range_worker));
+    if (workers == NULL || rangePoolCreate(&pool, workers, config.num_threads) != 0)
+    {
+        fprintf(stderr, "Não foi possível alocar as threads locais do trabalhador\n");
+        free(workers);
+        close(fd);
+        return EXIT_FAILURE;
+    }
+    long long chunks_computed = 0;
+    int status = EXIT_FAILURE;
+
+    printf("Trabalhador conectado a %s, com %d threads\n", config.address, config.num_threads);
+    double initial_time = calcular_tempo();
+
+    work_message message = {MSG_REQUEST, 0, 0, 0, 0, 0, 0};
+    while (sendMessage(fd, &message) == 0 && receiveMessage(fd, &message) == 0)
+    {
+        if (message.type == MSG_DONE)
+        {
+            status = EXIT_SUCCESS;
+            break;
+        }
+        if (message.type != MSG_ASSIGN || message.num_terms <= 0)
+        {
+            break;
+        }
+
+        config.fixed_point = (message.flags & MESSAGE_FLAG_FIXED) != 0;
+        computeRange(&message, &pool);
+        message.type = MSG_RESULT;
+        chunks_computed++;
+    }
+
+    printf("Trabalhador finalizou: %lld blocos em %.2fs\n", chunks_computed, calcular_tempo() - initial_time);
+
+    rangePoolDestroy(&pool);
+    free(workers);
+    close(fd);
+    return status;
+}
+
+/**
+ * @fn long long nextChunkToAssign(long long *requeued, long long *num_requeued)
+ * @brief Escolhe o próximo bloco a entregar: primeiro os devolvidos à fila, depois os inéditos.
+ * @return O índice do bloco, ou -1 se não há bloco disponível no momento.
+ */
+long long nextChunkToAssign(long long *requeued, long long *num_requeued)
+{
+    while (*num_requeued > 0)
+    {
+        long long chunk = requeued[--(*num_requeued)];
+        if (!atomic_load(&table.done[chunk]))
+        {
+            return chunk;
+        }
+    }
+
+    while (atomic_load(&table.next_chunk) < table.num_chunks)
+    {
+        long long chunk = atomic_fetch_add(&table.next_chunk, 1);
+        if (!atomic_load(&table.done[chunk]))
+        {
+            return chunk;
+        }
+    }
+
+    return -1;
+}
+
+/**
+ * @fn void dropWorker(worker_connection *conn, long long *requeued, long long *num_requeued)
+ * @brief Fecha a conexão de um trabalhador e devolve seu bloco pendente à fila.
+ */
+void dropWorker(worker_connection *conn, long long *requeued, long long *num_requeued)
+{
+    if (conn->chunk >= 0 && !conn->expired && !atomic_load(&table.done[conn->chunk]))
+    {
+        requeued[(*num_requeued)++] = conn->chunk;
+        printf("Trabalhador perdido; bloco %lld volta para a fila\n", conn->chunk);
+    }
+    close(conn->fd);
+    conn->fd = -1;
+}
+
+/**
+ * @fn int runCoordinator()
+ * @brief Laço do coordenador: aceita trabalhadores e distribui os blocos da tabela.
+ *
+ * Um único laço com `poll` atende o socket de escuta e todos os trabalhadores. Cada
+ * resultado recebido é publicado na tabela de blocos exatamente como as threads locais
+ * fazem, de modo que a thread relatora e a de checkpoint funcionam sem alterações.
+ * Blocos de trabalhadores desconectados voltam para a fila; blocos que excedem
+ * `chunk_deadline` são reenviados a outro trabalhador e o primeiro resultado vence.
+ *
+ * @return 0 ao concluir (ou ao ser interrompido), -1 se não foi possível escutar ou se
+ * faltou memória.
+ */
+int runCoordinator()
+{
+    int listen_fd = openSocket(config.address, 1);
+    if (listen_fd < 0)
+    {
+        fprintf(stderr, "Não foi possível escutar em %s\n", config.address);
+        return -1;
+    }
+
+    long long *requeued = malloc(table.num_chunks * sizeof(long long));
+    if (requeued == NULL)
+    {
+        fprintf(stderr, "Memória insuficiente para a fila de blocos do coordenador\n");
+        close(listen_fd);
+        return -1;
+    }
+    long long num_requeued = 0;
+    worker_connection *conns = NULL;
+    int num_conns = 0;
+
+    long long completed = 0;
+    for (long long i = 0; i < table.num_chunks; i++)
+    {
+        completed += atomic_load(&table.done[i]);
+    }
+
+    int status = 0;
+    while (completed < table.num_chunks && !atomic_load(&table.stop))
+    {
+        struct pollfd *fds = calloc(num_conns + 1, sizeof(struct pollfd));
+        if (fds == NULL)
+        {
+            fprintf(stderr, "Memória insuficiente para atender %d trabalhadores\n", num_conns);
+            status = -1;
+            break;
+        }
+        fds[0].fd = listen_fd;
+        fds[0].events = POLLIN;
+        for (int i = 0; i < num_conns; i++)
+        {
+            fds[i + 1].fd = conns[i].fd;
+            fds[i + 1].events = POLLIN;
+        }
+
+        int ready = poll(fds, num_conns + 1, 100);
+        if (ready < 0 && errno != EINTR)
+        {
+            free(fds);
+            break;
+        }
+
+        for (int i = 0; ready > 0 && i < num_conns; i++)
+        {
+            worker_connection *conn = &conns[i];
+            if (!(fds[i + 1].revents & (POLLIN | POLLHUP | POLLERR)))
+            {
+                continue;
+            }
+
+            ssize_t n = recv(conn->fd, conn->buffer + conn->buffered, WIRE_MESSAGE_SIZE - conn->buffered, 0);
+            if (n <= 0)
+            {
+                if (n < 0 && errno == EINTR)
+                {
+                    continue;
+                }
+                dropWorker(conn, requeued, &num_requeued);
+                continue;
+            }
+
+            conn->buffered += (size_t)n;
+            if (conn->buffered < WIRE_MESSAGE_SIZE)
+            {
+                continue;
+            }
+            conn->buffered = 0;
+
+            work_message message;
+            decodeMessage(conn->buffer, &message);
+
+            if (message.type == MSG_RESULT && message.chunk == conn->chunk &&
+                (message.flags & MESSAGE_FLAG_FIXED) == (config.fixed_point ? MESSAGE_FLAG_FIXED : 0u))
+            {
+                if (!atomic_load(&table.done[conn->chunk]))
+                {
+                    publishChunk(conn->chunk, message.sum, message.fixed_sum);
+                    completed++;
+                }
+                conn->chunk = -1;
+                conn->waiting = 1;
+            }
+            else if (message.type == MSG_REQUEST && conn->chunk < 0)
+            {
+                conn->waiting = 1;
+            }
+            else
+            {
+                dropWorker(conn, requeued, &num_requeued); // violação de protocolo
+            }
+        }
+
+        if (fds[0].revents & POLLIN)
+        {
+            int fd = accept(listen_fd, NULL, NULL);
+            worker_connection *grown = fd >= 0 ? realloc(conns, (num_conns + 1) * sizeof(worker_connection)) : NULL;
+            if (fd >= 0 && grown == NULL)
+            {
+                // Sem memória para mais um trabalhador: recusa este e mantém os atuais.
+                fprintf(stderr, "Memória insuficiente; conexão de trabalhador recusada\n");
+                close(fd);
+            }
+            else if (fd >= 0)
+            {
+                conns = grown;
+                memset(&conns[num_conns], 0, sizeof(worker_connection));
+                conns[num_conns].fd = fd;
+                conns[num_conns].chunk = -1;
+                num_conns++;
+                printf("Trabalhador conectado (%d no total)\n", num_conns);
+            }
+        }
+        free(fds);
+
+        double now = calcular_tempo();
+        int alive = 0;
+        for (int i = 0; i < num_conns; i++)
+        {
+            worker_connection *conn = &conns[i];
+            if (conn->fd < 0)
+            {
+                continue;
+            }
+
+            if (config.chunk_deadline > 0 && conn->chunk >= 0 && !conn->expired &&
+                now - conn->assigned_at > config.chunk_deadline && !atomic_load(&table.done[conn->chunk]))
+            {
+                requeued[num_requeued++] = conn->chunk;
+                conn->expired = 1;
+                printf("Bloco %lld excedeu o prazo; reenviando\n", conn->chunk);
+            }
+
+            if (conn->waiting)
+            {
+                long long chunk = nextChunkToAssign(requeued, &num_requeued);
+                if (chunk >= 0)
+                {
+                    work_message assign = {MSG_ASSIGN, config.fixed_point ? MESSAGE_FLAG_FIXED : 0u,
+                                           chunk, chunkStart(chunk), chunkLength(chunk), 0, 0};
+                    conn->chunk = chunk;
+                    conn->assigned_at = now;
+                    conn->expired = 0;
+                    conn->waiting = 0;
+                    if (sendMessage(conn->fd, &assign) != 0)
+                    {
+                        dropWorker(conn, requeued, &num_requeued);
+                        continue;
+                    }
+                }
+            }
+
+            conns[alive++] = *conn;
+        }
+        num_conns = alive;
+    }
+
+    work_message done = {MSG_DONE, 0, 0, 0, 0, 0, 0};
+    for (int i = 0; i < num_conns; i++)
+    {
+        sendMessage(conns[i].fd, &done);
+        close(conns[i].fd);
+    }
+
+    if (strncmp(config.address, "unix:", 5) == 0)
+    {
+        unlink(config.address + 5);
+    }
+    close(listen_fd);
+    free(conns);
+    free(requeued);
+    return status;
+}
+
+/**
+ * @fn int parseArguments(int argc, char *argv[])
+ * @brief Lê as opções de linha de comando para `config`.
+ *
+ * - `-n, --termos N`: número de termos da série.
+ * - `-t, --threads N`: número de threads de cálculo.
+ * - `-b, --bloco N`: termos por bloco.
+ * - `-i, --intervalo S`: ativa o streaming com um relatório a cada S segundos.
+ * - `-e, --tolerancia E`: interrompe quando o limite de erro for menor ou igual a E
+ *   (ativa o streaming com o intervalo padrão se `-i` não for informado).
+ * - `-c, --checkpoint ARQ`: grava checkpoints periódicos em ARQ.
+ * - `-p, --checkpoint-intervalo S`: intervalo entre checkpoints em segundos.
+ * - `-r, --retomar`: carrega ARQ antes de começar e pula os blocos já concluídos.
+ * - `-C, --coordenador END`: distribui os blocos a trabalhadores que se conectam em END.
+ * - `-W, --trabalhador END`: calcula blocos recebidos do coordenador em END.
+ * - `-d, --prazo S`: no coordenador, reenvia blocos não concluídos após S segundos.
+ * - `-R, --reprodutivel`: usa o kernel em ponto fixo, com resultado idêntico bit a bit.
+ * - `-k, --kernel NOME`: usa a variante NOME do kernel.
+ * - `-A, --autoajuste`: mede as variantes e usa a mais rápida.
+ * - `-P, --precisao P`: precisão considerada pelo auto-ajuste (`float`, `double`,
+ *   `longdouble`, `quad` ou `rcp`).
+ * - `-L, --listar-kernels`: lista as variantes disponíveis e sai.
+ * - `-V, --verificar-rcp`: roda o teste de precisão das variantes com recíproco e sai
+ *   com status diferente de zero em caso de falha.
+ *
+ * END é `unix:CAMINHO` ou `HOST:PORTA`.
+ *
+ * @return 0 em caso de sucesso, -1 se alguma opção for inválida.
+ */
+int parseArguments(int argc, char *argv[])
+{
+    static const struct option options[] = {
+        {"termos", required_argument, NULL, 'n'},
+        {"threads", required_argument, NULL, 't'},
+        {"bloco", required_argument, NULL, 'b'},
+        {"intervalo", required_argument, NULL, 'i'},
+        {"tolerancia", required_argument, NULL, 'e'},
+        {"checkpoint", required_argument, NULL, 'c'},
+        {"checkpoint-intervalo", required_argument, NULL, 'p'},
+        {"retomar", no_argument, NULL, 'r'},
+        {"coordenador", required_argument, NULL, 'C'},
+        {"trabalhador", required_argument, NULL, 'W'},
+        {"prazo", required_argument, NULL, 'd'},
+        {"reprodutivel", no_argument, NULL, 'R'},
+        {"kernel", required_argument, NULL, 'k'},
+        {"autoajuste", no_argument, NULL, 'A'},
+        {"precisao", required_argument, NULL, 'P'},
+        {"listar-kernels", no_argument, NULL, 'L'},
+        {"verificar-rcp", no_argument, NULL, 'V'},
+        {NULL, 0, NULL, 0}};
+
+    int opt;
+    while ((opt = getopt_long(argc, argv, "n:t:b:i:e:c:p:rC:W:d:Rk:AP:LV", options, NULL)) != -1)
+    {
+        switch (opt)
+        {
+        case 'n':
+            config.total_terms = (long long)strtod(optarg, NULL);
+            break;
+        case 't':
+            config.num_threads = atoi(optarg);
+            break;
+        case 'b':
+            config.chunk_terms = (long long)strtod(optarg, NULL);
+            break;
+        case 'i':
+            config.report_interval = strtod(optarg, NULL);
+            break;
+        case 'e':
+            config.tolerance = strtold(optarg, NULL);
+            break;
+        case 'c':
+            config.checkpoint_path = optarg;
+            break;
+        case 'p':
+            config.checkpoint_interval = strtod(optarg, NULL);
+            break;
+        case 'r':
+            config.resume = 1;
+            break;
+        case 'C':
+            config.mode = MODE_COORDINATOR;
+            config.address = optarg;
+            break;
+        case 'W':
+            config.mode = MODE_WORKER;
+            config.address = optarg;
+            break;
+        case 'd':
+            config.chunk_deadline = strtod(optarg, NULL);
+            break;
+        case 'R':
+            config.fixed_point = 1;
+            break;
+        case 'k':
+            config.kernel_name = optarg;
+            break;
+        case 'A':
+            config.autotune = 1;
+            break;
+        case 'P':
+            config.precision = optarg;
+            break;
+        case 'L':
+            for (int i = 0; i < NUM_KERNEL_VARIANTS; i++)
+            {
+                printf("%-18s %-10s desenrolamento %d, %d acumuladores\n", kernel_variants[i].name,
+                       kernel_variants[i].precision, kernel_variants[i].unroll, kernel_variants[i].accumulators);
+            }
+            exit(EXIT_SUCCESS);
+        case 'V':
+            exit(verifyReciprocalKernels());
+        default:
+            return -1;
+        }
+    }
+
+    if (config.tolerance > 0 && config.report_interval <= 0)
+    {
+        config.report_interval = REPORT_INTERVAL;
+    }
+
+    if (config.total_terms <= 0 || config.num_threads <= 0 || config.chunk_terms <= 0 ||
+        config.report_interval < 0 || config.tolerance < 0 || config.checkpoint_interval <= 0 ||
+        (config.resume && config.checkpoint_path == NULL) || config.chunk_deadline < 0)
+    {
+        return -1;
+    }
+
+    return 0;
+}
+
+/**
+ * @fn int main(int argc, char *argv[])
+ * @brief Ponto de entrada principal do programa.
+ *
+ * No modo trabalhador, apenas executa `runWorker`. Nos demais, a função `main`
+ * lê a configuração, prepara a tabela de blocos, cria e gerencia as
+ * threads, mede o tempo total de execução e exibe o resultado final.
+ * - Lê as opções de linha de comando e escolhe o kernel.
+ * - Aloca a tabela de blocos e, na retomada, carrega o checkpoint.
+ * - Inicia a contagem do tempo total.
+ * - Cria as threads de cálculo (ou, no coordenador, atende os trabalhadores) e, conforme
+ *   a configuração, a relatora e a de checkpoint.
+ * - Aguarda a conclusão do cálculo e acorda as threads auxiliares.
+ * - Grava o checkpoint final.
+ * - Soma os blocos concluídos, em ordem de índice, para obter o resultado.
+ * - Imprime o valor aproximado de Pi e o tempo total de execução.
+ *
+ * @return EXIT_SUCCESS em caso de sucesso, EXIT_FAILURE se a configuração for inválida.
+ */
+int main(int argc, char *argv[])
+{
+    if (parseArguments(argc, argv) != 0)
+    {
+        fprintf(stderr, "Uso: %s [-n termos] [-t threads] [-b bloco] [-i intervalo] [-e tolerancia]\n"
+                        "       [-R | -k kernel | -A [-P precisao] | -L | -V]\n"
+                        "       [-c arquivo [-p intervalo] [-r]] [-C endereco [-d prazo] | -W endereco]\n",
+                argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    if (selectKernel() != 0)
+    {
+        fprintf(stderr, "Kernel ou precisão inexistente; use -L para listar as variantes\n");
+        return EXIT_FAILURE;
+    }
+
+    if (config.mode == MODE_WORKER)
+    {
+        return runWorker();
+    }
+
+    if (initChunkTable() != 0)
+    {
+        fprintf(stderr, "Memória insuficiente para %lld blocos\n", table.num_chunks);
+        return EXIT_FAILURE;
+    }
+
+    if (config.resume)
+    {
+        long long loaded = loadCheckpoint(config.checkpoint_path);
+        if (loaded < 0)
+        {
+            fprintf(stderr, "Checkpoint %s ausente, inválido ou de outra configuração\n", config.checkpoint_path);
+            destroyChunkTable();
+            return EXIT_FAILURE;
+        }
+        printf("Retomando de %s: %lld de %lld blocos já concluídos\n",
+               config.checkpoint_path, loaded, table.num_chunks);
+    }
+
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = handleTermination;
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+
+    pthread_condattr_t cond_attr;
+    pthread_condattr_init(&cond_attr);
+    pthread_condattr_setclock(&cond_attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&finished_cond, &cond_attr);
+    pthread_condattr_destroy(&cond_attr);
+
+    registerProgressCallback(printProgress, NULL);
+
+    // criar as threads (o coordenador não calcula blocos localmente)
+    int num_threads = config.mode == MODE_COORDINATOR ? 0 : config.num_threads;
+    pthread_t *thread = arenaCreate(num_threads * sizeof(pthread_t)) == 0
+                            ? arenaAlloc(num_threads * sizeof(pthread_t))
+                            : NULL;
+    if (thread == NULL)
+    {
+        fprintf(stderr, "Erro: memória insuficiente para %d threads\n", num_threads);
+        arenaDestroy();
+        pthread_cond_destroy(&finished_cond);
+        destroyChunkTable();
+        return EXIT_FAILURE;
+    }
+    pthread_t reporter;
+    pthread_t checkpointer;
+    int streaming = config.report_interval > 0;
+    int checkpointing = config.checkpoint_path != NULL;
+
+    // começamos a calcular o tempo de inicio do procesamento
+    if (config.mode == MODE_COORDINATOR)
+    {
+        printf("Coordenando o cálculo de pi da série de Leibniz em %s\n", config.address);
+    }
+    else
+    {
+        printf("Começando a calcular o valor de pi da série de Leibniz, com %d threads\n", config.num_threads);
+    }
+    double total_start_time = calcular_tempo();
+
+    for (int i = 0; i < num_threads; ++i)
+    {
+        pthread_create(&thread[i], NULL, partialProcessing, NULL);
+    }
+
+    if (streaming)
+    {
+        pthread_create(&reporter, NULL, progressReporter, &total_start_time);
+    }
+
+    if (checkpointing)
+    {
+        pthread_create(&checkpointer, NULL, checkpointWriter, NULL);
+    }
+
+    int status = EXIT_SUCCESS;
+    if (config.mode == MODE_COORDINATOR && runCoordinator() != 0)
+    {
+        status = EXIT_FAILURE;
+    }
+
+    for (int i = 0; i < num_threads; ++i)
+    {
+        pthread_join(thread[i], NULL);
+    }
+
+    pthread_mutex_lock(&finished_mutex);
+    finished = 1;
+    pthread_cond_broadcast(&finished_cond);
+    pthread_mutex_unlock(&finished_mutex);
+
+    if (streaming)
+    {
+        pthread_join(reporter, NULL);
+    }
+
+    if (checkpointing)
+    {
+        pthread_join(checkpointer, NULL);
+        if (writeCheckpoint(config.checkpoint_path) != 0)
+        {
+            perror("Falha ao gravar o checkpoint final");
+        }
+    }
+
+    double total_time_end = calcular_tempo();
+    double total_final_time = total_time_end - total_start_time;
+
+    progress_state state = {calloc(table.num_chunks, 1), 0, 0, 0};
+    if (state.accounted == NULL)
+    {
+        fprintf(stderr, "Erro: memória insuficiente para consolidar o resultado\n");
+        arenaDestroy();
+        pthread_cond_destroy(&finished_cond);
+        destroyChunkTable();
+        return EXIT_FAILURE;
+    }
+    progress_report report;
+    collectProgress(&state, &report);
+    result = report.estimate;
+
+    printf("\nValor aproximado de pi: %.15Lf\n", result);
+    if (config.fixed_point)
+    {
+        unsigned __int128 bits = (unsigned __int128)state.fixed_sum;
+        printf("Soma exata em ponto fixo (Q7.%d): 0x%016llx%016llx\n", FIXED_FRACTION_BITS,
+               (unsigned long long)(bits >> 64), (unsigned long long)bits);
+    }
+    if (report.terms_done < config.total_terms)
+    {
+        printf("Termos somados: %lld de %lld (erro <= %.3Le)\n",
+               report.terms_done, config.total_terms, report.error_bound);
+    }
+    printf("Tempo total de execução: %.2fs\n", total_final_time);
+
+    free(state.accounted);
+    arenaDestroy();
+    pthread_cond_destroy(&finished_cond);
+    destroyChunkTable();
+
+    return status;
+}
@@ -3,10 +3,10 @@
  * @brief Simulação do problema Produtor-Consumidor usando pthreads, semáforos e variáveis de condição.
  *
  * Este programa implementa uma solução para o problema clássico do produtor-consumidor.
- * Ele simula um cenário com múltiplos "caixas" (produtores) que geram vendas (valores de ponto flutuante)
- * e as colocam em um buffer circular compartilhado. Um único "gerente" (consumidor) aguarda
- * até que o buffer esteja completamente cheio para então processar todas as vendas de uma vez,
- * calculando o valor médio.
+ * Ele simula um cenário com múltiplos "caixas" (produtores) que geram vendas (registros `sale_record`,
+ * com valores em centavos inteiros) e as colocam em um buffer circular compartilhado. Um único
+ * "gerente" (consumidor) aguarda até que o buffer esteja completamente cheio para então processar
+ * todas as vendas de uma vez, calculando o valor médio.
  *
  * A sincronização entre as threads é gerenciada da seguinte forma:
  * - **Mutex (`mutex`):** Garante o acesso exclusivo às seções críticas, protegendo o buffer
@@ -16,12 +16,19 @@
  *   a solução clássica, embora o consumidor neste exemplo específico não espere por um único item.
  * - **Variável de Condição (`buffer_full_cond`):** Permite que o consumidor (gerente) espere de forma eficiente
  *   sem consumir CPU (`pthread_cond_wait`) até que o buffer esteja cheio ou que todos os produtores
- *   tenham terminado seu trabalho. Os produtores sinalizam (`pthread_cond_signal`) quando o buffer enche,
- *   e um `broadcast` é usado no final para garantir que o consumidor acorde e termine.
+ *   tenham terminado seu trabalho. Os produtores sinalizam (`pthread_cond_signal`) quando o buffer enche.
+ * - **Fechamento (`closed`):** depois que todos os produtores terminam, `main` chama `bufferClose`
+ *   uma única vez; o gerente processa o que restou no buffer e termina.
+ *
+ * Os argumentos dos caixas ficam em um único vetor, alocado por `main` antes de criar as
+ * threads e liberado depois de esperar por todas.
  */
 
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
+#include <inttypes.h>
 #include <pthread.h>
 #include <semaphore.h>
 #include <unistd.h>
@@ -45,6 +52,43 @@
  */
 #define NUM_CONSUMERS 1
 
+/**
+ * @struct sale_record
+ * @brief Registro de venda de tamanho fixo transportado pelo buffer.
+ *
+ * O valor é guardado em centavos inteiros para que somas e médias não acumulem erros de
+ * arredondamento de ponto flutuante. O registro ocupa 32 bytes alinhados em 32, de modo
+ * que nunca atravessa a fronteira de uma linha de cache de 64 bytes: cada inserção ou
+ * remoção no buffer copia no máximo uma linha. Todos os campos têm largura fixa, o que
+ * permite guardá-los também em colunas separadas (ver `sale_columns`).
+ */
+typedef struct
+{
+    _Alignas(32) int64_t timestamp_ns; /**< Instante da venda (CLOCK_REALTIME), em nanossegundos. */
+    int64_t amount_cents;              /**< Valor da venda em centavos. */
+    uint32_t register_id;              /**< Identificador do caixa que registrou a venda. */
+    uint32_t sku;                      /**< Código do produto vendido. */
+    uint8_t reserved[8];               /**< Reservado; completa o registro até 32 bytes. */
+} sale_record;
+
+_Static_assert(sizeof(sale_record) == 32, "sale_record deve ocupar meia linha de cache");
+
+/**
+ * @struct sale_columns
+ * @brief Lote de vendas em formato de colunas (struct-of-arrays).
+ *
+ * Usado pelo gerente para processar um buffer cheio: cada coluna é contígua, de modo que
+ * agregações sobre um único campo (como a soma dos valores) percorrem só os bytes que usam.
+ */
+typedef struct
+{
+    int64_t timestamp_ns[BUFFER_SIZE]; /**< Coluna `sale_record::timestamp_ns`. */
+    int64_t amount_cents[BUFFER_SIZE]; /**< Coluna `sale_record::amount_cents`. */
+    uint32_t register_id[BUFFER_SIZE]; /**< Coluna `sale_record::register_id`. */
+    uint32_t sku[BUFFER_SIZE];         /**< Coluna `sale_record::sku`. */
+    int count;                         /**< Número de vendas no lote. */
+} sale_columns;
+
 /**
  * @struct producer_args
  * @brief Estrutura para encapsular os argumentos a serem passados para cada thread produtora.
@@ -62,9 +106,9 @@ typedef struct
 
 /**
  * @var buffer
- * @brief Array de doubles que funciona como o buffer circular compartilhado para armazenar os valores das vendas.
+ * @brief Array de registros que funciona como o buffer circular compartilhado para armazenar as vendas.
  */
-double buffer[BUFFER_SIZE];
+sale_record buffer[BUFFER_SIZE];
 
 /**
  * @var count
@@ -114,19 +158,45 @@ pthread_cond_t buffer_full_cond;
  */
 int active_producers = NUM_PRODUCERS;
 
+/**
+ * @var closed
+ * @brief Diferente de zero depois de `bufferClose`; protegido por `mutex`, como `count`.
+ */
+int closed = 0;
+
+/**
+ * @fn sale_record makeSale(int register_id)
+ * @brief Gera uma venda aleatória para o caixa `register_id`.
+ *
+ * O valor fica entre R$ 1,00 e R$ 1000,99, como na simulação original, e o instante é
+ * lido de CLOCK_REALTIME.
+ */
+sale_record makeSale(int register_id)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+
+    sale_record sale = {0};
+    sale.timestamp_ns = (int64_t)now.tv_sec * 1000000000LL + now.tv_nsec;
+    sale.amount_cents = rand() % 100000 + 100;
+    sale.register_id = (uint32_t)register_id;
+    sale.sku = (uint32_t)(rand() % 100000);
+    return sale;
+}
+
 /**
  * @fn void *producer(void *args)
  * @brief Função executada pelas threads produtoras (caixas).
  *
  * Cada produtor gera um número pré-definido de vendas com valores aleatórios.
  * Para cada venda, ele aguarda por um slot vazio no buffer (`sem_wait`), bloqueia o mutex,
- * adiciona o valor da venda ao buffer, atualiza os contadores e o índice de entrada.
+ * copia o registro da venda para o buffer, atualiza os contadores e o índice de entrada.
  * Se o buffer ficar cheio após a inserção, ele sinaliza a variável de condição `buffer_full_cond`
- * para acordar o gerente. Após produzir todas as suas vendas, decrementa o contador `active_producers`
- * e, se for o último produtor a terminar, envia um `broadcast` na variável de condição para garantir
- * que o consumidor processe os itens restantes e termine.
+ * para acordar o gerente. Após produzir todas as suas vendas, decrementa o contador `active_producers`,
+ * usado apenas na mensagem; o término do gerente é decidido por `bufferClose`.
  *
- * @param args Um ponteiro para uma estrutura `producer_args` contendo o ID da thread e o número de vendas a produzir.
+ * @param args Um ponteiro para uma estrutura `producer_args` contendo o ID da thread e o número de vendas a produzir,
+ *             que pertence ao vetor de `main`; a thread não a libera.
  * @return NULL.
  */
 void *producer(void *args)
@@ -135,20 +205,21 @@ void *producer(void *args)
     int tid = p_args->thread_id;
     int sales_to_produce = p_args->num_sales;
 
-    for (size_t i = 0; i < sales_to_produce; i++)
+    for (int i = 0; i < sales_to_produce; i++)
     {
-        double sale_value = (rand() % 100000) / 100.0 + 1.0; // Gera um valor de venda aleatório entre 1.00 e 1000.00
+        sale_record sale = makeSale(tid); // Gera uma venda aleatória entre R$ 1.00 e R$ 1000.99
 
         sem_wait(&empty_slots);
 
         pthread_mutex_lock(&mutex);
 
-        buffer[in_idx] = sale_value;
+        buffer[in_idx] = sale;
         in_idx = (in_idx + 1) % BUFFER_SIZE;
         count++;
 
-        printf("(P) TID %ld | Caixa %d | VENDA: R$ %.2f | ITERAÇÃO: %d/%d | Buffer: %d/%d\n",
-               pthread_self(), tid, sale_value, i + 1, sales_to_produce, count, BUFFER_SIZE);
+        printf("(P) TID %ld | Caixa %d | VENDA: R$ %" PRId64 ".%02" PRId64 " | SKU %" PRIu32 " | ITERAÇÃO: %d/%d | Buffer: %d/%d\n",
+               pthread_self(), tid, sale.amount_cents / 100, sale.amount_cents % 100, sale.sku, i + 1,
+               sales_to_produce, count, BUFFER_SIZE);
 
         if (count == BUFFER_SIZE)
         {
@@ -168,14 +239,8 @@ void *producer(void *args)
 
     printf("(P) TID %ld | Caixa %d finalizou sua produção. Produtores ativos: %d\n",
            pthread_self(), tid, active_producers);
-
-    if (active_producers == 0)
-    {
-        pthread_cond_broadcast(&buffer_full_cond);
-    }
     pthread_mutex_unlock(&mutex);
 
-    free(p_args);
     pthread_exit(NULL);
 }
 
@@ -185,11 +250,12 @@ void *producer(void *args)
  *
  * O consumidor entra em um loop infinito para processar as vendas. Ele bloqueia o mutex e aguarda
  * na variável de condição (`pthread_cond_wait`) até que o buffer esteja cheio (`count == BUFFER_SIZE`)
- * ou não haja mais produtores ativos (`active_producers == 0`).
- * Quando acordado e a condição é satisfeita, ele processa *todos* os itens presentes no buffer,
- * calculando a soma e a média. Em seguida, ele zera o contador de itens e libera os slots
+ * ou o buffer seja fechado (`closed`).
+ * Quando acordado e a condição é satisfeita, ele copia *todos* os itens presentes no buffer para
+ * um lote em colunas (`sale_columns`), zera o contador de itens e libera o mutex; a soma e a média
+ * são calculadas sobre a coluna de valores já fora da seção crítica. Em seguida, libera os slots
  * correspondentes no semáforo `empty_slots`.
- * O loop termina quando não há mais produtores ativos e o buffer está vazio.
+ * O loop termina quando o buffer está fechado e vazio.
  *
  * @param args Não utilizado (NULL).
  * @return NULL.
@@ -202,14 +268,14 @@ void *consumer(void *args)
     {
         pthread_mutex_lock(&mutex);
 
-        while (count < BUFFER_SIZE && active_producers > 0)
+        while (count < BUFFER_SIZE && !closed)
         {
             printf("(C) TID %ld | Gerente esperando o buffer encher (Atual: %d/%d)...\n",
                    pthread_self(), count, BUFFER_SIZE);
             pthread_cond_wait(&buffer_full_cond, &mutex);
         }
 
-        if (active_producers == 0 && count == 0)
+        if (closed && count == 0)
         {
             pthread_mutex_unlock(&mutex);
             break;
@@ -220,23 +286,34 @@ void *consumer(void *args)
             printf("(C) TID %ld | Gerente iniciando processamento de %d vendas. ITERAÇÃO: %d\n",
                    pthread_self(), count, iteration);
 
-            double total_sum = 0.0;
-            int items_consumed = count;
+            sale_columns batch;
+            batch.count = count;
 
-            for (int i = 0; i < items_consumed; i++)
+            for (int i = 0; i < batch.count; i++)
             {
-                double sale_value = buffer[out_idx];
-                total_sum += sale_value;
+                const sale_record *sale = &buffer[out_idx];
+                batch.timestamp_ns[i] = sale->timestamp_ns;
+                batch.amount_cents[i] = sale->amount_cents;
+                batch.register_id[i] = sale->register_id;
+                batch.sku[i] = sale->sku;
                 out_idx = (out_idx + 1) % BUFFER_SIZE;
             }
             count = 0;
-
-            double average = total_sum / items_consumed;
-            printf("(C) TID %ld | MÉDIA das %d vendas: R$ %.2f | ITERAÇÃO: %d\n",
-                   pthread_self(), items_consumed, average, iteration++);
+            int items_consumed = batch.count;
+            int current_iteration = iteration++;
 
             pthread_mutex_unlock(&mutex);
 
+            int64_t total_cents = 0;
+            for (int i = 0; i < batch.count; i++)
+            {
+                total_cents += batch.amount_cents[i];
+            }
+
+            double average = (double)total_cents / items_consumed / 100.0;
+            printf("(C) TID %ld | MÉDIA das %d vendas: R$ %.2f (total R$ %" PRId64 ".%02" PRId64 ") | ITERAÇÃO: %d\n",
+                   pthread_self(), items_consumed, average, total_cents / 100, total_cents % 100, current_iteration);
+
             for (int i = 0; i < items_consumed; i++)
             {
                 sem_post(&empty_slots);
@@ -252,13 +329,32 @@ void *consumer(void *args)
     pthread_exit(NULL);
 }
 
+/**
+ * @fn void bufferClose(void)
+ * @brief Fecha o buffer depois que todos os produtores terminaram.
+ *
+ * Liga `closed` e acorda o gerente uma única vez; ele processa as vendas restantes, mesmo
+ * que não encham o buffer, e termina. Chamadas repetidas não têm efeito.
+ */
+void bufferClose(void)
+{
+    pthread_mutex_lock(&mutex);
+    if (!closed)
+    {
+        closed = 1;
+        pthread_cond_broadcast(&buffer_full_cond);
+    }
+    pthread_mutex_unlock(&mutex);
+}
+
 /**
  * @fn int main()
  * @brief Ponto de entrada principal do programa.
  *
  * Inicializa o gerador de números aleatórios, o mutex, a variável de condição e os semáforos.
  * Cria o número especificado de threads produtoras e consumidoras, passando os argumentos necessários.
- * Aguarda a conclusão de todas as threads produtoras e consumidoras usando `pthread_join`.
+ * Aguarda a conclusão das threads produtoras, fecha o buffer (`bufferClose`) e aguarda as
+ * consumidoras usando `pthread_join`.
  * Por fim, destrói os primitivos de sincronização (mutex, cond, semáforos) e exibe uma mensagem de conclusão.
  *
  * @return 0 em caso de sucesso.
@@ -280,12 +376,19 @@ int main()
     printf("Configuração: %d Produtores (Caixas), %d Consumidor (Gerente), Tamanho do Buffer: %d\n\n",
            NUM_PRODUCERS, NUM_CONSUMERS, BUFFER_SIZE);
 
+    // Um único vetor para os argumentos de todos os caixas, em vez de um malloc por thread.
+    producer_args *args = malloc(NUM_PRODUCERS * sizeof(producer_args));
+    if (args == NULL)
+    {
+        perror("Erro ao alocar os argumentos dos produtores");
+        return 1;
+    }
+
     for (size_t i = 0; i < NUM_PRODUCERS; i++)
     {
-        producer_args *args = malloc(sizeof(producer_args));
-        args->thread_id = i + 1;
-        args->num_sales = (rand() % 11) + 20; // Cada produtor fará entre 20 e 30 vendas
-        pthread_create(&producers[i], NULL, producer, (void *)args);
+        args[i].thread_id = i + 1;
+        args[i].num_sales = (rand() % 11) + 20; // Cada produtor fará entre 20 e 30 vendas
+        pthread_create(&producers[i], NULL, producer, (void *)&args[i]);
     }
 
     for (size_t i = 0; i < NUM_CONSUMERS; i++)
@@ -298,6 +401,8 @@ int main()
         pthread_join(producers[i], NULL);
     }
 
+    bufferClose();
+
     for (size_t i = 0; i < NUM_CONSUMERS; i++)
     {
         pthread_join(consumers[i], NULL);
@@ -307,6 +412,7 @@ int main()
     pthread_cond_destroy(&buffer_full_cond);
     sem_destroy(&empty_slots);
     sem_destroy(&full_slots);
+    free(args);
 
     printf("\n--- Simulação Concluída ---\n");
 
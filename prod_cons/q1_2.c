@@ -4,28 +4,95 @@
  *
  * Este programa implementa uma solução para o problema clássico do Produtor-Consumidor
  * utilizando múltiplas threads para produtores (caixas de uma loja) e consumidores (gerentes).
- * A comunicação entre eles é feita através de um buffer circular compartilhado.
+ * A comunicação entre eles é feita através de um anel compartilhado de registros de venda
+ * (`sale_record`), com valores em centavos inteiros.
+ *
+ * O anel (`sales_ring`) não copia registros: o produtor reserva uma posição com `ringClaim`,
+ * escreve a venda diretamente nela e a publica com `ringCommit`; o consumidor obtém um
+ * ponteiro para a próxima venda publicada com `ringPeek`, lê os campos no lugar e devolve a
+ * posição com `ringRelease`. Cada registro é escrito e lido exatamente uma vez.
+ *
+ * Com `--topologia faixas`, cada caixa tem sua própria faixa SPSC (`sales_lane`) e os
+ * gerentes leem das faixas que lhes foram atribuídas, em round-robin ou com pesos; não há
+ * disputa entre produtores. A ordem é garantida apenas dentro de cada faixa. Com
+ * `--topologia lojas`, as vendas são particionadas pelo hash da loja e cada partição tem um
+ * gerente dono, com migração de partições quando uma delas fica quente (ver `shard_set`).
+ * Com a fila cheia, `--transbordo` escolhe entre bloquear o caixa, descartar a venda mais
+ * antiga ou a nova, ou gravá-la em um arquivo mapeado que os gerentes esvaziam depois.
+ * Todas as esperas têm variantes sem bloqueio (`salesTryClaim`, `salesTryPeek`) e com prazo
+ * absoluto em CLOCK_MONOTONIC (`salesClaimUntil`, `salesPeekUntil`); `--prazo-ms` limita
+ * com elas a espera de caixas e gerentes. Com `--janela-ms`, os gerentes alimentam uma
+ * análise em janelas de tempo fixas e deslizantes (`sales_analytics`). Com `--memoria`, o
+ * anel fica em memória compartilhada (`shm_open`) e caixas e gerentes podem rodar em
+ * processos separados (`--papel`). `--servidor` recebe as vendas de clientes de rede locais
+ * (TCP ou Unix) com epoll e as publica no anel em lotes; `--cliente` gera essa carga.
+ * `--servico` roda sem fim, com caixas e gerentes acrescentados ou retirados por um socket
+ * de controle ou por sinais, e `--autoescala` ajusta os gerentes pela fila e pela latência.
+ * Os contextos das threads de cada execução vêm de uma arena com um único `malloc`;
+ * compilado com `-DCOUNT_MALLOC` (nunca junto com `-fsanitize`), o programa também conta e
+ * relata as chamadas de alocação das threads de trabalho. A topologia `prioridades` lê
+ * estornos e vendas de valor alto antes das demais, e a `segmentada` absorve rajadas sem
+ * bloquear os caixas, com segmentos reaproveitados. `--pipeline` troca a simulação por um
+ * pipeline de estágios (ingestão, validação, agregação e persistência), cada um com suas
+ * threads, ligados por anéis limitados (`pipeline_stage`). Com `--replay`, as vendas vêm de
+ * um arquivo gravado (binário ou CSV, ver `sales_replay`) em vez de `rand()`, respeitando
+ * os intervalos originais divididos por `--velocidade`. Com `--colunar`, as vendas
+ * processadas pelos gerentes são gravadas em blocos de colunas comprimidas por uma thread
+ * de escrita dedicada (`sales_sink`), com io_uring ou, se ele não estiver disponível, com
+ * uma thread de `pwrite`.
  *
  * A sincronização é gerenciada pelos seguintes primitivos:
- * - Mutex (`mutex`): Garante acesso exclusivo ao buffer compartilhado e às variáveis
- *   de controle (`count`, `in_idx`, `out_idx`, `active_producers`), prevenindo condições de corrida.
- * - Semáforo (`empty_slots`): Controla o número de posições vazias no buffer. Produtores
- *   esperam neste semáforo se o buffer estiver cheio.
- * - Semáforo (`full_slots`): Controla o número de itens disponíveis no buffer. Consumidores
- *   esperam neste semáforo se o buffer estiver vazio.
+ * - Sequência por posição (`ring_slot.sequence`): indica se a posição está livre para a
+ *   volta atual do produtor ou já publicada para o consumidor, permitindo que vários
+ *   produtores e consumidores trabalhem em posições distintas sem bloqueio.
+ * - Semáforo (`empty_slots`, um `wait_sem`): Controla o número de posições vazias no anel. Produtores
+ *   esperam neste semáforo se o anel estiver cheio.
+ * - Semáforo (`full_slots`, um `wait_sem`): Controla o número de itens disponíveis no anel. Consumidores
+ *   esperam neste semáforo se o anel estiver vazio.
+ * - Mutex (`mutex`): Protege apenas o contador `active_producers`.
  *
- * A lógica de término é coordenada pela variável `active_producers`. Cada produtor, ao
- * concluir seu trabalho, decrementa este contador. O último produtor a terminar notifica
- * todas as threads consumidoras (via `sem_post`) para que elas possam verificar a condição
- * de término (não há produtores ativos e o buffer está vazio) e encerrar sua execução.
+ * A forma de esperar por uma ficha é escolhida em tempo de execução (`--espera`): semáforo
+ * POSIX, espera ativa, espera ativa seguida de futex, ou eventfd utilizável com epoll
+ * (ver `wait_sem`). `--benchmark` compara a latência e o uso de CPU de cada estratégia.
+ *
+ * O término é uma operação das próprias filas: depois que todos os produtores terminam,
+ * `main` chama `salesClose` uma única vez. O fechamento é um bit na mesma palavra atômica
+ * que conta as vendas disponíveis (`sales_ring.available`) e nas palavras de fichas dos
+ * `wait_sem`; ele acorda cada thread em espera exatamente uma vez, e os gerentes continuam
+ * lendo até esvaziar as filas antes de encerrar. `active_producers` só é usado nas mensagens.
  */
 
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <errno.h>
+#include <getopt.h>
 #include <pthread.h>
 #include <semaphore.h>
+#include <sched.h>
+#include <stdatomic.h>
 #include <unistd.h>
 #include <time.h>
+#include <linux/futex.h>
+#include <linux/io_uring.h>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/mman.h>
+#include <sys/signalfd.h>
+#include <sys/timerfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <signal.h>
+#include <sys/stat.h>
+#include <sys/eventfd.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
 
 /**
  * @def BUFFER_SIZE
@@ -43,229 +110,7818 @@
  * @def NUM_CONSUMERS
  * @brief Define o número de threads consumidoras (gerentes) a serem criadas.
  */
-#define NUM_CONSUMERS 2
+#define NUM_CONSUMERS 2
+
+/**
+ * @def NUM_STORES
+ * @brief Número de lojas às quais os caixas pertencem.
+ */
+#define NUM_STORES 4
+
+/**
+ * @def NUM_SHARDS
+ * @brief Número de partições da topologia por loja.
+ */
+#define NUM_SHARDS 4
+
+/**
+ * @def HOT_SHARD_BACKLOG
+ * @brief Ocupação a partir da qual uma partição é considerada quente.
+ */
+#define HOT_SHARD_BACKLOG (BUFFER_SIZE - 1)
+
+/**
+ * @def REBALANCE_EVERY
+ * @brief Vendas processadas por um gerente entre duas verificações de rebalanceamento.
+ */
+#define REBALANCE_EVERY 32
+
+/**
+ * @def REBALANCE_COOLDOWN_NS
+ * @brief Intervalo mínimo entre duas migrações de partição, em nanossegundos.
+ */
+#define REBALANCE_COOLDOWN_NS 50000000LL
+
+/**
+ * @def NUM_PRIORITIES
+ * @brief Níveis de prioridade da topologia de prioridades (`sale_priority`).
+ */
+#define NUM_PRIORITIES 3
+
+/**
+ * @def PRIORITY_HIGH_CENTS
+ * @brief Valor padrão, em centavos, a partir do qual uma venda tem prioridade alta.
+ */
+#define PRIORITY_HIGH_CENTS 90000
+
+/**
+ * @def SEGMENT_SLOTS
+ * @brief Posições de cada segmento da fila segmentada.
+ */
+#define SEGMENT_SLOTS 1024
+
+/**
+ * @def SEGMENT_DIRECTORY
+ * @brief Entradas do diretório de segmentos da fila segmentada; limita os segmentos vivos
+ * (16384 segmentos de 64 KiB, 1 GiB).
+ */
+#define SEGMENT_DIRECTORY 16384
+
+/**
+ * @def SEGMENT_FREE
+ * @brief Valor de `queue_segment.id` de um segmento que está no pool.
+ */
+#define SEGMENT_FREE UINT64_MAX
+
+/**
+ * @def SPIN_LIMIT
+ * @brief Iterações de espera ativa antes de estacionar a thread (estratégia `futex`) ou de
+ * ceder a CPU (estratégia `spin`).
+ */
+#define SPIN_LIMIT 1000
+
+/**
+ * @def BENCH_GAP_NS
+ * @brief Pausa padrão, em nanossegundos, entre duas vendas de um produtor no benchmark.
+ */
+#define BENCH_GAP_NS 20000
+
+/**
+ * @def BENCH_REFUND_EVERY
+ * @brief No benchmark com `--alto-valor` ligado, uma a cada BENCH_REFUND_EVERY vendas de
+ * cada produtor é um estorno.
+ */
+#define BENCH_REFUND_EVERY 20
+
+/**
+ * @def BENCH_HIGH_VALUE_EVERY
+ * @brief No benchmark com `--alto-valor` ligado, uma a cada BENCH_HIGH_VALUE_EVERY vendas
+ * de cada produtor (fora os estornos) tem valor alto.
+ */
+#define BENCH_HIGH_VALUE_EVERY 10
+
+/**
+ * @def SPILL_CAPACITY
+ * @brief Número máximo de vendas no arquivo de transbordo.
+ */
+#define SPILL_CAPACITY (1 << 20)
+
+/**
+ * @def SPILL_PATH
+ * @brief Arquivo de transbordo padrão.
+ */
+#define SPILL_PATH "vendas_transbordo.bin"
+
+/**
+ * @def ANALYTICS_SLICES
+ * @brief Fatias por janela: a janela fixa é formada por ANALYTICS_SLICES fatias alinhadas
+ * e a janela deslizante avança uma fatia por vez.
+ */
+#define ANALYTICS_SLICES 4
+
+/**
+ * @def ANALYTICS_LATENESS
+ * @brief Fatias que cada gerente mantém abertas; vendas com mais atraso são contadas à parte.
+ */
+#define ANALYTICS_LATENESS 2
+
+/**
+ * @def ANALYTICS_RING
+ * @brief Fatias guardadas pelo agregador da análise em janelas.
+ */
+#define ANALYTICS_RING 64
+
+/**
+ * @def HIST_SUB_BITS
+ * @brief Cada potência de dois do histograma é dividida em 2^HIST_SUB_BITS faixas.
+ */
+#define HIST_SUB_BITS 5
+
+/**
+ * @def HIST_BUCKETS
+ * @brief Faixas do histograma, suficientes para qualquer `int64_t` não negativo.
+ */
+#define HIST_BUCKETS ((64 - HIST_SUB_BITS) << HIST_SUB_BITS)
+
+/**
+ * @def NUM_PIPELINE_STAGES
+ * @brief Estágios do pipeline: ingestão, validação, agregação e persistência.
+ */
+#define NUM_PIPELINE_STAGES 4
+
+/**
+ * @def PIPELINE_CAPACITY
+ * @brief Posições de cada anel entre dois estágios do pipeline.
+ */
+#define PIPELINE_CAPACITY 1024
+
+/**
+ * @def PIPELINE_SALES
+ * @brief Vendas geradas por thread de ingestão quando `--benchmark` não é informado.
+ */
+#define PIPELINE_SALES 100000
+
+/**
+ * @def PIPELINE_WRITE_BATCH
+ * @brief Vendas acumuladas por thread de persistência antes de cada `write`.
+ */
+#define PIPELINE_WRITE_BATCH 256
+
+/**
+ * @def PIPELINE_OUTPUT_PATH
+ * @brief Arquivo padrão da persistência do pipeline.
+ */
+#define PIPELINE_OUTPUT_PATH "vendas_pipeline.bin"
+
+/**
+ * @def REPLAY_MAX_SLEEP_NS
+ * @brief Maior pausa entre duas vendas reproduzidas; intervalos maiores no arquivo são
+ * encurtados para este valor.
+ */
+#define REPLAY_MAX_SLEEP_NS 10000000000LL
+
+/**
+ * @def SINK_BLOCK_ROWS
+ * @brief Vendas por bloco do arquivo colunar.
+ */
+#define SINK_BLOCK_ROWS 4096
+
+/**
+ * @def SINK_COLUMNS
+ * @brief Colunas do arquivo colunar: instante, valor, caixa, SKU e loja.
+ */
+#define SINK_COLUMNS 5
+
+/**
+ * @def SINK_POOL_BLOCKS
+ * @brief Blocos alocados na abertura do arquivo colunar e reciclados entre gerentes e a
+ * thread de escrita.
+ */
+#define SINK_POOL_BLOCKS 16
+
+/**
+ * @def SINK_WRITE_BYTES
+ * @brief Tamanho do buffer de saída da thread de escrita; cada `write` grava até isso.
+ */
+#define SINK_WRITE_BYTES (1 << 20)
+
+/**
+ * @def SINK_IO_BUFFERS
+ * @brief Buffers de saída do arquivo colunar: um é preenchido enquanto os outros estão
+ * sendo gravados.
+ */
+#define SINK_IO_BUFFERS 4
+
+/**
+ * @def SINK_URING_RETRIES
+ * @brief Tentativas de submissão, espaçadas de 1 ms, enquanto o io_uring responde EAGAIN
+ * (sem recursos para a requisição); esgotadas, a escrita é tratada como falha.
+ */
+#define SINK_URING_RETRIES 1000
+
+/**
+ * @def SHM_RING_MAGIC
+ * @brief Valor de `shm_ring_header.ready` depois que o criador terminou de inicializar o anel.
+ */
+#define SHM_RING_MAGIC 0x56454e4441534852ULL
+
+/**
+ * @def SHM_ATTACH_TIMEOUT_NS
+ * @brief Quanto o processo dos gerentes espera o dos caixas criar o anel compartilhado.
+ */
+#define SHM_ATTACH_TIMEOUT_NS 30000000000LL
+
+/**
+ * @def SERVER_READ_BYTES
+ * @brief Buffer de leitura de cada conexão do servidor de ingestão.
+ */
+#define SERVER_READ_BYTES (64 * 1024)
+
+/**
+ * @def SERVER_CAPACITY
+ * @brief Capacidade do anel do servidor de ingestão, em vendas.
+ *
+ * Maior que BUFFER_SIZE para que o lote de um evento de leitura (até
+ * SERVER_READ_BYTES / 24 vendas) caiba no anel sem esperar pelos gerentes.
+ */
+#define SERVER_CAPACITY 4096
+
+/**
+ * @def SERVER_MAX_EVENTS
+ * @brief Eventos colhidos por chamada a `epoll_wait` no servidor de ingestão.
+ */
+#define SERVER_MAX_EVENTS 64
+
+/**
+ * @def CLIENT_BATCH
+ * @brief Vendas enviadas por `write` pelo cliente de carga.
+ */
+#define CLIENT_BATCH 256
+
+/**
+ * @def SERVICE_CAPACITY
+ * @brief Capacidade do anel do modo serviço, em vendas.
+ */
+#define SERVICE_CAPACITY 4096
+
+/**
+ * @def SERVICE_MAX_THREADS
+ * @brief Máximo de caixas e, separadamente, de gerentes do modo serviço.
+ */
+#define SERVICE_MAX_THREADS 64
+
+/**
+ * @def SERVICE_MAX_CONTROL
+ * @brief Conexões simultâneas no socket de controle do modo serviço.
+ */
+#define SERVICE_MAX_CONTROL 16
+
+/**
+ * @def SERVICE_TICK_NS
+ * @brief Período em que o modo serviço mede a fila e decide a escala, em nanossegundos.
+ */
+#define SERVICE_TICK_NS 100000000LL
+
+/**
+ * @def SERVICE_REPORT_TICKS
+ * @brief Períodos entre duas linhas de estado do modo serviço.
+ */
+#define SERVICE_REPORT_TICKS 10
+
+/**
+ * @def SERVICE_POLL_NS
+ * @brief Prazo das esperas das threads do modo serviço, para que vejam o pedido de parada.
+ */
+#define SERVICE_POLL_NS 10000000LL
+
+/**
+ * @def SERVICE_WORK_NS
+ * @brief Custo simulado do processamento de uma venda por um gerente do modo serviço.
+ */
+#define SERVICE_WORK_NS 20000
+
+/**
+ * @def SCALE_DEPTH
+ * @brief Profundidade da fila a partir da qual o autoescalador acrescenta um gerente.
+ */
+#define SCALE_DEPTH 1024
+
+/**
+ * @def SCALE_LATENCY_US
+ * @brief Latência média, em microssegundos, a partir da qual o autoescalador acrescenta um gerente.
+ */
+#define SCALE_LATENCY_US 50000
+
+/**
+ * @def SCALE_IDLE_UTILIZATION
+ * @brief Ocupação média dos gerentes abaixo da qual eles são considerados ociosos.
+ */
+#define SCALE_IDLE_UTILIZATION 0.3
+
+/**
+ * @def SCALE_IDLE_TICKS
+ * @brief Períodos seguidos de ociosidade antes de o autoescalador retirar um gerente.
+ */
+#define SCALE_IDLE_TICKS 20
+
+/**
+ * @def SCALE_COOLDOWN_TICKS
+ * @brief Períodos sem nova decisão depois de cada mudança de escala, para a fila reagir.
+ */
+#define SCALE_COOLDOWN_TICKS 5
+
+/**
+ * @def ARENA_ALIGN
+ * @brief Alinhamento dos blocos de `arenaAlloc`: estados de threads vizinhas, como os
+ * contadores dos gerentes do serviço, não dividem uma linha de cache.
+ */
+#define ARENA_ALIGN 64
+
+/**
+ * @def SINK_MAGIC
+ * @brief Assinatura do cabeçalho e do rodapé do arquivo colunar (8 bytes).
+ */
+#define SINK_MAGIC "VENDCOL1"
+
+/**
+ * @struct sale_record
+ * @brief Registro de venda de tamanho fixo transportado pelo buffer.
+ *
+ * O valor é guardado em centavos inteiros para que somas e médias não acumulem erros de
+ * arredondamento de ponto flutuante. O registro ocupa 32 bytes alinhados em 32, de modo
+ * que nunca atravessa a fronteira de uma linha de cache de 64 bytes: cada inserção ou
+ * remoção no buffer copia no máximo uma linha. Todos os campos têm largura fixa, o que
+ * permite guardá-los também em colunas separadas.
+ */
+typedef struct
+{
+    _Alignas(32) int64_t timestamp_ns; /**< Instante da venda (CLOCK_REALTIME), em nanossegundos. */
+    int64_t amount_cents;              /**< Valor da venda em centavos. */
+    uint32_t register_id;              /**< Identificador do caixa que registrou a venda. */
+    uint32_t sku;                      /**< Código do produto vendido. */
+    uint32_t store_id;                 /**< Loja do caixa (ver `storeOf`). */
+    uint8_t reserved[4];               /**< Reservado; completa o registro até 32 bytes. */
+} sale_record;
+
+_Static_assert(sizeof(sale_record) == 32, "sale_record deve ocupar meia linha de cache");
+
+/**
+ * @struct producer_args
+ * @brief Estrutura para encapsular os argumentos a serem passados para cada thread produtora.
+ */
+typedef struct
+{
+    int thread_id;
+    int num_sales;
+} producer_args;
+
+/**
+ * @struct consumer_args
+ * @brief Estrutura para encapsular os argumentos a serem passados para cada thread consumidora.
+ */
+typedef struct
+{
+    int thread_id;
+} consumer_args;
+
+/**
+ * @enum wait_strategy
+ * @brief Como uma thread espera por uma ficha quando o anel está cheio ou vazio.
+ */
+typedef enum
+{
+    WAIT_SEM,     /**< `sem_wait` do POSIX; padrão. */
+    WAIT_SPIN,    /**< Espera ativa com `pause`, sem nunca dormir no kernel. */
+    WAIT_FUTEX,   /**< Espera ativa limitada, depois estaciona em um futex. */
+    WAIT_EVENTFD, /**< eventfd em modo semáforo; o descritor pode ser usado com epoll. */
+    NUM_WAIT_STRATEGIES
+} wait_strategy;
+
+/**
+ * @var wait_strategy_names
+ * @brief Nomes aceitos por `--espera`, na ordem de `wait_strategy`.
+ */
+static const char *const wait_strategy_names[NUM_WAIT_STRATEGIES] = {"sem", "spin", "futex", "eventfd"};
+
+/**
+ * @struct wait_sem
+ * @brief Semáforo de contagem com estratégia de espera escolhida em tempo de execução.
+ *
+ * Só os campos da estratégia escolhida são usados: `sem` e `waiters` para `WAIT_SEM`,
+ * `tokens` para `WAIT_SPIN`, `tokens` e `waiters` para `WAIT_FUTEX`, e
+ * `event_fd`/`close_fd`/`epoll_fd` para `WAIT_EVENTFD`. O bit TOKENS_CLOSED de `tokens`
+ * marca o semáforo fechado em todas as estratégias (ver `waitSemClose`).
+ *
+ * Criado com `waitSemInitShared` em memória compartilhada, o semáforo funciona entre
+ * processos: o semáforo POSIX é iniciado com pshared e o futex usa as operações sem
+ * FUTEX_PRIVATE_FLAG. O eventfd é um descritor do processo e não pode ser compartilhado.
+ */
+typedef struct
+{
+    wait_strategy strategy;   /**< Estratégia de espera. */
+    int shared;               /**< Diferente de zero se o semáforo é compartilhado entre processos. */
+    sem_t sem;                /**< Semáforo POSIX (`WAIT_SEM`). */
+    _Atomic uint32_t tokens;  /**< Fichas disponíveis (`WAIT_SPIN`, `WAIT_FUTEX`) e TOKENS_CLOSED; também é a palavra do futex. */
+    _Atomic uint32_t waiters; /**< Threads bloqueadas no semáforo POSIX ou estacionadas no futex. */
+    int event_fd;             /**< eventfd com EFD_SEMAPHORE (`WAIT_EVENTFD`). */
+    int close_fd;             /**< eventfd escrito uma vez por `waitSemClose` e nunca lido (`WAIT_EVENTFD`). */
+    int epoll_fd;             /**< epoll onde `event_fd` e `close_fd` estão registrados (`WAIT_EVENTFD`). */
+} wait_sem;
+
+/**
+ * @def TOKENS_CLOSED
+ * @brief Bit de `wait_sem.tokens` que marca o semáforo fechado; os demais bits contam fichas.
+ */
+#define TOKENS_CLOSED 0x80000000u
+
+/**
+ * @fn static inline void cpuRelax(void)
+ * @brief Dica ao processador de que estamos em um laço de espera ativa.
+ */
+static inline void cpuRelax(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    __asm__ __volatile__("yield");
+#endif
+}
+
+/**
+ * @fn static inline int futexFlags(const wait_sem *ws)
+ * @brief FUTEX_PRIVATE_FLAG para semáforos de um só processo, 0 para os compartilhados.
+ */
+static inline int futexFlags(const wait_sem *ws)
+{
+    return ws->shared ? 0 : FUTEX_PRIVATE_FLAG;
+}
+
+/**
+ * @fn static int waitSemSetup(wait_sem *ws, wait_strategy strategy, unsigned int initial, int shared)
+ * @brief Inicialização comum a `waitSemInit` e `waitSemInitShared`.
+ */
+static int waitSemSetup(wait_sem *ws, wait_strategy strategy, unsigned int initial, int shared)
+{
+    ws->strategy = strategy;
+    ws->shared = shared;
+    atomic_init(&ws->tokens, initial);
+    atomic_init(&ws->waiters, 0);
+    ws->event_fd = -1;
+    ws->close_fd = -1;
+    ws->epoll_fd = -1;
+
+    switch (strategy)
+    {
+    case WAIT_SEM:
+        return sem_init(&ws->sem, shared, initial);
+    case WAIT_EVENTFD:
+    {
+        if (shared)
+        {
+            errno = EINVAL;
+            return -1;
+        }
+        ws->event_fd = eventfd(initial, EFD_SEMAPHORE | EFD_NONBLOCK | EFD_CLOEXEC);
+        ws->close_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        ws->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+        struct epoll_event event = {.events = EPOLLIN};
+        if (ws->event_fd < 0 || ws->close_fd < 0 || ws->epoll_fd < 0 ||
+            epoll_ctl(ws->epoll_fd, EPOLL_CTL_ADD, ws->event_fd, &event) != 0 ||
+            epoll_ctl(ws->epoll_fd, EPOLL_CTL_ADD, ws->close_fd, &event) != 0)
+        {
+            return -1;
+        }
+        return 0;
+    }
+    default:
+        return 0;
+    }
+}
+
+/**
+ * @fn int waitSemInit(wait_sem *ws, wait_strategy strategy, unsigned int initial)
+ * @brief Inicializa `ws` com `initial` fichas e a estratégia `strategy`.
+ *
+ * @return 0 em caso de sucesso, -1 se o eventfd ou o epoll não puderem ser criados.
+ */
+int waitSemInit(wait_sem *ws, wait_strategy strategy, unsigned int initial)
+{
+    return waitSemSetup(ws, strategy, initial, 0);
+}
+
+/**
+ * @fn int waitSemInitShared(wait_sem *ws, wait_strategy strategy, unsigned int initial)
+ * @brief Como `waitSemInit`, para `ws` em memória compartilhada entre processos.
+ *
+ * @return 0 em caso de sucesso, -1 com `errno` igual a EINVAL na estratégia `eventfd`.
+ */
+int waitSemInitShared(wait_sem *ws, wait_strategy strategy, unsigned int initial)
+{
+    return waitSemSetup(ws, strategy, initial, 1);
+}
+
+/**
+ * @fn void waitSemDestroy(wait_sem *ws)
+ * @brief Libera os recursos de `ws`.
+ */
+void waitSemDestroy(wait_sem *ws)
+{
+    if (ws->strategy == WAIT_SEM)
+    {
+        sem_destroy(&ws->sem);
+    }
+    if (ws->event_fd >= 0)
+    {
+        close(ws->event_fd);
+    }
+    if (ws->close_fd >= 0)
+    {
+        close(ws->close_fd);
+    }
+    if (ws->epoll_fd >= 0)
+    {
+        close(ws->epoll_fd);
+    }
+}
+
+/**
+ * @fn static int tryTakeToken(wait_sem *ws)
+ * @brief Tenta retirar uma ficha de `tokens` sem esperar.
+ *
+ * @return 1 se retirou uma ficha, 0 se não havia nenhuma.
+ */
+static int tryTakeToken(wait_sem *ws)
+{
+    uint32_t tokens = atomic_load_explicit(&ws->tokens, memory_order_relaxed);
+    while ((tokens & ~TOKENS_CLOSED) > 0)
+    {
+        if (atomic_compare_exchange_weak_explicit(&ws->tokens, &tokens, tokens - 1,
+                                                  memory_order_acquire, memory_order_relaxed))
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @fn void waitSemPostN(wait_sem *ws, unsigned int n)
+ * @brief Devolve `n` fichas a `ws` de uma vez, acordando até `n` threads em espera.
+ *
+ * Exceto no semáforo POSIX, que só posta uma ficha por chamada, o custo não depende de `n`:
+ * um único incremento atômico e, se houver alguém estacionado, um único FUTEX_WAKE ou uma
+ * única escrita no eventfd.
+ *
+ * Na estratégia `futex`, o incremento de `tokens` e a leitura de `waiters` são
+ * sequencialmente consistentes, assim como o incremento de `waiters` e a comparação feita
+ * pelo kernel em FUTEX_WAIT: ou quem posta vê o estacionamento, ou quem estaciona vê a ficha.
+ */
+void waitSemPostN(wait_sem *ws, unsigned int n)
+{
+    switch (ws->strategy)
+    {
+    case WAIT_SEM:
+        for (unsigned int i = 0; i < n; i++)
+        {
+            sem_post(&ws->sem);
+        }
+        break;
+    case WAIT_SPIN:
+        atomic_fetch_add_explicit(&ws->tokens, n, memory_order_release);
+        break;
+    case WAIT_FUTEX:
+        atomic_fetch_add(&ws->tokens, n);
+        if (atomic_load(&ws->waiters) > 0)
+        {
+            syscall(SYS_futex, (uint32_t *)&ws->tokens, FUTEX_WAKE | futexFlags(ws), n, NULL, NULL, 0);
+        }
+        break;
+    case WAIT_EVENTFD:
+    {
+        uint64_t count = n;
+        while (write(ws->event_fd, &count, sizeof(count)) < 0 && errno == EINTR)
+        {
+        }
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+/**
+ * @fn void waitSemPost(wait_sem *ws)
+ * @brief Devolve uma ficha a `ws`, acordando uma thread que esteja esperando.
+ */
+void waitSemPost(wait_sem *ws)
+{
+    waitSemPostN(ws, 1);
+}
+
+/**
+ * @fn int waitSemTryWait(wait_sem *ws)
+ * @brief Retira uma ficha de `ws` se houver alguma, sem esperar.
+ *
+ * @return 1 se retirou uma ficha, 0 caso contrário.
+ */
+int waitSemTryWait(wait_sem *ws)
+{
+    switch (ws->strategy)
+    {
+    case WAIT_SEM:
+        return sem_trywait(&ws->sem) == 0;
+    case WAIT_SPIN:
+    case WAIT_FUTEX:
+        return tryTakeToken(ws);
+    case WAIT_EVENTFD:
+    {
+        uint64_t value;
+        return read(ws->event_fd, &value, sizeof(value)) == sizeof(value);
+    }
+    default:
+        return 0;
+    }
+}
+
+/**
+ * @var NO_WAIT
+ * @brief Prazo já vencido: passado às funções `...Until`, transforma a espera em tentativa.
+ */
+static const struct timespec NO_WAIT = {0, 0};
+
+/**
+ * @fn struct timespec deadlineAfter(int64_t timeout_ns)
+ * @brief Prazo absoluto em CLOCK_MONOTONIC daqui a `timeout_ns` nanossegundos.
+ */
+struct timespec deadlineAfter(int64_t timeout_ns)
+{
+    struct timespec deadline;
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    deadline.tv_sec += timeout_ns / 1000000000LL;
+    deadline.tv_nsec += timeout_ns % 1000000000LL;
+    if (deadline.tv_nsec >= 1000000000L)
+    {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
+    }
+    return deadline;
+}
+
+/**
+ * @fn static int64_t nsUntil(const struct timespec *deadline)
+ * @brief Nanossegundos que faltam até `deadline` (CLOCK_MONOTONIC); zero ou negativo se venceu.
+ */
+static int64_t nsUntil(const struct timespec *deadline)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (deadline->tv_sec - now.tv_sec) * 1000000000LL + (deadline->tv_nsec - now.tv_nsec);
+}
+
+/**
+ * @fn int waitSemClosed(wait_sem *ws)
+ * @brief Diferente de zero depois de `waitSemClose`.
+ */
+int waitSemClosed(wait_sem *ws)
+{
+    return (atomic_load(&ws->tokens) & TOKENS_CLOSED) != 0;
+}
+
+/**
+ * @fn int waitSemWaitUntil(wait_sem *ws, const struct timespec *deadline)
+ * @brief Retira uma ficha de `ws`, esperando conforme a estratégia até o prazo absoluto
+ * `deadline` em CLOCK_MONOTONIC (NULL espera indefinidamente).
+ *
+ * - `sem`: bloqueia em `sem_wait` ou `sem_clockwait`.
+ * - `spin`: gira com `pause`; a cada SPIN_LIMIT voltas cede a CPU com `sched_yield`, para
+ *   que a thread que vai postar a ficha consiga rodar quando há mais threads que núcleos,
+ *   e confere o prazo.
+ * - `futex`: gira até SPIN_LIMIT voltas e depois estaciona em FUTEX_WAIT_BITSET sobre
+ *   `tokens`, cujo prazo é absoluto em CLOCK_MONOTONIC.
+ * - `eventfd`: lê o eventfd não bloqueante; se não houver ficha, espera no epoll até o
+ *   descritor ficar legível ou o prazo vencer. Vários consumidores podem acordar pela mesma
+ *   ficha; os que perdem a leitura voltam a esperar. Um erro de `read` ou `epoll_wait`
+ *   que não seja EINTR encerra a espera sem ficha.
+ *
+ * Uma ficha disponível é sempre aceita, mesmo com o prazo vencido ou o semáforo fechado.
+ * Depois de `waitSemClose` a função não espera mais; no semáforo POSIX, a ficha que acorda
+ * uma thread bloqueada no fechamento não corresponde a nenhum item, e quem usa o semáforo
+ * deve consultar o seu próprio estado.
+ *
+ * @return 1 se retirou uma ficha, 0 se o prazo venceu ou o semáforo está fechado e sem fichas.
+ */
+int waitSemWaitUntil(wait_sem *ws, const struct timespec *deadline)
+{
+    if (waitSemTryWait(ws))
+    {
+        return 1;
+    }
+    if (waitSemClosed(ws) || (deadline != NULL && nsUntil(deadline) <= 0))
+    {
+        return 0;
+    }
+
+    switch (ws->strategy)
+    {
+    case WAIT_SEM:
+    {
+        // `waiters` e o bit de fechamento formam um par de Dekker com `waitSemClose`: ou o
+        // fechamento vê esta thread e posta uma ficha para ela, ou esta thread vê o fechamento.
+        int taken;
+        atomic_fetch_add(&ws->waiters, 1);
+        do
+        {
+            if (waitSemClosed(ws))
+            {
+                taken = sem_trywait(&ws->sem) == 0;
+                break;
+            }
+            taken = (deadline == NULL ? sem_wait(&ws->sem) : sem_clockwait(&ws->sem, CLOCK_MONOTONIC, deadline)) == 0;
+        } while (!taken && errno == EINTR);
+        atomic_fetch_sub(&ws->waiters, 1);
+        return taken;
+    }
+    case WAIT_SPIN:
+        for (int spins = 0; !tryTakeToken(ws); spins++)
+        {
+            if (spins == SPIN_LIMIT)
+            {
+                if (waitSemClosed(ws) || (deadline != NULL && nsUntil(deadline) <= 0))
+                {
+                    return 0;
+                }
+                sched_yield();
+                spins = 0;
+            }
+            cpuRelax();
+        }
+        return 1;
+    case WAIT_FUTEX:
+        for (int spins = 0; spins < SPIN_LIMIT; spins++)
+        {
+            if (tryTakeToken(ws))
+            {
+                return 1;
+            }
+            cpuRelax();
+        }
+        while (!tryTakeToken(ws))
+        {
+            if (waitSemClosed(ws) || (deadline != NULL && nsUntil(deadline) <= 0))
+            {
+                return 0;
+            }
+            // Com TOKENS_CLOSED ligado a palavra nunca vale 0, e o kernel não deixa estacionar.
+            atomic_fetch_add(&ws->waiters, 1);
+            syscall(SYS_futex, (uint32_t *)&ws->tokens, FUTEX_WAIT_BITSET | futexFlags(ws), 0, deadline, NULL,
+                    FUTEX_BITSET_MATCH_ANY);
+            atomic_fetch_sub(&ws->waiters, 1);
+        }
+        return 1;
+    case WAIT_EVENTFD:
+        for (;;)
+        {
+            uint64_t value;
+            if (read(ws->event_fd, &value, sizeof(value)) == sizeof(value))
+            {
+                return 1;
+            }
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            if (errno != EAGAIN)
+            {
+                return 0;
+            }
+            if (waitSemClosed(ws))
+            {
+                return 0;
+            }
+            int timeout_ms = -1;
+            if (deadline != NULL)
+            {
+                int64_t remaining = nsUntil(deadline);
+                if (remaining <= 0)
+                {
+                    return 0;
+                }
+                timeout_ms = (int)((remaining + 999999) / 1000000);
+            }
+            struct epoll_event event;
+            if (epoll_wait(ws->epoll_fd, &event, 1, timeout_ms) < 0 && errno != EINTR)
+            {
+                return 0;
+            }
+        }
+    default:
+        return 0;
+    }
+}
+
+/**
+ * @fn int waitSemWait(wait_sem *ws)
+ * @brief `waitSemWaitUntil` sem prazo.
+ *
+ * @return 1 se retirou uma ficha, 0 se o semáforo está fechado e sem fichas.
+ */
+int waitSemWait(wait_sem *ws)
+{
+    return waitSemWaitUntil(ws, NULL);
+}
+
+/**
+ * @fn void waitSemClose(wait_sem *ws)
+ * @brief Fecha `ws`: as fichas restantes ainda podem ser retiradas, mas ninguém mais espera.
+ *
+ * Liga TOKENS_CLOSED com uma única operação atômica; só a primeira chamada tem efeito.
+ * Cada thread em espera é acordada exatamente uma vez: o futex é acordado com um único
+ * FUTEX_WAKE para todos, o semáforo POSIX recebe uma ficha por thread bloqueada
+ * (`waiters`), e o `close_fd`, que nunca é lido, mantém o epoll legível para sempre.
+ * Na espera ativa basta o bit.
+ */
+void waitSemClose(wait_sem *ws)
+{
+    if (atomic_fetch_or(&ws->tokens, TOKENS_CLOSED) & TOKENS_CLOSED)
+    {
+        return;
+    }
+
+    switch (ws->strategy)
+    {
+    case WAIT_SEM:
+        for (uint32_t n = atomic_load(&ws->waiters); n > 0; n--)
+        {
+            sem_post(&ws->sem);
+        }
+        break;
+    case WAIT_FUTEX:
+        if (atomic_load(&ws->waiters) > 0)
+        {
+            syscall(SYS_futex, (uint32_t *)&ws->tokens, FUTEX_WAKE | futexFlags(ws), INT32_MAX, NULL, NULL, 0);
+        }
+        break;
+    case WAIT_EVENTFD:
+    {
+        uint64_t one = 1;
+        while (write(ws->close_fd, &one, sizeof(one)) < 0 && errno == EINTR)
+        {
+        }
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+/**
+ * @fn int waitSemFd(const wait_sem *ws)
+ * @brief Descritor que fica legível quando há fichas, para registro em um epoll externo.
+ *
+ * @return O eventfd na estratégia `eventfd`, ou -1 nas demais.
+ */
+int waitSemFd(const wait_sem *ws)
+{
+    return ws->event_fd;
+}
+
+/**
+ * @struct ring_slot
+ * @brief Posição do anel: número de sequência seguido do registro de venda.
+ *
+ * Para a posição lógica `pos`, a sequência vale `pos` quando a posição está livre para o
+ * produtor, `pos + 1` quando a venda foi publicada e `pos + capacidade` depois que o
+ * consumidor a devolveu. Cada posição ocupa exatamente uma linha de cache.
+ */
+typedef struct
+{
+    _Alignas(64) _Atomic uint64_t sequence; /**< Estado da posição (ver acima). */
+    sale_record sale;                       /**< Venda escrita e lida no próprio anel. */
+} ring_slot;
+
+_Static_assert(sizeof(ring_slot) == 64, "ring_slot deve ocupar uma linha de cache");
+
+/**
+ * @struct sales_ring
+ * @brief Anel limitado de vendas com reserva de posições sem cópia.
+ *
+ * `tail` e `head` ficam em linhas de cache separadas para que produtores e consumidores não
+ * disputem a mesma linha. `available` conta as vendas publicadas e ainda não reservadas por
+ * um consumidor, e seu bit RING_CLOSED marca o anel fechado (`ringClose`): como o consumidor
+ * reserva uma venda com um CAS nessa palavra, ele vê na mesma leitura se ainda há vendas e
+ * se o anel foi fechado, sem janela entre as duas coisas.
+ */
+typedef struct
+{
+    _Alignas(64) _Atomic uint64_t tail; /**< Próxima posição lógica a ser reservada por um produtor. */
+    _Alignas(64) _Atomic uint64_t head; /**< Próxima posição lógica a ser lida por um consumidor. */
+    _Atomic uint64_t available;         /**< Vendas publicadas ainda não reservadas, mais RING_CLOSED. */
+    wait_sem empty_slots;               /**< Posições livres no anel. */
+    wait_sem full_slots;                /**< Vendas publicadas. */
+    size_t capacity;                    /**< Número de posições do anel. */
+    ring_slot slots[];                  /**< Posições do anel. */
+} sales_ring;
+
+/**
+ * @def RING_CLOSED
+ * @brief Bit de `sales_ring.available` que marca o anel fechado.
+ */
+#define RING_CLOSED (1ULL << 63)
+
+sales_ring *ring = NULL;
+
+/**
+ * @struct shm_ring_header
+ * @brief Cabeçalho de um anel em memória compartilhada (`ringCreateShared`), seguido do
+ * próprio `sales_ring`.
+ *
+ * O anel não guarda ponteiros, só posições e sequências, por isso funciona mapeado em
+ * endereços diferentes em cada processo.
+ */
+typedef struct
+{
+    _Alignas(64) _Atomic uint64_t ready; /**< SHM_RING_MAGIC quando o anel está pronto para uso. */
+    uint64_t bytes;                      /**< Tamanho do mapeamento, cabeçalho incluído. */
+    _Atomic int64_t expected;            /**< Vendas que os gerentes devem receber; -1 até os caixas terminarem. */
+} shm_ring_header;
+
+/**
+ * @enum shm_role
+ * @brief Que threads este processo roda quando o anel está em memória compartilhada.
+ */
+typedef enum
+{
+    SHM_BOTH,      /**< Caixas e gerentes, como sem memória compartilhada. */
+    SHM_REGISTERS, /**< Só os caixas; o processo cria o anel. */
+    SHM_MANAGERS,  /**< Só os gerentes; o processo espera o anel e o remove no fim. */
+    NUM_SHM_ROLES
+} shm_role;
+
+/**
+ * @var shm_role_names
+ * @brief Nomes aceitos por `--papel`, na ordem de `shm_role`.
+ */
+static const char *const shm_role_names[NUM_SHM_ROLES] = {"ambos", "caixas", "gerentes"};
+
+/**
+ * @enum sales_topology
+ * @brief Como as vendas vão dos caixas aos gerentes.
+ */
+typedef enum
+{
+    TOPOLOGY_RING,   /**< Um único anel compartilhado por todos (`sales_ring`). */
+    TOPOLOGY_LANES,  /**< Uma faixa SPSC por caixa, lidas pelos gerentes (`sales_lane`). */
+    TOPOLOGY_SHARDS, /**< Uma partição por grupo de lojas, com gerente dono (`shard_set`). */
+    TOPOLOGY_PRIORITY, /**< Um anel por nível de prioridade (`priority_set`). */
+    TOPOLOGY_SEGMENTS, /**< Uma fila sem limite fixo, de segmentos reaproveitados (`segment_queue`). */
+} sales_topology;
+
+/**
+ * @enum sale_priority
+ * @brief Nível de prioridade de uma venda na topologia de prioridades; menor é mais urgente.
+ */
+typedef enum
+{
+    PRIORITY_REFUND, /**< Estornos (valor negativo). */
+    PRIORITY_HIGH,   /**< Vendas de valor alto (`config.high_value_cents`). */
+    PRIORITY_NORMAL, /**< Demais vendas. */
+} sale_priority;
+
+_Static_assert(PRIORITY_NORMAL + 1 == NUM_PRIORITIES, "NUM_PRIORITIES deve contar os níveis de sale_priority");
+
+/**
+ * @var sale_priority_names
+ * @brief Nomes dos níveis de prioridade usados nas mensagens.
+ */
+static const char *const sale_priority_names[NUM_PRIORITIES] = {"estorno", "alto valor", "normal"};
+
+/**
+ * @enum overflow_policy
+ * @brief O que o caixa faz quando a fila está cheia.
+ */
+typedef enum
+{
+    OVERFLOW_BLOCK,       /**< Espera por espaço; padrão. */
+    OVERFLOW_DROP_OLDEST, /**< Descarta a venda mais antiga da fila para abrir espaço. */
+    OVERFLOW_DROP_NEWEST, /**< Descarta a venda nova. */
+    OVERFLOW_SPILL,       /**< Grava a venda no arquivo de transbordo (`spill_log`). */
+    NUM_OVERFLOW_POLICIES
+} overflow_policy;
+
+/**
+ * @var overflow_policy_names
+ * @brief Nomes aceitos por `--transbordo`, na ordem de `overflow_policy`.
+ */
+static const char *const overflow_policy_names[NUM_OVERFLOW_POLICIES] = {"bloquear", "descartar-antiga",
+                                                                         "descartar-nova", "disco"};
+
+/**
+ * @struct prod_cons_config
+ * @brief Configuração lida da linha de comando.
+ */
+typedef struct
+{
+    wait_strategy strategy;           /**< Estratégia de espera do anel. */
+    int strategy_given;               /**< Diferente de zero se `--espera` foi informado. */
+    long long bench_sales;            /**< Vendas por produtor no benchmark; 0 roda a simulação. */
+    long long bench_gap_ns;           /**< Pausa entre vendas de um produtor no benchmark. */
+    sales_topology topology;          /**< Topologia das filas. */
+    int lane_weights[NUM_PRODUCERS];  /**< Peso de cada faixa na leitura; 1 é round-robin puro. */
+    overflow_policy overflow;         /**< Política para fila cheia. */
+    const char *spill_path;           /**< Arquivo de transbordo da política `disco`. */
+    long long timeout_ns;             /**< Prazo das esperas de caixas e gerentes; 0 espera indefinidamente. */
+    long long window_ns;              /**< Duração da janela fixa da análise; 0 desliga a análise. */
+    int pipeline_workers[NUM_PIPELINE_STAGES]; /**< Threads de cada estágio; todos 0 roda sem pipeline. */
+    const char *output_path;          /**< Arquivo da persistência do pipeline. */
+    const char *replay_path;          /**< Arquivo de vendas gravadas a reproduzir, ou NULL. */
+    double replay_speed;              /**< Fator de aceleração da reprodução; 0 sem pausas. */
+    const char *sink_path;            /**< Arquivo colunar das vendas processadas, ou NULL. */
+    int sink_read;                    /**< Diferente de zero para só conferir `sink_path`. */
+    int sink_pwrite;                  /**< Diferente de zero para gravar com `pwrite` sem io_uring. */
+    const char *shm_name;             /**< Nome do anel em memória compartilhada, ou NULL. */
+    shm_role role;                    /**< Threads deste processo com `shm_name`. */
+    const char *server_address;       /**< Endereço do servidor de ingestão, ou NULL. */
+    const char *client_address;       /**< Endereço ao qual o cliente de carga se conecta, ou NULL. */
+    int connections;                  /**< Conexões do cliente; no servidor, quantas esperar antes de encerrar. */
+    int priority_weights[NUM_PRIORITIES]; /**< Pesos da leitura ponderada das prioridades; 0 é estrita. */
+    long long high_value_cents;       /**< Valor a partir do qual a venda tem prioridade alta; 0 desliga. */
+    long long segment_cap_bytes;      /**< Limite de memória da fila segmentada; 0 usa o do diretório. */
+    const char *service_address;      /**< Endereço do socket de controle do modo serviço, ou NULL. */
+    int autoscale;                    /**< Diferente de zero para o autoescalador ajustar os gerentes. */
+    long long scale_depth;            /**< Profundidade da fila que faz o autoescalador crescer. */
+    long long scale_latency_ns;       /**< Latência média que faz o autoescalador crescer. */
+    int scale_max;                    /**< Máximo de gerentes do autoescalador; 0 usa as CPUs, no mínimo NUM_CONSUMERS. */
+    long long service_work_ns;        /**< Custo simulado por venda dos gerentes do modo serviço. */
+} prod_cons_config;
+
+prod_cons_config config = {WAIT_SEM, 0, 0, BENCH_GAP_NS, TOPOLOGY_RING, {1, 1, 1, 1, 1, 1}, OVERFLOW_BLOCK, SPILL_PATH,
+                           0, 0, {0, 0, 0, 0}, PIPELINE_OUTPUT_PATH, NULL, 1.0, NULL, 0, 0, NULL,
+                           SHM_BOTH, NULL, NULL, 0, {0, 0, 0}, PRIORITY_HIGH_CENTS, 0,
+                           NULL, 0, SCALE_DEPTH, SCALE_LATENCY_US * 1000LL, 0, SERVICE_WORK_NS};
+
+_Static_assert(NUM_PRODUCERS == 6, "atualize os pesos padrão de config.lane_weights");
+
+pthread_mutex_t mutex;
+pthread_cond_t buffer_empty_cond; // Usada para garantir o término correto
+
+// Volatile para garantir que a leitura mais recente seja usada por todas as threads
+volatile int active_producers = NUM_PRODUCERS;
+
+/**
+ * @struct run_arena
+ * @brief Bloco de onde `runSimulation`, `runPipeline`, `runServer`, `runClient` e
+ * `runService` tiram os argumentos e estados de suas threads.
+ *
+ * Cada modo cria a arena com o tamanho de que precisa, antes de iniciar as threads, e a
+ * destrói depois de esperar por elas; `arenaAlloc` não é chamada pelas threads. No modo
+ * serviço, as posições reservadas no início são reaproveitadas a cada mudança de escala.
+ * `allocations` e `used` aparecem em `printAllocStats`.
+ */
+typedef struct
+{
+    unsigned char *base; /**< Bloco da arena. */
+    size_t size;         /**< Tamanho de `base`. */
+    size_t used;         /**< Bytes já entregues. */
+    int allocations;     /**< Alocações atendidas pela arena. */
+} run_arena;
+
+run_arena arena;
+
+/**
+ * @fn int arenaCreate(size_t size)
+ * @brief Aloca a arena do modo em execução, com `size` bytes arredondados para ARENA_ALIGN.
+ *
+ * @return 0 em caso de sucesso, -1 se faltar memória.
+ */
+int arenaCreate(size_t size)
+{
+    arena.size = (size + ARENA_ALIGN - 1) / ARENA_ALIGN * ARENA_ALIGN;
+    arena.used = 0;
+    arena.allocations = 0;
+    arena.base = aligned_alloc(ARENA_ALIGN, arena.size);
+    return arena.base != NULL ? 0 : -1;
+}
+
+/**
+ * @fn void *arenaAlloc(size_t size)
+ * @brief Entrega `size` bytes zerados da arena.
+ *
+ * @return O bloco, ou NULL se a arena não comportar `size` bytes.
+ */
+void *arenaAlloc(size_t size)
+{
+    size_t rounded = (size + ARENA_ALIGN - 1) / ARENA_ALIGN * ARENA_ALIGN;
+    if (arena.base == NULL || rounded > arena.size - arena.used)
+    {
+        return NULL;
+    }
+    void *block = arena.base + arena.used;
+    arena.used += rounded;
+    arena.allocations++;
+    memset(block, 0, size);
+    return block;
+}
+
+/**
+ * @fn void arenaDestroy(void)
+ * @brief Libera de uma vez tudo o que foi alocado na arena.
+ */
+void arenaDestroy(void)
+{
+    free(arena.base);
+    arena.base = NULL;
+}
+
+#ifdef COUNT_MALLOC
+#if defined(__SANITIZE_ADDRESS__) || defined(__SANITIZE_THREAD__)
+#error "COUNT_MALLOC substitui o alocador e não pode ser combinado com -fsanitize"
+#endif
+#if defined(__has_feature)
+#if __has_feature(address_sanitizer) || __has_feature(thread_sanitizer)
+#error "COUNT_MALLOC substitui o alocador e não pode ser combinado com -fsanitize"
+#endif
+#endif
+#ifndef __GLIBC__
+#error "COUNT_MALLOC depende dos pontos de entrada __libc_* da glibc"
+#endif
+
+/**
+ * @var thread_mallocs
+ * @brief Chamadas às funções de alocação feitas pela thread.
+ *
+ * Contador local à thread, para que a contagem não crie disputa justamente onde se quer
+ * provar que não há alocação.
+ */
+static _Thread_local uint64_t thread_mallocs;
+
+/**
+ * @var worker_mallocs
+ * @brief Soma das chamadas de alocação feitas pelas threads de caixas, gerentes e estágios
+ * durante a execução (`mallocAccount`).
+ */
+_Atomic int64_t worker_mallocs;
+
+// Só com -DCOUNT_MALLOC: todos os pontos de entrada de alocação da glibc são substituídos
+// por versões que contam a chamada e delegam ao alocador original. `free` não aloca e
+// continua sendo a da glibc.
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t count, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+extern void *__libc_memalign(size_t alignment, size_t size);
+extern void *__libc_valloc(size_t size);
+extern void *__libc_pvalloc(size_t size);
+
+void *malloc(size_t size)
+{
+    thread_mallocs++;
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t count, size_t size)
+{
+    thread_mallocs++;
+    return __libc_calloc(count, size);
+}
+
+void *realloc(void *ptr, size_t size)
+{
+    thread_mallocs++;
+    return __libc_realloc(ptr, size);
+}
+
+void *aligned_alloc(size_t alignment, size_t size)
+{
+    thread_mallocs++;
+    return __libc_memalign(alignment, size);
+}
+
+void *memalign(size_t alignment, size_t size)
+{
+    thread_mallocs++;
+    return __libc_memalign(alignment, size);
+}
+
+int posix_memalign(void **ptr, size_t alignment, size_t size)
+{
+    if (alignment % sizeof(void *) != 0 || (alignment & (alignment - 1)) != 0)
+    {
+        return EINVAL;
+    }
+    thread_mallocs++;
+    void *block = __libc_memalign(alignment, size);
+    if (block == NULL && size > 0)
+    {
+        return ENOMEM;
+    }
+    *ptr = block;
+    return 0;
+}
+
+void *valloc(size_t size)
+{
+    thread_mallocs++;
+    return __libc_valloc(size);
+}
+
+void *pvalloc(size_t size)
+{
+    thread_mallocs++;
+    return __libc_pvalloc(size);
+}
+#endif
+
+/**
+ * @fn static inline uint64_t mallocCount(void)
+ * @brief Chamadas de alocação feitas até agora pela thread atual; sempre 0 sem COUNT_MALLOC.
+ */
+static inline uint64_t mallocCount(void)
+{
+#ifdef COUNT_MALLOC
+    return thread_mallocs;
+#else
+    return 0;
+#endif
+}
+
+/**
+ * @fn void mallocAccount(uint64_t since)
+ * @brief Soma a `worker_mallocs` as chamadas feitas pela thread desde a contagem `since`.
+ */
+void mallocAccount(uint64_t since)
+{
+#ifdef COUNT_MALLOC
+    atomic_fetch_add_explicit(&worker_mallocs, (int64_t)(thread_mallocs - since), memory_order_relaxed);
+#else
+    (void)since;
+#endif
+}
+
+/**
+ * @fn void printAllocStats(const char *indent)
+ * @brief Imprime, precedidas de `indent`, as chamadas de alocação das threads de trabalho
+ * (só com COUNT_MALLOC, zerando a contagem) e, se houver arena, quantas alocações ela atendeu.
+ */
+void printAllocStats(const char *indent)
+{
+#ifdef COUNT_MALLOC
+    printf("%sAlocação: %" PRId64 " chamadas a malloc nas threads de trabalho", indent,
+           atomic_exchange(&worker_mallocs, 0));
+    if (arena.base != NULL)
+    {
+        printf("; contextos das threads em %d alocações, %zu bytes, da arena (1 malloc)", arena.allocations,
+               arena.used);
+    }
+    printf("\n");
+#else
+    if (arena.base != NULL)
+    {
+        printf("%sAlocação: contextos das threads em %d alocações, %zu bytes, da arena (1 malloc)\n", indent,
+               arena.allocations, arena.used);
+    }
+#endif
+}
+
+/**
+ * @fn static int ringInit(sales_ring *r, size_t capacity, wait_strategy strategy, int shared)
+ * @brief Inicializa no lugar um anel com `capacity` posições, todas livres.
+ *
+ * @return 0 em caso de sucesso, -1 se os semáforos não puderem ser criados.
+ */
+static int ringInit(sales_ring *r, size_t capacity, wait_strategy strategy, int shared)
+{
+    int (*init)(wait_sem *, wait_strategy, unsigned int) = shared ? waitSemInitShared : waitSemInit;
+    atomic_init(&r->tail, 0);
+    atomic_init(&r->head, 0);
+    atomic_init(&r->available, 0);
+    r->capacity = capacity;
+    if (init(&r->empty_slots, strategy, (unsigned int)capacity) != 0 || // Começa com N slots vazios
+        init(&r->full_slots, strategy, 0) != 0)                        // Começa com 0 slots preenchidos
+    {
+        return -1;
+    }
+    for (size_t i = 0; i < capacity; i++)
+    {
+        atomic_init(&r->slots[i].sequence, i);
+    }
+    return 0;
+}
+
+/**
+ * @fn sales_ring *ringCreate(size_t capacity, wait_strategy strategy)
+ * @brief Aloca um anel com `capacity` posições, todas livres, cujos semáforos esperam
+ * com a estratégia `strategy`.
+ *
+ * @return O anel, ou NULL se a alocação ou a criação dos semáforos falhar.
+ */
+sales_ring *ringCreate(size_t capacity, wait_strategy strategy)
+{
+    size_t bytes = sizeof(sales_ring) + capacity * sizeof(ring_slot);
+    bytes = (bytes + 63) / 64 * 64; // aligned_alloc exige múltiplo do alinhamento
+    sales_ring *r = aligned_alloc(64, bytes);
+    if (r == NULL)
+    {
+        return NULL;
+    }
+    if (ringInit(r, capacity, strategy, 0) != 0)
+    {
+        free(r);
+        return NULL;
+    }
+    return r;
+}
+
+/**
+ * @fn static shm_ring_header *ringSharedHeader(sales_ring *r)
+ * @brief Cabeçalho do anel compartilhado `r`.
+ */
+static shm_ring_header *ringSharedHeader(sales_ring *r)
+{
+    return (shm_ring_header *)((char *)r - sizeof(shm_ring_header));
+}
+
+/**
+ * @fn sales_ring *ringCreateShared(const char *name, size_t capacity, wait_strategy strategy)
+ * @brief Cria com `shm_open` o objeto de memória compartilhada `name` e inicializa nele um
+ * anel que outros processos podem abrir com `ringAttachShared`.
+ *
+ * Um objeto com o mesmo nome deixado por uma execução interrompida é removido antes. O
+ * anel só é marcado pronto (`shm_ring_header.ready`) depois de inicializado, e as vendas
+ * são escritas e lidas direto no mapeamento, sem cópias entre processos.
+ *
+ * @return O anel, ou NULL em caso de erro (a estratégia `eventfd` não é aceita).
+ */
+sales_ring *ringCreateShared(const char *name, size_t capacity, wait_strategy strategy)
+{
+    size_t bytes = sizeof(shm_ring_header) + sizeof(sales_ring) + capacity * sizeof(ring_slot);
+    shm_unlink(name);
+    int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+    if (fd < 0)
+    {
+        return NULL;
+    }
+    shm_ring_header *header = MAP_FAILED;
+    if (ftruncate(fd, (off_t)bytes) == 0)
+    {
+        header = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    close(fd);
+    if (header == MAP_FAILED)
+    {
+        shm_unlink(name);
+        return NULL;
+    }
+
+    sales_ring *r = (sales_ring *)(header + 1);
+    header->bytes = bytes;
+    atomic_init(&header->expected, -1);
+    if (ringInit(r, capacity, strategy, 1) != 0)
+    {
+        munmap(header, bytes);
+        shm_unlink(name);
+        return NULL;
+    }
+    atomic_store_explicit(&header->ready, SHM_RING_MAGIC, memory_order_release);
+    return r;
+}
+
+/**
+ * @fn sales_ring *ringAttachShared(const char *name, int64_t timeout_ns)
+ * @brief Abre o anel compartilhado `name`, esperando até `timeout_ns` nanossegundos que
+ * outro processo o crie e o marque pronto.
+ *
+ * @return O anel, ou NULL se ele não ficar pronto a tempo ou não puder ser mapeado.
+ */
+sales_ring *ringAttachShared(const char *name, int64_t timeout_ns)
+{
+    struct timespec deadline = deadlineAfter(timeout_ns);
+    struct timespec pause = {0, 10000000};
+    for (; nsUntil(&deadline) > 0; nanosleep(&pause, NULL))
+    {
+        int fd = shm_open(name, O_RDWR | O_CLOEXEC, 0);
+        if (fd < 0)
+        {
+            continue;
+        }
+        struct stat st;
+        shm_ring_header *header = MAP_FAILED;
+        if (fstat(fd, &st) == 0 && st.st_size >= (off_t)(sizeof(shm_ring_header) + sizeof(sales_ring)))
+        {
+            header = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        }
+        close(fd);
+        if (header == MAP_FAILED)
+        {
+            continue;
+        }
+        while (atomic_load_explicit(&header->ready, memory_order_acquire) != SHM_RING_MAGIC && nsUntil(&deadline) > 0)
+        {
+            nanosleep(&pause, NULL);
+        }
+        if (atomic_load_explicit(&header->ready, memory_order_acquire) == SHM_RING_MAGIC &&
+            header->bytes == (uint64_t)st.st_size)
+        {
+            return (sales_ring *)(header + 1);
+        }
+        munmap(header, st.st_size);
+    }
+    errno = ETIMEDOUT;
+    return NULL;
+}
+
+/**
+ * @fn void ringDetachShared(sales_ring *r, const char *name, int remove)
+ * @brief Desfaz o mapeamento do anel compartilhado e, se `remove` for diferente de zero,
+ * remove o objeto `name`. Os semáforos não são destruídos, pois o outro processo ainda
+ * pode estar usando o anel.
+ */
+void ringDetachShared(sales_ring *r, const char *name, int remove)
+{
+    shm_ring_header *header = ringSharedHeader(r);
+    munmap(header, header->bytes);
+    if (remove)
+    {
+        shm_unlink(name);
+    }
+}
+
+/**
+ * @fn void ringDestroy(sales_ring *r)
+ * @brief Destrói os semáforos e libera o anel.
+ */
+void ringDestroy(sales_ring *r)
+{
+    waitSemDestroy(&r->empty_slots);
+    waitSemDestroy(&r->full_slots);
+    free(r);
+}
+
+/**
+ * @fn static sale_record *ringTake(sales_ring *r, uint64_t *pos)
+ * @brief Reserva a próxima posição depois que a ficha de `empty_slots` já foi obtida.
+ */
+static sale_record *ringTake(sales_ring *r, uint64_t *pos)
+{
+    uint64_t p = atomic_fetch_add_explicit(&r->tail, 1, memory_order_relaxed);
+    ring_slot *slot = &r->slots[p % r->capacity];
+    while (atomic_load_explicit(&slot->sequence, memory_order_acquire) != p)
+    {
+        sched_yield();
+    }
+
+    *pos = p;
+    return &slot->sale;
+}
+
+/**
+ * @fn sale_record *ringClaimUntil(sales_ring *r, uint64_t *pos, const struct timespec *deadline)
+ * @brief Como `ringClaim`, mas retorna NULL com `errno` igual a ETIMEDOUT se o anel
+ * continuar cheio até `deadline`, ou igual a EPIPE se o anel estiver fechado.
+ */
+sale_record *ringClaimUntil(sales_ring *r, uint64_t *pos, const struct timespec *deadline)
+{
+    if (!waitSemWaitUntil(&r->empty_slots, deadline))
+    {
+        errno = waitSemClosed(&r->empty_slots) ? EPIPE : ETIMEDOUT;
+        return NULL;
+    }
+    if (atomic_load(&r->available) & RING_CLOSED)
+    {
+        waitSemPost(&r->empty_slots); // A ficha obtida volta ao anel fechado.
+        errno = EPIPE;
+        return NULL;
+    }
+    return ringTake(r, pos);
+}
+
+/**
+ * @fn sale_record *ringClaim(sales_ring *r, uint64_t *pos)
+ * @brief Reserva a próxima posição livre e devolve um ponteiro para escrever a venda nela.
+ *
+ * Bloqueia enquanto o anel estiver cheio. A posição lógica reservada é devolvida em `*pos`
+ * e deve ser passada a `ringCommit` depois que o registro estiver completo. Como
+ * consumidores podem devolver posições fora de ordem, a ficha de `empty_slots` garante
+ * que alguma posição foi liberada, mas não necessariamente a reservada; nesse caso o
+ * produtor cede a CPU até que o consumidor atrasado a devolva. Depois de `ringClose`,
+ * retorna NULL com `errno` igual a EPIPE.
+ */
+sale_record *ringClaim(sales_ring *r, uint64_t *pos)
+{
+    return ringClaimUntil(r, pos, NULL);
+}
+
+/**
+ * @fn sale_record *ringTryClaim(sales_ring *r, uint64_t *pos)
+ * @brief Como `ringClaim`, mas retorna NULL em vez de esperar se o anel estiver cheio ou fechado.
+ */
+sale_record *ringTryClaim(sales_ring *r, uint64_t *pos)
+{
+    if (!waitSemTryWait(&r->empty_slots))
+    {
+        errno = waitSemClosed(&r->empty_slots) ? EPIPE : EAGAIN;
+        return NULL;
+    }
+    if (atomic_load(&r->available) & RING_CLOSED)
+    {
+        waitSemPost(&r->empty_slots); // A ficha obtida volta ao anel fechado.
+        errno = EPIPE;
+        return NULL;
+    }
+    return ringTake(r, pos);
+}
+
+/**
+ * @fn void ringPublish(sales_ring *r, uint64_t pos)
+ * @brief Torna visível aos consumidores a venda da posição `pos`, sem postar ficha.
+ *
+ * O incremento de `available` é sequencialmente consistente, para que quem migra um
+ * anel de dono (ver `maybeRebalance`) veja a venda ou o novo dono seja visto por quem
+ * publica.
+ */
+void ringPublish(sales_ring *r, uint64_t pos)
+{
+    ring_slot *slot = &r->slots[pos % r->capacity];
+    atomic_store_explicit(&slot->sequence, pos + 1, memory_order_release);
+    atomic_fetch_add(&r->available, 1);
+}
+
+/**
+ * @fn void ringCommit(sales_ring *r, uint64_t pos)
+ * @brief Publica a venda escrita na posição reservada por `ringClaim`.
+ */
+void ringCommit(sales_ring *r, uint64_t pos)
+{
+    ringPublish(r, pos);
+    waitSemPost(&r->full_slots); // Sinaliza que um slot foi preenchido
+}
+
+/**
+ * @fn void ringSignal(sales_ring *r, unsigned int n)
+ * @brief Avisa os consumidores de `n` vendas publicadas com `ringPublish`, com um único
+ * despertar para o lote.
+ *
+ * Quem publica em lote não deve esperar por posição livre (`ringClaim`) com vendas
+ * publicadas e ainda não sinalizadas: os consumidores não as veriam e o anel poderia
+ * ficar cheio para sempre. Use `ringTryClaim` e sinalize o lote antes de bloquear.
+ */
+void ringSignal(sales_ring *r, unsigned int n)
+{
+    if (n > 0)
+    {
+        waitSemPostN(&r->full_slots, n);
+    }
+}
+
+/**
+ * @fn const sale_record *ringTryPeek(sales_ring *r, uint64_t *pos)
+ * @brief Como `ringPeek`, mas sem esperar por ficha: retorna NULL se não houver venda
+ * publicada disponível, com `errno` igual a EAGAIN, ou zero se o anel estiver fechado.
+ */
+const sale_record *ringTryPeek(sales_ring *r, uint64_t *pos)
+{
+    uint64_t avail = atomic_load_explicit(&r->available, memory_order_acquire);
+    do
+    {
+        if ((avail & ~RING_CLOSED) == 0)
+        {
+            errno = (avail & RING_CLOSED) ? 0 : EAGAIN;
+            return NULL;
+        }
+    } while (!atomic_compare_exchange_weak_explicit(&r->available, &avail, avail - 1,
+                                                    memory_order_acquire, memory_order_acquire));
+
+    uint64_t p = atomic_fetch_add_explicit(&r->head, 1, memory_order_relaxed);
+    ring_slot *slot = &r->slots[p % r->capacity];
+    while (atomic_load_explicit(&slot->sequence, memory_order_acquire) != p + 1)
+    {
+        sched_yield();
+    }
+
+    *pos = p;
+    return &slot->sale;
+}
+
+/**
+ * @fn const sale_record *ringPeekUntil(sales_ring *r, uint64_t *pos, const struct timespec *deadline)
+ * @brief Reserva a próxima venda publicada e devolve um ponteiro para lê-la no lugar.
+ *
+ * Bloqueia enquanto o anel estiver vazio, até `deadline` (NULL espera indefinidamente);
+ * se o prazo vencer, retorna NULL com `errno` igual a ETIMEDOUT. Depois de `ringClose`,
+ * não espera mais: continua devolvendo as vendas restantes e, com o anel vazio, retorna
+ * NULL com `errno` zero. A posição lógica da venda é devolvida em `*pos` e deve ser
+ * passada a `ringRelease` quando a leitura terminar.
+ */
+const sale_record *ringPeekUntil(sales_ring *r, uint64_t *pos, const struct timespec *deadline)
+{
+    for (;;)
+    {
+        if (!waitSemWaitUntil(&r->full_slots, deadline) && !waitSemClosed(&r->full_slots))
+        {
+            errno = ETIMEDOUT;
+            return NULL;
+        }
+
+        // Aberto, toda ficha corresponde a uma venda; fechado, `available` decide.
+        const sale_record *sale = ringTryPeek(r, pos);
+        if (sale != NULL || errno == 0)
+        {
+            return sale;
+        }
+    }
+}
+
+/**
+ * @fn const sale_record *ringPeek(sales_ring *r, uint64_t *pos)
+ * @brief `ringPeekUntil` sem prazo.
+ */
+const sale_record *ringPeek(sales_ring *r, uint64_t *pos)
+{
+    return ringPeekUntil(r, pos, NULL);
+}
+
+/**
+ * @fn void ringRelease(sales_ring *r, uint64_t pos)
+ * @brief Devolve aos produtores a posição lida com `ringPeek`.
+ */
+void ringRelease(sales_ring *r, uint64_t pos)
+{
+    ring_slot *slot = &r->slots[pos % r->capacity];
+    atomic_store_explicit(&slot->sequence, pos + r->capacity, memory_order_release);
+    waitSemPost(&r->empty_slots); // Libera um slot vazio para os produtores
+}
+
+/**
+ * @fn void ringClose(sales_ring *r)
+ * @brief Fecha o anel depois que os produtores terminaram.
+ *
+ * Liga RING_CLOSED em `available` e fecha os dois semáforos, acordando uma única vez cada
+ * thread em espera. As vendas já publicadas continuam disponíveis para `ringPeek`; novas
+ * reservas falham com EPIPE.
+ */
+void ringClose(sales_ring *r)
+{
+    if (atomic_fetch_or(&r->available, RING_CLOSED) & RING_CLOSED)
+    {
+        return;
+    }
+    waitSemClose(&r->full_slots);
+    waitSemClose(&r->empty_slots);
+}
+
+/**
+ * @fn int ringSize(sales_ring *r)
+ * @brief Número aproximado de vendas publicadas e ainda não lidas, usado nas mensagens.
+ */
+int ringSize(sales_ring *r)
+{
+    return (int)(atomic_load_explicit(&r->available, memory_order_relaxed) & ~RING_CLOSED);
+}
+
+/**
+ * @struct sales_lane
+ * @brief Faixa SPSC exclusiva de um caixa.
+ *
+ * Só o caixa dono escreve `tail` e só o gerente dono escreve `head`, cada um em sua linha
+ * de cache; nenhum dos dois precisa de instruções atômicas de leitura-modificação-escrita.
+ * O produtor espera por espaço em `free_slots` e, ao publicar, posta uma ficha no
+ * `ready` do gerente dono, que assim sabe que alguma de suas faixas tem vendas.
+ *
+ * Garantia de ordem: dentro de uma faixa, as vendas são lidas exatamente na ordem em que o
+ * caixa as publicou. Entre faixas diferentes não há ordem: vendas de caixas distintos
+ * podem ser processadas em qualquer ordem relativa, mesmo pelo mesmo gerente.
+ */
+typedef struct
+{
+    _Alignas(64) _Atomic uint64_t tail; /**< Próxima posição a ser escrita pelo caixa. */
+    _Alignas(64) _Atomic uint64_t head; /**< Próxima posição a ser lida pelo gerente. */
+    wait_sem free_slots;                /**< Posições livres na faixa. */
+    int owner;                          /**< Índice do gerente que lê a faixa. */
+    sale_record slots[BUFFER_SIZE];     /**< Vendas escritas e lidas no lugar. */
+} sales_lane;
+
+/**
+ * @struct lane_consumer
+ * @brief Estado de leitura de um gerente na topologia de faixas.
+ *
+ * As faixas são distribuídas entre os gerentes (faixa `i` para o gerente
+ * `i % NUM_CONSUMERS`), de modo que cada faixa tem exatamente um leitor. O gerente percorre
+ * suas faixas em round-robin, lendo até `config.lane_weights[faixa]` vendas seguidas de uma
+ * faixa antes de passar à próxima.
+ */
+typedef struct
+{
+    wait_sem ready;              /**< Vendas publicadas nas faixas do gerente; fechado no término. */
+    int lanes[NUM_PRODUCERS];    /**< Faixas lidas por este gerente. */
+    int num_lanes;               /**< Número de faixas em `lanes`. */
+    int cursor;                  /**< Posição em `lanes` da faixa em leitura. */
+    int burst;                   /**< Vendas já lidas da faixa atual nesta visita. */
+} lane_consumer;
+
+sales_lane *lanes = NULL;
+lane_consumer lane_consumers[NUM_CONSUMERS];
+
+/**
+ * @fn static void lanesRelease(int num_ready, int num_lanes)
+ * @brief Destrói os `ready` dos primeiros `num_ready` gerentes e os `free_slots` das
+ * primeiras `num_lanes` faixas e libera as faixas.
+ */
+static void lanesRelease(int num_ready, int num_lanes)
+{
+    for (int i = 0; i < num_lanes; i++)
+    {
+        waitSemDestroy(&lanes[i].free_slots);
+    }
+    for (int c = 0; c < num_ready; c++)
+    {
+        waitSemDestroy(&lane_consumers[c].ready);
+    }
+    free(lanes);
+    lanes = NULL;
+}
+
+/**
+ * @fn int lanesCreate(wait_strategy strategy)
+ * @brief Aloca uma faixa por caixa e distribui as faixas entre os gerentes.
+ *
+ * @return 0 em caso de sucesso, -1 se a alocação ou a criação dos semáforos falhar.
+ */
+int lanesCreate(wait_strategy strategy)
+{
+    lanes = aligned_alloc(64, NUM_PRODUCERS * sizeof(sales_lane));
+    if (lanes == NULL)
+    {
+        return -1;
+    }
+
+    for (int c = 0; c < NUM_CONSUMERS; c++)
+    {
+        lane_consumers[c].num_lanes = 0;
+        lane_consumers[c].cursor = 0;
+        lane_consumers[c].burst = 0;
+        if (waitSemInit(&lane_consumers[c].ready, strategy, 0) != 0)
+        {
+            lanesRelease(c, 0);
+            return -1;
+        }
+    }
+
+    for (int i = 0; i < NUM_PRODUCERS; i++)
+    {
+        atomic_init(&lanes[i].tail, 0);
+        atomic_init(&lanes[i].head, 0);
+        lanes[i].owner = i % NUM_CONSUMERS;
+        if (waitSemInit(&lanes[i].free_slots, strategy, BUFFER_SIZE) != 0)
+        {
+            lanesRelease(NUM_CONSUMERS, i);
+            return -1;
+        }
+        lane_consumer *c = &lane_consumers[lanes[i].owner];
+        c->lanes[c->num_lanes++] = i;
+    }
+    return 0;
+}
+
+/**
+ * @fn void lanesDestroy(void)
+ * @brief Libera as faixas e os semáforos dos gerentes.
+ */
+void lanesDestroy(void)
+{
+    lanesRelease(NUM_CONSUMERS, NUM_PRODUCERS);
+}
+
+/**
+ * @fn sale_record *laneClaimUntil(sales_lane *lane, uint64_t *pos, const struct timespec *deadline)
+ * @brief Como `laneClaim`, mas retorna NULL com `errno` igual a ETIMEDOUT se a faixa
+ * continuar cheia até `deadline`, ou igual a EPIPE se as faixas estiverem fechadas.
+ */
+sale_record *laneClaimUntil(sales_lane *lane, uint64_t *pos, const struct timespec *deadline)
+{
+    if (!waitSemWaitUntil(&lane->free_slots, deadline) || waitSemClosed(&lane->free_slots))
+    {
+        errno = waitSemClosed(&lane->free_slots) ? EPIPE : ETIMEDOUT;
+        return NULL;
+    }
+    *pos = atomic_load_explicit(&lane->tail, memory_order_relaxed);
+    return &lane->slots[*pos % BUFFER_SIZE];
+}
+
+/**
+ * @fn sale_record *laneClaim(sales_lane *lane, uint64_t *pos)
+ * @brief Reserva a próxima posição da faixa, esperando se ela estiver cheia.
+ */
+sale_record *laneClaim(sales_lane *lane, uint64_t *pos)
+{
+    return laneClaimUntil(lane, pos, NULL);
+}
+
+/**
+ * @fn sale_record *laneTryClaim(sales_lane *lane, uint64_t *pos)
+ * @brief Como `laneClaim`, mas retorna NULL em vez de esperar se a faixa estiver cheia.
+ */
+sale_record *laneTryClaim(sales_lane *lane, uint64_t *pos)
+{
+    if (!waitSemTryWait(&lane->free_slots))
+    {
+        return NULL;
+    }
+    *pos = atomic_load_explicit(&lane->tail, memory_order_relaxed);
+    return &lane->slots[*pos % BUFFER_SIZE];
+}
+
+/**
+ * @fn void laneCommit(sales_lane *lane, uint64_t pos)
+ * @brief Publica a venda escrita por `laneClaim` e avisa o gerente dono da faixa.
+ */
+void laneCommit(sales_lane *lane, uint64_t pos)
+{
+    atomic_store_explicit(&lane->tail, pos + 1, memory_order_release);
+    waitSemPost(&lane_consumers[lane->owner].ready);
+}
+
+/**
+ * @fn const sale_record *lanePeekUntil(lane_consumer *c, sales_lane **lane, uint64_t *pos, const struct timespec *deadline)
+ * @brief Espera por uma venda em qualquer faixa do gerente `c` e devolve um ponteiro para ela.
+ *
+ * Cada ficha de `ready` corresponde a uma venda publicada em uma das faixas do gerente.
+ * Depois de `salesClose`, que fecha `ready`, o gerente não espera mais: lê o que restou
+ * nas suas faixas e, com todas vazias, retorna NULL com `errno` zero. O fechamento é lido
+ * antes da varredura, para que uma venda publicada antes dele nunca fique para trás. Se
+ * nenhuma ficha chegar até `deadline` (NULL espera indefinidamente), retorna NULL com
+ * `errno` igual a ETIMEDOUT.
+ */
+const sale_record *lanePeekUntil(lane_consumer *c, sales_lane **lane, uint64_t *pos, const struct timespec *deadline)
+{
+    for (;;)
+    {
+        int closed = waitSemClosed(&c->ready);
+        if (!closed && !waitSemWaitUntil(&c->ready, deadline) && !waitSemClosed(&c->ready))
+        {
+            errno = ETIMEDOUT;
+            return NULL;
+        }
+
+        // A faixa atual é visitada de novo ao fim da volta, por isso o limite inclui num_lanes.
+        for (int scanned = 0; scanned <= c->num_lanes; scanned++)
+        {
+            int index = c->lanes[c->cursor];
+            sales_lane *candidate = &lanes[index];
+            uint64_t head = atomic_load_explicit(&candidate->head, memory_order_relaxed);
+            if (c->burst < config.lane_weights[index] &&
+                atomic_load_explicit(&candidate->tail, memory_order_acquire) != head)
+            {
+                c->burst++;
+                *lane = candidate;
+                *pos = head;
+                return &candidate->slots[head % BUFFER_SIZE];
+            }
+            c->cursor = (c->cursor + 1) % c->num_lanes;
+            c->burst = 0;
+        }
+
+        if (closed)
+        {
+            errno = 0;
+            return NULL;
+        }
+    }
+}
+
+/**
+ * @fn void laneRelease(sales_lane *lane, uint64_t pos)
+ * @brief Devolve ao caixa a posição lida com `lanePeek`.
+ */
+void laneRelease(sales_lane *lane, uint64_t pos)
+{
+    atomic_store_explicit(&lane->head, pos + 1, memory_order_release);
+    waitSemPost(&lane->free_slots);
+}
+
+/**
+ * @struct shard_set
+ * @brief Filas particionadas por loja, cada partição com um gerente dono.
+ *
+ * Cada partição é um `sales_ring` próprio; o caixa escolhe a partição pelo hash da sua
+ * loja (`shardOf`), de modo que todas as vendas de uma loja passam pela mesma partição e,
+ * enquanto ela não mudar de dono, são processadas pelo mesmo gerente, que mantém os totais
+ * da loja quentes em cache. As fichas de `full_slots` das partições não são usadas: ao
+ * publicar, o caixa posta no `ready` do dono atual da partição, e o gerente procura
+ * vendas em todas as partições que possui. `salesClose` fecha os anéis e os `ready`.
+ *
+ * Quando uma partição de um gerente fica quente (ocupação de pelo menos
+ * HOT_SHARD_BACKLOG), o gerente cede a sua partição mais fria ao gerente menos ocupado,
+ * para se concentrar na quente (`maybeRebalance`). Como os anéis aceitam vários leitores,
+ * uma leitura em andamento pelo dono antigo durante a migração continua correta; só a
+ * afinidade é temporariamente perdida.
+ */
+typedef struct
+{
+    sales_ring *rings[NUM_SHARDS];        /**< Uma fila por partição. */
+    _Atomic int owner[NUM_SHARDS];        /**< Gerente dono de cada partição. */
+    wait_sem ready[NUM_CONSUMERS];        /**< Avisos de venda publicada para cada gerente. */
+    pthread_mutex_t rebalance_mutex;      /**< Serializa as migrações de partições. */
+    _Atomic int migrations;               /**< Partições que mudaram de dono. */
+    int64_t last_migration_ns;            /**< Instante da última migração (CLOCK_MONOTONIC); protegido pelo mutex. */
+} shard_set;
+
+shard_set shards;
+
+/**
+ * @fn uint32_t storeOf(int register_id)
+ * @brief Loja do caixa `register_id`; as lojas de índice baixo têm mais caixas.
+ */
+uint32_t storeOf(int register_id)
+{
+    return (uint32_t)((register_id - 1) % NUM_STORES);
+}
+
+/**
+ * @fn int shardOf(uint32_t store_id)
+ * @brief Partição da loja `store_id` (finalizador do MurmurHash3 sobre a chave).
+ */
+int shardOf(uint32_t store_id)
+{
+    uint32_t h = store_id;
+    h ^= h >> 16;
+    h *= 0x85ebca6bu;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35u;
+    h ^= h >> 16;
+    return (int)(h % NUM_SHARDS);
+}
+
+/**
+ * @fn static void shardsRelease(int num_ready, int num_rings)
+ * @brief Destrói os `ready` dos primeiros `num_ready` gerentes, os anéis das primeiras
+ * `num_rings` partições e o mutex de migração.
+ */
+static void shardsRelease(int num_ready, int num_rings)
+{
+    for (int s = 0; s < num_rings; s++)
+    {
+        ringDestroy(shards.rings[s]);
+    }
+    for (int c = 0; c < num_ready; c++)
+    {
+        waitSemDestroy(&shards.ready[c]);
+    }
+    pthread_mutex_destroy(&shards.rebalance_mutex);
+}
+
+/**
+ * @fn int shardsCreate(wait_strategy strategy)
+ * @brief Cria as partições e atribui a partição `s` ao gerente `s % NUM_CONSUMERS`.
+ *
+ * @return 0 em caso de sucesso, -1 em caso de falha.
+ */
+int shardsCreate(wait_strategy strategy)
+{
+    atomic_init(&shards.migrations, 0);
+    shards.last_migration_ns = 0;
+    pthread_mutex_init(&shards.rebalance_mutex, NULL);
+    for (int c = 0; c < NUM_CONSUMERS; c++)
+    {
+        if (waitSemInit(&shards.ready[c], strategy, 0) != 0)
+        {
+            shardsRelease(c, 0);
+            return -1;
+        }
+    }
+    for (int s = 0; s < NUM_SHARDS; s++)
+    {
+        atomic_init(&shards.owner[s], s % NUM_CONSUMERS);
+        shards.rings[s] = ringCreate(BUFFER_SIZE, strategy);
+        if (shards.rings[s] == NULL)
+        {
+            shardsRelease(NUM_CONSUMERS, s);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @fn void shardsDestroy(void)
+ * @brief Libera as partições.
+ */
+void shardsDestroy(void)
+{
+    shardsRelease(NUM_CONSUMERS, NUM_SHARDS);
+}
+
+/**
+ * @fn void shardCommit(int shard, uint64_t pos)
+ * @brief Publica a venda na partição `shard` e avisa o dono atual da partição.
+ */
+void shardCommit(int shard, uint64_t pos)
+{
+    ringPublish(shards.rings[shard], pos);
+    waitSemPost(&shards.ready[atomic_load(&shards.owner[shard])]);
+}
+
+/**
+ * @fn const sale_record *shardPeekUntil(int consumer_index, int *shard, uint64_t *pos, const struct timespec *deadline)
+ * @brief Espera por uma venda em alguma partição do gerente `consumer_index`.
+ *
+ * As fichas de `ready` são apenas avisos: depois de uma migração, o dono antigo pode
+ * acordar sem encontrar nada, e então volta a esperar. Depois que `salesClose` fecha o
+ * `ready`, o gerente não espera mais e, sem vendas nas suas partições, ajuda a esvaziar
+ * as dos outros; ele só retorna NULL (com `errno` zero) quando todas as partições estão
+ * vazias. Se o prazo `deadline` vencer antes (NULL espera indefinidamente), retorna NULL
+ * com `errno` igual a ETIMEDOUT.
+ */
+const sale_record *shardPeekUntil(int consumer_index, int *shard, uint64_t *pos, const struct timespec *deadline)
+{
+    for (;;)
+    {
+        int closed = waitSemClosed(&shards.ready[consumer_index]);
+        if (!closed && !waitSemWaitUntil(&shards.ready[consumer_index], deadline) &&
+            !waitSemClosed(&shards.ready[consumer_index]))
+        {
+            errno = ETIMEDOUT;
+            return NULL;
+        }
+
+        for (int pass = 0; pass < 2; pass++)
+        {
+            for (int s = 0; s < NUM_SHARDS; s++)
+            {
+                if (pass == 0 && atomic_load_explicit(&shards.owner[s], memory_order_relaxed) != consumer_index)
+                {
+                    continue;
+                }
+                const sale_record *sale = ringTryPeek(shards.rings[s], pos);
+                if (sale != NULL)
+                {
+                    *shard = s;
+                    return sale;
+                }
+            }
+            if (!closed)
+            {
+                break;
+            }
+        }
+
+        if (closed)
+        {
+            errno = 0;
+            return NULL;
+        }
+    }
+}
+
+/**
+ * @fn int maybeRebalance(int consumer_index, int *target)
+ * @brief Cede uma partição fria do gerente `consumer_index` se uma das suas estiver quente.
+ *
+ * A partição cedida é a de menor ocupação entre as do gerente, exceto a mais quente, e
+ * vai para o gerente cuja soma de ocupações é a menor, desde que ele continue menos ocupado
+ * que o próprio gerente depois da troca. Migrações ficam espaçadas por pelo menos
+ * REBALANCE_COOLDOWN_NS, para que a ocupação reflita a nova distribuição antes da próxima.
+ * Depois de trocar o dono, posta no `ready` do novo dono uma ficha por venda pendente na
+ * partição, já que as fichas dessas vendas foram para o dono antigo.
+ *
+ * @return A partição cedida (com o novo dono em `*target`), ou -1 se nada mudou.
+ */
+int maybeRebalance(int consumer_index, int *target)
+{
+    if (waitSemClosed(&shards.ready[consumer_index]))
+    {
+        return -1;
+    }
+
+    pthread_mutex_lock(&shards.rebalance_mutex);
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    int64_t now_ns = (int64_t)now.tv_sec * 1000000000LL + now.tv_nsec;
+    if (shards.last_migration_ns != 0 && now_ns - shards.last_migration_ns < REBALANCE_COOLDOWN_NS)
+    {
+        pthread_mutex_unlock(&shards.rebalance_mutex);
+        return -1;
+    }
+
+    int load[NUM_CONSUMERS] = {0};
+    int hottest = -1, coldest = -1, owned = 0;
+    for (int s = 0; s < NUM_SHARDS; s++)
+    {
+        int owner = atomic_load(&shards.owner[s]);
+        int backlog = ringSize(shards.rings[s]);
+        load[owner] += backlog;
+        if (owner != consumer_index)
+        {
+            continue;
+        }
+        owned++;
+        if (hottest < 0 || backlog > ringSize(shards.rings[hottest]))
+        {
+            hottest = s;
+        }
+    }
+    for (int s = 0; s < NUM_SHARDS; s++)
+    {
+        if (s != hottest && atomic_load(&shards.owner[s]) == consumer_index &&
+            (coldest < 0 || ringSize(shards.rings[s]) < ringSize(shards.rings[coldest])))
+        {
+            coldest = s;
+        }
+    }
+
+    int moved = -1;
+    if (owned >= 2 && ringSize(shards.rings[hottest]) >= HOT_SHARD_BACKLOG)
+    {
+        int best = -1;
+        for (int c = 0; c < NUM_CONSUMERS; c++)
+        {
+            if (c != consumer_index && (best < 0 || load[c] < load[best]))
+            {
+                best = c;
+            }
+        }
+        // Só migra se, depois da troca, o outro gerente continuar menos ocupado; sem essa
+        // margem a mesma partição iria e voltaria entre dois gerentes sobrecarregados.
+        int cold_backlog = ringSize(shards.rings[coldest]);
+        if (best >= 0 && load[best] + cold_backlog < load[consumer_index] - cold_backlog)
+        {
+            atomic_store(&shards.owner[coldest], best);
+            int pending = ringSize(shards.rings[coldest]);
+            for (int i = 0; i < pending; i++)
+            {
+                waitSemPost(&shards.ready[best]);
+            }
+            atomic_fetch_add(&shards.migrations, 1);
+            shards.last_migration_ns = now_ns;
+            *target = best;
+            moved = coldest;
+        }
+    }
+
+    pthread_mutex_unlock(&shards.rebalance_mutex);
+    return moved;
+}
+
+/**
+ * @struct priority_set
+ * @brief Filas por nível de prioridade, lidas de forma estrita ou ponderada.
+ *
+ * Cada nível é um `sales_ring` próprio, usado como na topologia por loja: as fichas de
+ * `full_slots` não são usadas e o caixa, ao publicar, posta uma ficha em `ready`, comum a
+ * todos os gerentes. Cada ficha corresponde a exatamente uma venda publicada em algum nível
+ * (`evictOldest` retira a ficha junto com a venda descartada), de modo que o gerente que
+ * pegou uma ficha sempre encontra uma venda, ainda que precise procurar de novo quando outro
+ * gerente levou a que ele viu primeiro.
+ *
+ * Na leitura estrita, o gerente sempre pega a venda do nível mais urgente que não está vazio.
+ * Na ponderada (`config.priority_weights`), cada gerente tem créditos por nível: lê do nível
+ * mais urgente que tenha venda e crédito e, quando nenhum nível com vendas tem crédito, os
+ * créditos voltam aos pesos. Assim, sob carga, cada nível recebe uma fração dos gerentes
+ * proporcional ao seu peso, e os níveis menos urgentes nunca ficam sem atendimento.
+ *
+ * Com todas as vendas no nível normal, o custo em relação à topologia de anel é a leitura de
+ * `available` dos dois anéis vazios a cada venda.
+ */
+typedef struct
+{
+    sales_ring *rings[NUM_PRIORITIES];           /**< Uma fila por nível. */
+    wait_sem ready;                              /**< Uma ficha por venda publicada em qualquer nível. */
+    int credits[NUM_CONSUMERS][NUM_PRIORITIES];  /**< Créditos restantes de cada gerente na leitura ponderada. */
+} priority_set;
+
+priority_set priorities;
+
+/**
+ * @fn sale_priority priorityOf(int64_t amount_cents)
+ * @brief Nível de prioridade de uma venda de `amount_cents`.
+ */
+sale_priority priorityOf(int64_t amount_cents)
+{
+    if (amount_cents < 0)
+    {
+        return PRIORITY_REFUND;
+    }
+    if (config.high_value_cents > 0 && amount_cents >= config.high_value_cents)
+    {
+        return PRIORITY_HIGH;
+    }
+    return PRIORITY_NORMAL;
+}
+
+/**
+ * @fn int prioritiesCreate(wait_strategy strategy)
+ * @brief Cria um anel por nível de prioridade, com os créditos dos gerentes cheios.
+ *
+ * @return 0 em caso de sucesso, -1 em caso de falha.
+ */
+int prioritiesCreate(wait_strategy strategy)
+{
+    if (waitSemInit(&priorities.ready, strategy, 0) != 0)
+    {
+        return -1;
+    }
+    for (int p = 0; p < NUM_PRIORITIES; p++)
+    {
+        for (int c = 0; c < NUM_CONSUMERS; c++)
+        {
+            priorities.credits[c][p] = config.priority_weights[p];
+        }
+        priorities.rings[p] = ringCreate(BUFFER_SIZE, strategy);
+        if (priorities.rings[p] == NULL)
+        {
+            while (--p >= 0)
+            {
+                ringDestroy(priorities.rings[p]);
+            }
+            waitSemDestroy(&priorities.ready);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @fn void prioritiesDestroy(void)
+ * @brief Libera os anéis de prioridade.
+ */
+void prioritiesDestroy(void)
+{
+    for (int p = 0; p < NUM_PRIORITIES; p++)
+    {
+        ringDestroy(priorities.rings[p]);
+    }
+    waitSemDestroy(&priorities.ready);
+}
+
+/**
+ * @fn void priorityCommit(int priority, uint64_t pos)
+ * @brief Publica a venda no anel do nível `priority` e avisa os gerentes.
+ */
+void priorityCommit(int priority, uint64_t pos)
+{
+    ringPublish(priorities.rings[priority], pos);
+    waitSemPost(&priorities.ready);
+}
+
+/**
+ * @fn static const sale_record *priorityScan(int consumer_index, int *priority, uint64_t *pos)
+ * @brief Procura, sem esperar, a próxima venda do gerente `consumer_index` segundo a ordem
+ * estrita ou ponderada.
+ *
+ * @return A venda, com o nível em `*priority`, ou NULL se todos os níveis estão vazios.
+ */
+static const sale_record *priorityScan(int consumer_index, int *priority, uint64_t *pos)
+{
+    if (config.priority_weights[0] == 0)
+    {
+        for (int p = 0; p < NUM_PRIORITIES; p++)
+        {
+            const sale_record *sale = ringTryPeek(priorities.rings[p], pos);
+            if (sale != NULL)
+            {
+                *priority = p;
+                return sale;
+            }
+        }
+        return NULL;
+    }
+
+    int *credits = priorities.credits[consumer_index];
+    for (int pass = 0; pass < 2; pass++)
+    {
+        for (int p = 0; p < NUM_PRIORITIES; p++)
+        {
+            if (credits[p] == 0)
+            {
+                continue;
+            }
+            const sale_record *sale = ringTryPeek(priorities.rings[p], pos);
+            if (sale != NULL)
+            {
+                credits[p]--;
+                *priority = p;
+                return sale;
+            }
+        }
+        // Nenhum nível com vendas tem crédito: começa uma nova rodada.
+        for (int p = 0; p < NUM_PRIORITIES; p++)
+        {
+            credits[p] = config.priority_weights[p];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @fn const sale_record *priorityPeekUntil(int consumer_index, int *priority, uint64_t *pos, const struct timespec *deadline)
+ * @brief Espera por uma venda em qualquer nível e devolve a próxima do gerente
+ * `consumer_index` segundo a ordem de leitura.
+ *
+ * Com uma ficha em mãos, o gerente procura até achar a venda correspondente. Depois de
+ * `salesClose`, ele lê sem esperar e, com todos os níveis vazios, retorna NULL com `errno`
+ * zero; o fechamento é lido antes da procura, como em `lanePeekUntil`. Se nenhuma ficha
+ * chegar até `deadline` (NULL espera indefinidamente), retorna NULL com `errno` igual a
+ * ETIMEDOUT.
+ */
+const sale_record *priorityPeekUntil(int consumer_index, int *priority, uint64_t *pos, const struct timespec *deadline)
+{
+    if (!waitSemClosed(&priorities.ready) && !waitSemWaitUntil(&priorities.ready, deadline) &&
+        !waitSemClosed(&priorities.ready))
+    {
+        errno = ETIMEDOUT;
+        return NULL;
+    }
+
+    for (;;)
+    {
+        int closed = waitSemClosed(&priorities.ready);
+        const sale_record *sale = priorityScan(consumer_index, priority, pos);
+        if (sale != NULL)
+        {
+            return sale;
+        }
+        if (closed)
+        {
+            errno = 0;
+            return NULL;
+        }
+        sched_yield();
+    }
+}
+
+/**
+ * @struct queue_segment
+ * @brief Segmento da fila segmentada: SEGMENT_SLOTS posições com o protocolo de sequência
+ * de `ring_slot`.
+ *
+ * O segmento lógico `id` guarda as posições `id * SEGMENT_SLOTS` em diante. Quando os
+ * gerentes devolvem todas as suas posições, ele sai do diretório e volta ao pool, de onde
+ * é reaproveitado por um segmento lógico posterior sem passar pelo `malloc`.
+ */
+typedef struct
+{
+    _Alignas(64) _Atomic uint64_t id;  /**< Segmento lógico que ocupa, ou SEGMENT_FREE no pool. */
+    _Atomic uint32_t released;         /**< Posições já devolvidas pelos gerentes. */
+    _Atomic uint32_t pool_next;        /**< Próximo segmento do pool (índice em `table` mais 1; 0 termina). */
+    uint32_t index;                    /**< Índice do segmento em `segment_queue.table`. */
+    ring_slot slots[SEGMENT_SLOTS];    /**< Posições do segmento. */
+} queue_segment;
+
+/**
+ * @struct segment_queue
+ * @brief Fila MPMC sem limite fixo, feita de segmentos ligados pelo diretório e
+ * reaproveitados por um pool sem travas.
+ *
+ * Produtores e gerentes reservam posições com `tail`, `head` e `available` como no
+ * `sales_ring`, mas a posição `p` mora no segmento lógico `p / SEGMENT_SLOTS`, que fica na
+ * entrada `id % SEGMENT_DIRECTORY` do diretório. Quem precisa de um segmento ainda não
+ * instalado o tira do pool (ou, com o pool vazio, do `malloc`) e o instala com um CAS; quem
+ * perde a corrida o devolve. Assim, depois do aquecimento, rajadas são absorvidas só com
+ * segmentos reaproveitados.
+ *
+ * O pool é uma pilha de Treiber sobre índices de `table`, com um contador de versão nos 32
+ * bits altos de `pool` contra o problema ABA. Os segmentos só são liberados em
+ * `segmentsDestroy`.
+ *
+ * O limite de memória é brando: `free_slots` começa com o número de vendas que cabem no
+ * limite e, abaixo dele, o caixa nunca espera; ao atingi-lo, vale `config.overflow`. Como
+ * os segmentos são alocados inteiros, a memória em uso pode passar do limite em até dois
+ * segmentos.
+ */
+typedef struct
+{
+    _Alignas(64) _Atomic uint64_t tail;                  /**< Próxima posição a ser reservada por um caixa. */
+    _Alignas(64) _Atomic uint64_t head;                  /**< Próxima posição a ser lida por um gerente. */
+    _Atomic uint64_t available;                          /**< Vendas publicadas ainda não reservadas, mais RING_CLOSED. */
+    _Alignas(64) _Atomic uint64_t pool;                  /**< Topo do pool: versão e índice mais 1. */
+    _Atomic uint32_t allocated;                          /**< Segmentos alocados com `malloc`. */
+    _Atomic int64_t reused;                              /**< Segmentos tirados do pool. */
+    _Atomic int live;                                    /**< Segmentos instalados no diretório. */
+    _Atomic int peak;                                    /**< Maior valor de `live`. */
+    size_t cap_slots;                                    /**< Vendas que cabem no limite de memória. */
+    wait_sem free_slots;                                 /**< Vendas que ainda cabem no limite de memória. */
+    wait_sem full_slots;                                 /**< Vendas publicadas. */
+    _Atomic(queue_segment *) directory[SEGMENT_DIRECTORY]; /**< Segmento instalado de cada entrada. */
+    queue_segment *table[SEGMENT_DIRECTORY + NUM_PRODUCERS + NUM_CONSUMERS]; /**< Segmentos alocados. */
+} segment_queue;
+
+segment_queue *segments = NULL;
+
+/**
+ * @fn int segmentsCreate(wait_strategy strategy)
+ * @brief Cria a fila segmentada vazia, com o limite de `config.segment_cap_bytes`.
+ *
+ * @return 0 em caso de sucesso, -1 em caso de falha.
+ */
+int segmentsCreate(wait_strategy strategy)
+{
+    segments = aligned_alloc(64, sizeof(segment_queue));
+    if (segments == NULL)
+    {
+        return -1;
+    }
+    memset(segments, 0, sizeof(segment_queue));
+
+    // Com no máximo SEGMENT_DIRECTORY - 2 segmentos de vendas pendentes, os segmentos vivos
+    // nunca disputam uma entrada do diretório.
+    size_t max_slots = (size_t)(SEGMENT_DIRECTORY - 2) * SEGMENT_SLOTS;
+    size_t cap = config.segment_cap_bytes > 0 ? (size_t)config.segment_cap_bytes / sizeof(ring_slot) : max_slots;
+    segments->cap_slots = cap < SEGMENT_SLOTS ? SEGMENT_SLOTS : cap > max_slots ? max_slots : cap;
+    if (waitSemInit(&segments->free_slots, strategy, (unsigned int)segments->cap_slots) != 0 ||
+        waitSemInit(&segments->full_slots, strategy, 0) != 0)
+    {
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @fn void segmentsDestroy(void)
+ * @brief Libera a fila segmentada e todos os segmentos alocados.
+ */
+void segmentsDestroy(void)
+{
+    for (uint32_t i = 0; i < atomic_load(&segments->allocated); i++)
+    {
+        free(segments->table[i]);
+    }
+    waitSemDestroy(&segments->free_slots);
+    waitSemDestroy(&segments->full_slots);
+    free(segments);
+    segments = NULL;
+}
+
+/**
+ * @fn static void segmentPoolPush(queue_segment *seg)
+ * @brief Devolve `seg` ao pool.
+ */
+static void segmentPoolPush(queue_segment *seg)
+{
+    uint64_t top = atomic_load_explicit(&segments->pool, memory_order_relaxed);
+    uint64_t next;
+    do
+    {
+        atomic_store_explicit(&seg->pool_next, (uint32_t)top, memory_order_relaxed);
+        next = (((top >> 32) + 1) << 32) | (seg->index + 1);
+    } while (!atomic_compare_exchange_weak_explicit(&segments->pool, &top, next, memory_order_release,
+                                                    memory_order_relaxed));
+}
+
+/**
+ * @fn static queue_segment *segmentPoolPop(void)
+ * @brief Tira um segmento do pool, ou, com o pool vazio, aloca um novo.
+ *
+ * @return O segmento, ou NULL se faltar memória.
+ */
+static queue_segment *segmentPoolPop(void)
+{
+    uint64_t top = atomic_load_explicit(&segments->pool, memory_order_acquire);
+    while ((uint32_t)top != 0)
+    {
+        queue_segment *seg = segments->table[(uint32_t)top - 1];
+        uint64_t next = (((top >> 32) + 1) << 32) | atomic_load_explicit(&seg->pool_next, memory_order_relaxed);
+        if (atomic_compare_exchange_weak_explicit(&segments->pool, &top, next, memory_order_acquire,
+                                                  memory_order_acquire))
+        {
+            atomic_fetch_add_explicit(&segments->reused, 1, memory_order_relaxed);
+            return seg;
+        }
+    }
+
+    uint32_t index = atomic_fetch_add(&segments->allocated, 1);
+    if (index >= sizeof(segments->table) / sizeof(segments->table[0]))
+    {
+        atomic_fetch_sub(&segments->allocated, 1);
+        return NULL;
+    }
+    queue_segment *seg = aligned_alloc(64, sizeof(queue_segment));
+    segments->table[index] = seg;
+    if (seg != NULL)
+    {
+        seg->index = index;
+    }
+    return seg;
+}
+
+/**
+ * @fn static queue_segment *segmentFor(uint64_t id)
+ * @brief Segmento lógico `id`, instalando-o no diretório se ainda não estiver lá.
+ *
+ * Só é chamada por quem tem uma posição do segmento ainda não devolvida, de modo que o
+ * segmento não pode ser reaproveitado enquanto a função o usa. Se a entrada do diretório
+ * ainda guarda um segmento anterior, espera que ele seja esvaziado.
+ */
+static queue_segment *segmentFor(uint64_t id)
+{
+    _Atomic(queue_segment *) *entry = &segments->directory[id % SEGMENT_DIRECTORY];
+    for (;;)
+    {
+        queue_segment *seg = atomic_load_explicit(entry, memory_order_acquire);
+        if (seg != NULL && atomic_load_explicit(&seg->id, memory_order_acquire) == id)
+        {
+            return seg;
+        }
+        queue_segment *fresh = seg == NULL ? segmentPoolPop() : NULL;
+        if (fresh == NULL)
+        {
+            sched_yield();
+            continue;
+        }
+
+        for (uint64_t i = 0; i < SEGMENT_SLOTS; i++)
+        {
+            atomic_store_explicit(&fresh->slots[i].sequence, id * SEGMENT_SLOTS + i, memory_order_relaxed);
+        }
+        atomic_store_explicit(&fresh->released, 0, memory_order_relaxed);
+        atomic_store_explicit(&fresh->id, id, memory_order_release);
+        if (atomic_compare_exchange_strong(entry, &seg, fresh))
+        {
+            int live = atomic_fetch_add(&segments->live, 1) + 1;
+            int peak = atomic_load(&segments->peak);
+            while (live > peak && !atomic_compare_exchange_weak(&segments->peak, &peak, live))
+            {
+            }
+            return fresh;
+        }
+        atomic_store_explicit(&fresh->id, SEGMENT_FREE, memory_order_relaxed);
+        segmentPoolPush(fresh);
+    }
+}
+
+/**
+ * @fn sale_record *segmentClaimUntil(uint64_t *pos, const struct timespec *deadline)
+ * @brief Reserva a próxima posição da fila segmentada, esperando até `deadline` (NULL sem
+ * prazo) só se o limite de memória foi atingido.
+ *
+ * @return A posição, ou NULL com `errno` igual a ETIMEDOUT se o limite continuar atingido,
+ * ou EPIPE se a fila foi fechada.
+ */
+sale_record *segmentClaimUntil(uint64_t *pos, const struct timespec *deadline)
+{
+    if (!waitSemWaitUntil(&segments->free_slots, deadline))
+    {
+        errno = waitSemClosed(&segments->free_slots) ? EPIPE : ETIMEDOUT;
+        return NULL;
+    }
+    if (atomic_load(&segments->available) & RING_CLOSED)
+    {
+        // A ficha foi obtida, mas a fila fechou: devolvida para não sumir do limite.
+        waitSemPost(&segments->free_slots);
+        errno = EPIPE;
+        return NULL;
+    }
+    uint64_t p = atomic_fetch_add_explicit(&segments->tail, 1, memory_order_relaxed);
+    *pos = p;
+    return &segmentFor(p / SEGMENT_SLOTS)->slots[p % SEGMENT_SLOTS].sale;
+}
+
+/**
+ * @fn void segmentCommit(uint64_t pos)
+ * @brief Publica a venda escrita na posição `pos` da fila segmentada.
+ */
+void segmentCommit(uint64_t pos)
+{
+    ring_slot *slot = &segmentFor(pos / SEGMENT_SLOTS)->slots[pos % SEGMENT_SLOTS];
+    atomic_store_explicit(&slot->sequence, pos + 1, memory_order_release);
+    atomic_fetch_add(&segments->available, 1);
+    waitSemPost(&segments->full_slots);
+}
+
+/**
+ * @fn const sale_record *segmentPeekUntil(uint64_t *pos, const struct timespec *deadline)
+ * @brief Reserva a próxima venda publicada da fila segmentada, com a mesma semântica de
+ * prazo e fechamento de `ringPeekUntil`.
+ */
+const sale_record *segmentPeekUntil(uint64_t *pos, const struct timespec *deadline)
+{
+    for (;;)
+    {
+        if (!waitSemWaitUntil(&segments->full_slots, deadline) && !waitSemClosed(&segments->full_slots))
+        {
+            errno = ETIMEDOUT;
+            return NULL;
+        }
+
+        uint64_t avail = atomic_load_explicit(&segments->available, memory_order_acquire);
+        do
+        {
+            if ((avail & ~RING_CLOSED) == 0)
+            {
+                break;
+            }
+        } while (!atomic_compare_exchange_weak_explicit(&segments->available, &avail, avail - 1,
+                                                        memory_order_acquire, memory_order_acquire));
+        if ((avail & ~RING_CLOSED) == 0)
+        {
+            if (avail & RING_CLOSED)
+            {
+                errno = 0;
+                return NULL;
+            }
+            continue;
+        }
+
+        uint64_t p = atomic_fetch_add_explicit(&segments->head, 1, memory_order_relaxed);
+        ring_slot *slot = &segmentFor(p / SEGMENT_SLOTS)->slots[p % SEGMENT_SLOTS];
+        while (atomic_load_explicit(&slot->sequence, memory_order_acquire) != p + 1)
+        {
+            sched_yield();
+        }
+        *pos = p;
+        return &slot->sale;
+    }
+}
+
+/**
+ * @fn void segmentRelease(uint64_t pos)
+ * @brief Devolve a posição `pos` da fila segmentada; o último gerente a devolver uma
+ * posição de um segmento o tira do diretório e o devolve ao pool.
+ */
+void segmentRelease(uint64_t pos)
+{
+    uint64_t id = pos / SEGMENT_SLOTS;
+    queue_segment *seg = segmentFor(id);
+    if (atomic_fetch_add_explicit(&seg->released, 1, memory_order_acq_rel) + 1 == SEGMENT_SLOTS)
+    {
+        atomic_store_explicit(&seg->id, SEGMENT_FREE, memory_order_relaxed);
+        atomic_store_explicit(&segments->directory[id % SEGMENT_DIRECTORY], NULL, memory_order_release);
+        atomic_fetch_sub(&segments->live, 1);
+        segmentPoolPush(seg);
+    }
+    waitSemPost(&segments->free_slots);
+}
+
+/**
+ * @fn void segmentsClose(void)
+ * @brief Fecha a fila segmentada, como `ringClose`.
+ */
+void segmentsClose(void)
+{
+    if (atomic_fetch_or(&segments->available, RING_CLOSED) & RING_CLOSED)
+    {
+        return;
+    }
+    waitSemClose(&segments->full_slots);
+    waitSemClose(&segments->free_slots);
+}
+
+/**
+ * @fn void printSegmentStats(const char *indent)
+ * @brief Imprime, precedidos de `indent`, os segmentos alocados, os reaproveitados do pool
+ * e o pico de segmentos em uso da fila segmentada.
+ */
+void printSegmentStats(const char *indent)
+{
+    uint32_t allocated = atomic_load(&segments->allocated);
+    printf("%sFila segmentada: %" PRIu32 " segmentos alocados (%.1f MiB), %" PRId64
+           " reaproveitados do pool, pico de %d em uso, limite de %zu vendas\n",
+           indent, allocated, allocated * (double)sizeof(queue_segment) / (1 << 20), atomic_load(&segments->reused),
+           atomic_load(&segments->peak), segments->cap_slots);
+}
+
+/**
+ * @struct overflow_counters
+ * @brief Contadores das políticas de fila cheia, atualizados pelos caixas e gerentes.
+ */
+typedef struct
+{
+    _Atomic int64_t blocked_ns;     /**< Tempo total dos caixas esperando por espaço. */
+    _Atomic int64_t dropped_oldest; /**< Vendas antigas descartadas para abrir espaço. */
+    _Atomic int64_t dropped_newest; /**< Vendas novas descartadas (inclusive com o transbordo cheio). */
+    _Atomic int64_t spilled;        /**< Vendas gravadas no arquivo de transbordo. */
+    _Atomic int64_t drained;        /**< Vendas lidas do arquivo de transbordo pelos gerentes. */
+    _Atomic int64_t timed_out;      /**< Vendas descartadas porque o prazo de `--prazo-ms` venceu. */
+} overflow_counters;
+
+overflow_counters overflow_stats;
+
+/**
+ * @struct spill_log
+ * @brief Arquivo de transbordo mapeado em memória.
+ *
+ * O arquivo é um vetor de `sale_record` de SPILL_CAPACITY posições, criado esparso com
+ * `ftruncate`. Os caixas acrescentam no fim e os gerentes leem do início, ambos sob
+ * `mutex`: o transbordo só é usado com a fila cheia, e o custo do bloqueio é pequeno
+ * perto do da fila que ele alivia. Quando o arquivo enche, a venda é descartada.
+ */
+typedef struct
+{
+    sale_record *records;    /**< Mapeamento do arquivo. */
+    uint64_t write_pos;      /**< Próxima posição a ser gravada. */
+    uint64_t read_pos;       /**< Próxima posição a ser lida. */
+    _Atomic int64_t pending; /**< Vendas gravadas e ainda não lidas; consultado sem o mutex. */
+    pthread_mutex_t mutex;   /**< Protege `write_pos` e `read_pos`. */
+    int fd;                  /**< Descritor do arquivo. */
+} spill_log;
+
+spill_log spill = {.fd = -1};
+
+/**
+ * @fn int spillOpen(const char *path)
+ * @brief Cria (ou trunca) e mapeia o arquivo de transbordo `path`.
+ *
+ * @return 0 em caso de sucesso, -1 em caso de falha.
+ */
+int spillOpen(const char *path)
+{
+    size_t bytes = (size_t)SPILL_CAPACITY * sizeof(sale_record);
+    spill.fd = open(path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (spill.fd < 0 || ftruncate(spill.fd, (off_t)bytes) != 0)
+    {
+        return -1;
+    }
+    spill.records = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, spill.fd, 0);
+    if (spill.records == MAP_FAILED)
+    {
+        spill.records = NULL;
+        return -1;
+    }
+    spill.write_pos = 0;
+    spill.read_pos = 0;
+    atomic_init(&spill.pending, 0);
+    pthread_mutex_init(&spill.mutex, NULL);
+    return 0;
+}
+
+/**
+ * @fn void spillClose(const char *path)
+ * @brief Desfaz o mapeamento e remove o arquivo se todas as vendas foram lidas.
+ */
+void spillClose(const char *path)
+{
+    if (spill.records != NULL)
+    {
+        munmap(spill.records, (size_t)SPILL_CAPACITY * sizeof(sale_record));
+        pthread_mutex_destroy(&spill.mutex);
+        spill.records = NULL;
+    }
+    if (spill.fd >= 0)
+    {
+        close(spill.fd);
+        spill.fd = -1;
+        if (atomic_load(&spill.pending) == 0)
+        {
+            unlink(path);
+        }
+    }
+}
+
+/**
+ * @fn int spillAppend(const sale_record *sale)
+ * @brief Acrescenta `sale` ao arquivo de transbordo.
+ *
+ * @return 1 se gravou, 0 se o arquivo está cheio.
+ */
+int spillAppend(const sale_record *sale)
+{
+    pthread_mutex_lock(&spill.mutex);
+    int stored = spill.write_pos < SPILL_CAPACITY;
+    if (stored)
+    {
+        spill.records[spill.write_pos++] = *sale;
+        atomic_fetch_add(&spill.pending, 1);
+    }
+    pthread_mutex_unlock(&spill.mutex);
+    return stored;
+}
+
+/**
+ * @fn int spillTake(sale_record *sale)
+ * @brief Copia para `sale` a venda mais antiga do arquivo de transbordo.
+ *
+ * @return 1 se havia uma venda, 0 se o arquivo está vazio (ou o transbordo desativado).
+ */
+int spillTake(sale_record *sale)
+{
+    if (spill.records == NULL || atomic_load_explicit(&spill.pending, memory_order_relaxed) == 0)
+    {
+        return 0;
+    }
+
+    pthread_mutex_lock(&spill.mutex);
+    int taken = spill.read_pos < spill.write_pos;
+    if (taken)
+    {
+        *sale = spill.records[spill.read_pos++];
+        atomic_fetch_sub(&spill.pending, 1);
+    }
+    pthread_mutex_unlock(&spill.mutex);
+    if (taken)
+    {
+        atomic_fetch_add_explicit(&overflow_stats.drained, 1, memory_order_relaxed);
+    }
+    return taken;
+}
+
+/**
+ * @enum slot_outcome
+ * @brief Destino de uma venda reservada por `salesClaim`.
+ */
+typedef enum
+{
+    SLOT_QUEUED,  /**< Posição da fila; a venda será publicada. */
+    SLOT_SPILLED, /**< Fila cheia: a venda vai para o arquivo de transbordo. */
+    SLOT_DROPPED, /**< Fila cheia: a venda será descartada. */
+    SLOT_TIMED_OUT, /**< Fila cheia até o prazo: a venda será descartada. */
+} slot_outcome;
+
+/**
+ * @struct slot_ref
+ * @brief Posição reservada por `salesClaim` ou `salesPeek`, em qualquer topologia.
+ *
+ * Quando a fila está cheia e a política não é bloquear, `salesClaim` devolve `scratch`
+ * para que o caixa escreva a venda, e `outcome` diz o que `salesCommit` fará com ela.
+ */
+typedef struct
+{
+    sales_lane *lane;     /**< Faixa da posição, ou NULL nas demais topologias. */
+    int shard;            /**< Partição da posição na topologia por loja, ou -1. */
+    int priority;         /**< Nível da posição na topologia de prioridades, ou -1. */
+    int segmented;        /**< Diferente de zero se a posição é da fila segmentada. */
+    uint64_t pos;         /**< Posição lógica. */
+    slot_outcome outcome; /**< Destino da venda. */
+    sale_record scratch;  /**< Área de escrita das vendas que não entram na fila. */
+} slot_ref;
+
+/**
+ * @fn int salesCreate(wait_strategy strategy)
+ * @brief Cria as filas da topologia `config.topology`, zera os contadores de fila cheia e,
+ * com a política `disco`, abre o arquivo de transbordo.
+ *
+ * Com `config.shm_name`, o anel fica em memória compartilhada: o processo dos caixas o
+ * cria e o dos gerentes o abre (`ringCreateShared`, `ringAttachShared`).
+ *
+ * @return 0 em caso de sucesso, -1 em caso de falha.
+ */
+int salesCreate(wait_strategy strategy)
+{
+    atomic_store(&overflow_stats.blocked_ns, 0);
+    atomic_store(&overflow_stats.dropped_oldest, 0);
+    atomic_store(&overflow_stats.dropped_newest, 0);
+    atomic_store(&overflow_stats.spilled, 0);
+    atomic_store(&overflow_stats.drained, 0);
+    atomic_store(&overflow_stats.timed_out, 0);
+    if (config.overflow == OVERFLOW_SPILL && spillOpen(config.spill_path) != 0)
+    {
+        return -1;
+    }
+
+    if (config.topology == TOPOLOGY_LANES)
+    {
+        return lanesCreate(strategy);
+    }
+    if (config.topology == TOPOLOGY_SHARDS)
+    {
+        return shardsCreate(strategy);
+    }
+    if (config.topology == TOPOLOGY_PRIORITY)
+    {
+        return prioritiesCreate(strategy);
+    }
+    if (config.topology == TOPOLOGY_SEGMENTS)
+    {
+        return segmentsCreate(strategy);
+    }
+    if (config.shm_name != NULL)
+    {
+        ring = config.role == SHM_MANAGERS ? ringAttachShared(config.shm_name, SHM_ATTACH_TIMEOUT_NS)
+                                           : ringCreateShared(config.shm_name, BUFFER_SIZE, strategy);
+        return ring == NULL ? -1 : 0;
+    }
+    ring = ringCreate(BUFFER_SIZE, strategy);
+    return ring == NULL ? -1 : 0;
+}
+
+/**
+ * @fn void salesDestroy(void)
+ * @brief Libera as filas criadas por `salesCreate`.
+ */
+void salesDestroy(void)
+{
+    spillClose(config.spill_path);
+    if (config.topology == TOPOLOGY_LANES)
+    {
+        lanesDestroy();
+        return;
+    }
+    if (config.topology == TOPOLOGY_SHARDS)
+    {
+        shardsDestroy();
+        return;
+    }
+    if (config.topology == TOPOLOGY_PRIORITY)
+    {
+        prioritiesDestroy();
+        return;
+    }
+    if (config.topology == TOPOLOGY_SEGMENTS)
+    {
+        segmentsDestroy();
+        return;
+    }
+    if (config.shm_name != NULL)
+    {
+        ringDetachShared(ring, config.shm_name, config.role != SHM_REGISTERS);
+    }
+    else
+    {
+        ringDestroy(ring);
+    }
+    ring = NULL;
+}
+
+/**
+ * @fn static sales_ring *refRing(const slot_ref *ref)
+ * @brief Anel de `ref` nas topologias de anel, por loja e de prioridades.
+ */
+static sales_ring *refRing(const slot_ref *ref)
+{
+    if (ref->priority >= 0)
+    {
+        return priorities.rings[ref->priority];
+    }
+    return ref->shard >= 0 ? shards.rings[ref->shard] : ring;
+}
+
+/**
+ * @fn static int evictOldest(sales_ring *r)
+ * @brief Descarta a venda publicada mais antiga de `r` que nenhum gerente reservou.
+ *
+ * Nas topologias de anel e de prioridades, a ficha correspondente (de `full_slots` ou de
+ * `priorities.ready`) é retirada junto, para que a contagem de fichas continue igual à de
+ * vendas. Na topologia por loja as fichas são só avisos e o dono acorda à toa uma vez.
+ *
+ * @return 1 se descartou uma venda, 0 se todas as vendas da fila já estão sendo lidas.
+ */
+static int evictOldest(sales_ring *r)
+{
+    wait_sem *tokens = config.topology == TOPOLOGY_RING       ? &r->full_slots
+                       : config.topology == TOPOLOGY_PRIORITY ? &priorities.ready
+                                                              : NULL;
+    if (tokens != NULL && !waitSemTryWait(tokens))
+    {
+        return 0;
+    }
+
+    uint64_t pos;
+    if (ringTryPeek(r, &pos) == NULL)
+    {
+        if (tokens != NULL)
+        {
+            waitSemPost(tokens);
+        }
+        return 0;
+    }
+
+    ringRelease(r, pos);
+    atomic_fetch_add_explicit(&overflow_stats.dropped_oldest, 1, memory_order_relaxed);
+    return 1;
+}
+
+/**
+ * @fn static void refInit(int producer_index, sale_priority priority, slot_ref *ref)
+ * @brief Aponta `ref` para a fila do caixa `producer_index` (a partir de 0) e, na topologia
+ * de prioridades, do nível `priority`.
+ */
+static void refInit(int producer_index, sale_priority priority, slot_ref *ref)
+{
+    ref->lane = NULL;
+    ref->shard = -1;
+    ref->priority = -1;
+    ref->segmented = config.topology == TOPOLOGY_SEGMENTS;
+    ref->outcome = SLOT_QUEUED;
+    if (config.topology == TOPOLOGY_LANES)
+    {
+        ref->lane = &lanes[producer_index];
+    }
+    else if (config.topology == TOPOLOGY_SHARDS)
+    {
+        ref->shard = shardOf(storeOf(producer_index + 1));
+    }
+    else if (config.topology == TOPOLOGY_PRIORITY)
+    {
+        ref->priority = (int)priority;
+    }
+}
+
+/**
+ * @fn static sale_record *queueClaimUntil(slot_ref *ref, const struct timespec *deadline)
+ * @brief Reserva uma posição na fila de `ref`, esperando até `deadline` (NULL sem prazo).
+ */
+static sale_record *queueClaimUntil(slot_ref *ref, const struct timespec *deadline)
+{
+    if (ref->segmented)
+    {
+        return segmentClaimUntil(&ref->pos, deadline);
+    }
+    return ref->lane != NULL ? laneClaimUntil(ref->lane, &ref->pos, deadline)
+                             : ringClaimUntil(refRing(ref), &ref->pos, deadline);
+}
+
+/**
+ * @fn sale_record *salesClaimUntil(int producer_index, slot_ref *ref, const struct timespec *deadline)
+ * @brief Reserva uma posição para o caixa `producer_index`, esperando até `deadline`.
+ *
+ * Ao contrário de `salesClaim`, não aplica a política de fila cheia: se o prazo vencer,
+ * retorna NULL com `errno` igual a ETIMEDOUT e o chamador decide o que fazer com a venda.
+ * A posição devolvida é publicada com `salesCommit`.
+ */
+sale_record *salesClaimUntil(int producer_index, slot_ref *ref, const struct timespec *deadline)
+{
+    refInit(producer_index, PRIORITY_NORMAL, ref);
+    return queueClaimUntil(ref, deadline);
+}
+
+/**
+ * @fn sale_record *salesTryClaim(int producer_index, slot_ref *ref)
+ * @brief `salesClaimUntil` sem espera: retorna NULL imediatamente se a fila estiver cheia.
+ */
+sale_record *salesTryClaim(int producer_index, slot_ref *ref)
+{
+    return salesClaimUntil(producer_index, ref, &NO_WAIT);
+}
+
+/**
+ * @fn sale_record *salesClaimPriority(int producer_index, sale_priority priority, slot_ref *ref)
+ * @brief Reserva uma posição para o caixa `producer_index` (a partir de 0), aplicando
+ * `config.overflow` se a fila estiver cheia.
+ *
+ * Na topologia de prioridades, a posição é do anel do nível `priority`, por isso o caixa
+ * classifica a venda (`priorityOf`) antes de reservar; nas demais, `priority` é ignorado.
+ *
+ * - `bloquear`: espera por espaço, somando o tempo de espera em `blocked_ns`. Com
+ *   `config.timeout_ns`, a espera tem prazo; vencido o prazo, a venda é descartada.
+ * - `descartar-antiga`: descarta vendas antigas até conseguir uma posição; se todas as
+ *   vendas da fila já estiverem com gerentes, espera como em `bloquear`.
+ * - `descartar-nova` e `disco`: devolve `ref->scratch`; `salesCommit` descarta a venda ou
+ *   a grava no arquivo de transbordo.
+ */
+sale_record *salesClaimPriority(int producer_index, sale_priority priority, slot_ref *ref)
+{
+    refInit(producer_index, priority, ref);
+
+    for (;;)
+    {
+        sale_record *sale = ref->segmented      ? segmentClaimUntil(&ref->pos, &NO_WAIT)
+                            : ref->lane != NULL ? laneTryClaim(ref->lane, &ref->pos)
+                                                : ringTryClaim(refRing(ref), &ref->pos);
+        if (sale != NULL)
+        {
+            return sale;
+        }
+
+        if (config.overflow == OVERFLOW_DROP_NEWEST || config.overflow == OVERFLOW_SPILL)
+        {
+            ref->outcome = config.overflow == OVERFLOW_SPILL ? SLOT_SPILLED : SLOT_DROPPED;
+            return &ref->scratch;
+        }
+        if (config.overflow == OVERFLOW_DROP_OLDEST && evictOldest(refRing(ref)))
+        {
+            continue;
+        }
+
+        struct timespec start, end;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        struct timespec deadline = deadlineAfter(config.timeout_ns);
+        sale = queueClaimUntil(ref, config.timeout_ns > 0 ? &deadline : NULL);
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        atomic_fetch_add_explicit(&overflow_stats.blocked_ns,
+                                  (end.tv_sec - start.tv_sec) * 1000000000LL + (end.tv_nsec - start.tv_nsec),
+                                  memory_order_relaxed);
+        if (sale == NULL)
+        {
+            ref->outcome = errno == EPIPE ? SLOT_DROPPED : SLOT_TIMED_OUT;
+            return &ref->scratch;
+        }
+        return sale;
+    }
+}
+
+/**
+ * @fn sale_record *salesClaim(int producer_index, slot_ref *ref)
+ * @brief `salesClaimPriority` com prioridade normal.
+ */
+sale_record *salesClaim(int producer_index, slot_ref *ref)
+{
+    return salesClaimPriority(producer_index, PRIORITY_NORMAL, ref);
+}
+
+/**
+ * @fn void salesCommit(slot_ref *ref)
+ * @brief Publica a venda reservada por `salesClaim` ou, se ela não coube na fila, a
+ * descarta ou grava no transbordo, atualizando `ref->outcome`.
+ */
+void salesCommit(slot_ref *ref)
+{
+    if (ref->outcome == SLOT_SPILLED && !spillAppend(&ref->scratch))
+    {
+        ref->outcome = SLOT_DROPPED;
+    }
+    if (ref->outcome == SLOT_SPILLED)
+    {
+        atomic_fetch_add_explicit(&overflow_stats.spilled, 1, memory_order_relaxed);
+    }
+    else if (ref->outcome == SLOT_DROPPED)
+    {
+        atomic_fetch_add_explicit(&overflow_stats.dropped_newest, 1, memory_order_relaxed);
+    }
+    else if (ref->outcome == SLOT_TIMED_OUT)
+    {
+        atomic_fetch_add_explicit(&overflow_stats.timed_out, 1, memory_order_relaxed);
+    }
+    else if (ref->lane != NULL)
+    {
+        laneCommit(ref->lane, ref->pos);
+    }
+    else if (ref->shard >= 0)
+    {
+        shardCommit(ref->shard, ref->pos);
+    }
+    else if (ref->priority >= 0)
+    {
+        priorityCommit(ref->priority, ref->pos);
+    }
+    else if (ref->segmented)
+    {
+        segmentCommit(ref->pos);
+    }
+    else
+    {
+        ringCommit(ring, ref->pos);
+    }
+}
+
+/**
+ * @fn const sale_record *salesPeekUntil(int consumer_index, slot_ref *ref, const struct timespec *deadline)
+ * @brief Espera pela próxima venda do gerente `consumer_index` (a partir de 0) até o prazo
+ * absoluto `deadline` em CLOCK_MONOTONIC (NULL espera indefinidamente).
+ *
+ * @return A venda; ou NULL com `errno` igual a ETIMEDOUT se o prazo venceu; ou NULL com
+ * `errno` zero se as filas foram fechadas (`salesClose`) e estão vazias.
+ */
+const sale_record *salesPeekUntil(int consumer_index, slot_ref *ref, const struct timespec *deadline)
+{
+    ref->lane = NULL;
+    ref->shard = -1;
+    ref->priority = -1;
+    ref->segmented = config.topology == TOPOLOGY_SEGMENTS;
+    ref->outcome = SLOT_QUEUED;
+    if (ref->segmented)
+    {
+        return segmentPeekUntil(&ref->pos, deadline);
+    }
+    if (config.topology == TOPOLOGY_LANES)
+    {
+        return lanePeekUntil(&lane_consumers[consumer_index], &ref->lane, &ref->pos, deadline);
+    }
+    if (config.topology == TOPOLOGY_SHARDS)
+    {
+        return shardPeekUntil(consumer_index, &ref->shard, &ref->pos, deadline);
+    }
+    if (config.topology == TOPOLOGY_PRIORITY)
+    {
+        return priorityPeekUntil(consumer_index, &ref->priority, &ref->pos, deadline);
+    }
+    return ringPeekUntil(ring, &ref->pos, deadline);
+}
+
+/**
+ * @fn const sale_record *salesTryPeek(int consumer_index, slot_ref *ref)
+ * @brief `salesPeekUntil` sem espera: retorna NULL com `errno` igual a ETIMEDOUT
+ * imediatamente se não houver venda.
+ */
+const sale_record *salesTryPeek(int consumer_index, slot_ref *ref)
+{
+    return salesPeekUntil(consumer_index, ref, &NO_WAIT);
+}
+
+/**
+ * @fn const sale_record *salesPeek(int consumer_index, slot_ref *ref)
+ * @brief Espera pela próxima venda do gerente `consumer_index` (a partir de 0).
+ *
+ * @return A venda, ou NULL se as filas foram fechadas e estão vazias.
+ */
+const sale_record *salesPeek(int consumer_index, slot_ref *ref)
+{
+    return salesPeekUntil(consumer_index, ref, NULL);
+}
+
+/**
+ * @fn void salesRelease(const slot_ref *ref)
+ * @brief Devolve a posição lida com `salesPeek`.
+ */
+void salesRelease(const slot_ref *ref)
+{
+    if (ref->lane != NULL)
+    {
+        laneRelease(ref->lane, ref->pos);
+    }
+    else if (ref->segmented)
+    {
+        segmentRelease(ref->pos);
+    }
+    else
+    {
+        ringRelease(refRing(ref), ref->pos);
+    }
+}
+
+/**
+ * @fn void salesClose(void)
+ * @brief Fecha as filas depois que todos os caixas terminaram.
+ *
+ * Cada gerente em espera é acordado exatamente uma vez e passa a ler sem esperar até
+ * esvaziar as filas; então `salesPeek` retorna NULL. O custo não depende de quantas
+ * threads esperam: é um bit por fila e um despertar coletivo por semáforo.
+ */
+void salesClose(void)
+{
+    if (config.topology == TOPOLOGY_LANES)
+    {
+        for (int i = 0; i < NUM_PRODUCERS; i++)
+        {
+            waitSemClose(&lanes[i].free_slots);
+        }
+        for (int i = 0; i < NUM_CONSUMERS; i++)
+        {
+            waitSemClose(&lane_consumers[i].ready);
+        }
+    }
+    else if (config.topology == TOPOLOGY_SHARDS)
+    {
+        // Os anéis são fechados antes dos avisos, para que um gerente que veja o `ready`
+        // fechado também veja RING_CLOSED ao esvaziar as partições.
+        for (int s = 0; s < NUM_SHARDS; s++)
+        {
+            ringClose(shards.rings[s]);
+        }
+        for (int i = 0; i < NUM_CONSUMERS; i++)
+        {
+            waitSemClose(&shards.ready[i]);
+        }
+    }
+    else if (config.topology == TOPOLOGY_PRIORITY)
+    {
+        for (int p = 0; p < NUM_PRIORITIES; p++)
+        {
+            ringClose(priorities.rings[p]);
+        }
+        waitSemClose(&priorities.ready);
+    }
+    else if (config.topology == TOPOLOGY_SEGMENTS)
+    {
+        segmentsClose();
+    }
+    else
+    {
+        ringClose(ring);
+    }
+}
+
+/**
+ * @fn void salesPublishExpected(long long expected)
+ * @brief No anel compartilhado, informa ao processo dos gerentes quantas vendas ele deve
+ * receber. Deve ser chamada antes de `salesClose`, para que os gerentes vejam o valor ao
+ * encontrar o anel fechado.
+ */
+void salesPublishExpected(long long expected)
+{
+    if (config.shm_name != NULL)
+    {
+        atomic_store(&ringSharedHeader(ring)->expected, expected);
+    }
+}
+
+/**
+ * @fn void printOverflowStats(void)
+ * @brief Imprime os contadores da política de fila cheia.
+ */
+void printOverflowStats(void)
+{
+    printf("Fila cheia (%s): %.3f s de espera dos caixas, %" PRId64 " antigas e %" PRId64
+           " novas descartadas, %" PRId64 " gravadas e %" PRId64 " lidas do transbordo, %" PRId64
+           " descartadas por prazo\n",
+           overflow_policy_names[config.overflow], atomic_load(&overflow_stats.blocked_ns) / 1e9,
+           atomic_load(&overflow_stats.dropped_oldest), atomic_load(&overflow_stats.dropped_newest),
+           atomic_load(&overflow_stats.spilled), atomic_load(&overflow_stats.drained),
+           atomic_load(&overflow_stats.timed_out));
+}
+
+/**
+ * @fn int salesBacklog(const slot_ref *ref)
+ * @brief Ocupação da fila de `ref` (a faixa ou o anel), usada nas mensagens.
+ */
+int salesBacklog(const slot_ref *ref)
+{
+    if (ref->segmented)
+    {
+        return (int)(atomic_load_explicit(&segments->available, memory_order_relaxed) & ~RING_CLOSED);
+    }
+    if (ref->lane != NULL)
+    {
+        return (int)(atomic_load_explicit(&ref->lane->tail, memory_order_relaxed) -
+                     atomic_load_explicit(&ref->lane->head, memory_order_relaxed));
+    }
+    return ringSize(refRing(ref));
+}
+
+/**
+ * @fn static int64_t realtimeNs(void)
+ * @brief Instante atual de CLOCK_REALTIME, em nanossegundos (a mesma base de `timestamp_ns`).
+ */
+static int64_t realtimeNs(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    return (int64_t)now.tv_sec * 1000000000LL + now.tv_nsec;
+}
+
+/**
+ * @fn static int64_t monotonicNs(void)
+ * @brief Instante atual de CLOCK_MONOTONIC, em nanossegundos.
+ */
+static int64_t monotonicNs(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (int64_t)now.tv_sec * 1000000000LL + now.tv_nsec;
+}
+
+/**
+ * @struct window_stats
+ * @brief Estatísticas dos valores de venda de uma fatia ou janela de tempo.
+ *
+ * Média e variância seguem o algoritmo de Welford (`m2` é a soma dos quadrados dos
+ * desvios), numericamente estável e combinável entre fatias sem revisitar as vendas. Os
+ * quantis vêm de um histograma log-linear no estilo HDR (`histBucket`), com erro relativo
+ * de no máximo 2^-HIST_SUB_BITS.
+ */
+typedef struct
+{
+    int64_t count;                    /**< Vendas na janela. */
+    double mean;                      /**< Média dos valores, em centavos. */
+    double m2;                        /**< Soma dos quadrados dos desvios em relação à média. */
+    int64_t min;                      /**< Menor valor, em centavos. */
+    int64_t max;                      /**< Maior valor, em centavos. */
+    uint32_t histogram[HIST_BUCKETS]; /**< Vendas por faixa de valor. */
+} window_stats;
+
+/**
+ * @struct sales_analytics
+ * @brief Análise em janelas de tempo alimentada pelos gerentes.
+ *
+ * O tempo das vendas (`timestamp_ns`) é dividido em fatias de `slice_ns`. Cada gerente
+ * acumula as suas vendas em fatias próprias (`local`), sem sincronização; quando a sua marca
+ * d'água (a fatia mais recente que viu, ou a do relógio se está ocioso) avança, ele entrega
+ * ao agregador as fatias que ficaram ANALYTICS_LATENESS para trás. Uma fatia é relatada
+ * quando todos os gerentes já a entregaram. A janela deslizante é a soma das
+ * ANALYTICS_SLICES últimas fatias; nas fronteiras alinhadas, ela é a janela fixa.
+ *
+ * Cada venda custa O(1): uma atualização de Welford e um incremento no histograma. A
+ * combinação das fatias acontece uma vez por fatia, sob `mutex`.
+ */
+typedef struct
+{
+    int64_t slice_ns;                                       /**< Duração de uma fatia; 0 se a análise está desligada. */
+    int64_t start_ns;                                       /**< Início da análise, base dos horários impressos. */
+    window_stats local[NUM_CONSUMERS][ANALYTICS_LATENESS];  /**< Fatias abertas de cada gerente. */
+    int64_t local_index[NUM_CONSUMERS][ANALYTICS_LATENESS]; /**< Fatia em cada posição de `local`; -1 se livre. */
+    int64_t watermark[NUM_CONSUMERS];                       /**< Fatia mais recente de cada gerente; escrita sob `mutex`. */
+    pthread_mutex_t mutex;                                  /**< Protege os campos abaixo. */
+    window_stats slices[ANALYTICS_RING];                    /**< Fatias entregues, pelo índice módulo ANALYTICS_RING. */
+    int64_t slice_index[ANALYTICS_RING];                    /**< Fatia em cada posição de `slices`; -1 se livre. */
+    int64_t next_report;                                    /**< Próxima fatia a relatar; -1 antes da primeira entrega. */
+    int64_t last_index;                                     /**< Fatia mais recente entregue. */
+    int64_t reported;                                       /**< Fatias já relatadas. */
+    int64_t windows;                                        /**< Janelas fixas com vendas relatadas. */
+    _Atomic int64_t late;                                   /**< Vendas que chegaram depois da entrega de sua fatia. */
+} sales_analytics;
+
+sales_analytics analytics;
+
+/**
+ * @fn static int histBucket(int64_t value)
+ * @brief Faixa do histograma de `value`: exata abaixo de 2^HIST_SUB_BITS e, acima disso,
+ * 2^HIST_SUB_BITS faixas iguais por potência de dois.
+ */
+static int histBucket(int64_t value)
+{
+    if (value < (1 << HIST_SUB_BITS))
+    {
+        return value < 0 ? 0 : (int)value;
+    }
+    int shift = 63 - __builtin_clzll((uint64_t)value) - HIST_SUB_BITS;
+    return ((shift + 1) << HIST_SUB_BITS) + (int)((value >> shift) & ((1 << HIST_SUB_BITS) - 1));
+}
+
+/**
+ * @fn static int64_t histValue(int bucket)
+ * @brief Valor central da faixa `bucket`.
+ */
+static int64_t histValue(int bucket)
+{
+    if (bucket < (1 << HIST_SUB_BITS))
+    {
+        return bucket;
+    }
+    int shift = (bucket >> HIST_SUB_BITS) - 1;
+    int64_t low = (int64_t)((1 << HIST_SUB_BITS) + (bucket & ((1 << HIST_SUB_BITS) - 1))) << shift;
+    return low + ((1LL << shift) >> 1);
+}
+
+/**
+ * @fn void windowReset(window_stats *w)
+ * @brief Esvazia `w`.
+ */
+void windowReset(window_stats *w)
+{
+    w->count = 0;
+    w->mean = 0;
+    w->m2 = 0;
+    w->min = INT64_MAX;
+    w->max = INT64_MIN;
+    memset(w->histogram, 0, sizeof(w->histogram));
+}
+
+/**
+ * @fn void windowAdd(window_stats *w, int64_t value)
+ * @brief Acrescenta o valor `value` (em centavos) a `w`.
+ */
+void windowAdd(window_stats *w, int64_t value)
+{
+    w->count++;
+    double delta = value - w->mean;
+    w->mean += delta / w->count;
+    w->m2 += delta * (value - w->mean);
+    w->min = value < w->min ? value : w->min;
+    w->max = value > w->max ? value : w->max;
+    w->histogram[histBucket(value)]++;
+}
+
+/**
+ * @fn void windowMerge(window_stats *dst, const window_stats *src)
+ * @brief Soma `src` a `dst` (combinação de Chan para média e variância).
+ */
+void windowMerge(window_stats *dst, const window_stats *src)
+{
+    if (src->count == 0)
+    {
+        return;
+    }
+    int64_t count = dst->count + src->count;
+    double delta = src->mean - dst->mean;
+    dst->m2 += src->m2 + delta * delta * ((double)dst->count * src->count / count);
+    dst->mean += delta * src->count / count;
+    dst->count = count;
+    dst->min = src->min < dst->min ? src->min : dst->min;
+    dst->max = src->max > dst->max ? src->max : dst->max;
+    for (int i = 0; i < HIST_BUCKETS; i++)
+    {
+        dst->histogram[i] += src->histogram[i];
+    }
+}
+
+/**
+ * @fn int64_t windowQuantile(const window_stats *w, double q)
+ * @brief Quantil `q` (entre 0 e 1) aproximado pelo histograma, limitado a [min, max].
+ */
+int64_t windowQuantile(const window_stats *w, double q)
+{
+    int64_t rank = (int64_t)(q * w->count + 0.999999);
+    rank = rank < 1 ? 1 : rank;
+    int64_t seen = 0;
+    for (int i = 0; i < HIST_BUCKETS; i++)
+    {
+        seen += w->histogram[i];
+        if (seen >= rank)
+        {
+            int64_t value = histValue(i);
+            return value < w->min ? w->min : value > w->max ? w->max : value;
+        }
+    }
+    return w->max;
+}
+
+/**
+ * @fn int analyticsCreate(int64_t window_ns)
+ * @brief Prepara a análise com janelas fixas de `window_ns`; com 0, a análise fica
+ * desligada e as demais funções não fazem nada.
+ *
+ * @return 0 em caso de sucesso, -1 se a janela for curta demais para ser fatiada.
+ */
+int analyticsCreate(int64_t window_ns)
+{
+    analytics.slice_ns = window_ns / ANALYTICS_SLICES;
+    if (window_ns > 0 && analytics.slice_ns == 0)
+    {
+        return -1;
+    }
+    analytics.start_ns = realtimeNs();
+    pthread_mutex_init(&analytics.mutex, NULL);
+    for (int c = 0; c < NUM_CONSUMERS; c++)
+    {
+        analytics.watermark[c] = analytics.slice_ns > 0 ? analytics.start_ns / analytics.slice_ns : 0;
+        for (int i = 0; i < ANALYTICS_LATENESS; i++)
+        {
+            analytics.local_index[c][i] = -1;
+        }
+    }
+    for (int i = 0; i < ANALYTICS_RING; i++)
+    {
+        analytics.slice_index[i] = -1;
+    }
+    analytics.next_report = -1;
+    analytics.last_index = -1;
+    analytics.reported = 0;
+    analytics.windows = 0;
+    atomic_init(&analytics.late, 0);
+    return 0;
+}
+
+/**
+ * @fn void analyticsDestroy(void)
+ * @brief Libera o mutex da análise.
+ */
+void analyticsDestroy(void)
+{
+    pthread_mutex_destroy(&analytics.mutex);
+}
+
+/**
+ * @fn static double squareRoot(double x)
+ * @brief Raiz quadrada por Newton-Raphson, para não exigir a libm só para o desvio padrão.
+ */
+static double squareRoot(double x)
+{
+    if (x <= 0)
+    {
+        return 0;
+    }
+    double root = x > 1 ? x : 1;
+    for (int i = 0; i < 64; i++)
+    {
+        double next = 0.5 * (root + x / root);
+        if (next >= root)
+        {
+            break;
+        }
+        root = next;
+    }
+    return root;
+}
+
+/**
+ * @fn static void printWindow(const char *kind, int64_t first, const window_stats *w)
+ * @brief Imprime a janela `w`, que começa na fatia `first`.
+ */
+static void printWindow(const char *kind, int64_t first, const window_stats *w)
+{
+    double start = (first * analytics.slice_ns - analytics.start_ns) / 1e9;
+    double end = start + ANALYTICS_SLICES * analytics.slice_ns / 1e9;
+    double stddev = w->count > 1 ? squareRoot(w->m2 / (w->count - 1)) : 0.0;
+    printf("[%s %+.3f s a %+.3f s] %" PRId64 " vendas | média R$ %.2f | desvio R$ %.2f | p50 R$ %.2f | "
+           "p90 R$ %.2f | p99 R$ %.2f | mín R$ %.2f | máx R$ %.2f\n",
+           kind, start, end, w->count, w->mean / 100, stddev / 100, windowQuantile(w, 0.50) / 100.0,
+           windowQuantile(w, 0.90) / 100.0, windowQuantile(w, 0.99) / 100.0, w->min / 100.0, w->max / 100.0);
+}
+
+/**
+ * @fn static void analyticsReport(int64_t index)
+ * @brief Relata a janela deslizante que termina na fatia `index`; chamada sob `mutex`.
+ */
+static void analyticsReport(int64_t index)
+{
+    window_stats window;
+    windowReset(&window);
+    for (int64_t i = index - ANALYTICS_SLICES + 1; i <= index; i++)
+    {
+        int pos = (int)((uint64_t)i % ANALYTICS_RING);
+        if (analytics.slice_index[pos] == i)
+        {
+            windowMerge(&window, &analytics.slices[pos]);
+        }
+    }
+    analytics.reported++;
+    if (window.count == 0)
+    {
+        return;
+    }
+
+    int aligned = (index + 1) % ANALYTICS_SLICES == 0;
+    analytics.windows += aligned;
+    printWindow(aligned ? "Janela fixa" : "Janela deslizante", index - ANALYTICS_SLICES + 1, &window);
+}
+
+/**
+ * @fn static void analyticsDeliver(int consumer_index, int slot)
+ * @brief Entrega ao agregador a fatia `slot` do gerente; chamada sob `mutex`.
+ */
+static void analyticsDeliver(int consumer_index, int slot)
+{
+    int64_t index = analytics.local_index[consumer_index][slot];
+    window_stats *local = &analytics.local[consumer_index][slot];
+    analytics.local_index[consumer_index][slot] = -1;
+
+    if (analytics.reported > 0 && index < analytics.next_report)
+    {
+        // Só acontece se o agregador precisou relatar à força (ver abaixo).
+        atomic_fetch_add_explicit(&analytics.late, local->count, memory_order_relaxed);
+        return;
+    }
+
+    int pos = (int)((uint64_t)index % ANALYTICS_RING);
+    if (analytics.slice_index[pos] != index)
+    {
+        // A posição guarda uma fatia ANALYTICS_RING mais antiga. Se ela ainda não foi
+        // relatada, algum gerente está muito atrasado e não esperamos mais por ele.
+        while (analytics.slice_index[pos] >= analytics.next_report && analytics.slice_index[pos] >= 0)
+        {
+            analyticsReport(analytics.next_report++);
+        }
+        windowReset(&analytics.slices[pos]);
+        analytics.slice_index[pos] = index;
+    }
+    windowMerge(&analytics.slices[pos], local);
+
+    if (analytics.next_report < 0 || (analytics.reported == 0 && index < analytics.next_report))
+    {
+        analytics.next_report = index;
+    }
+    analytics.last_index = index > analytics.last_index ? index : analytics.last_index;
+}
+
+/**
+ * @fn static void analyticsAdvance(int consumer_index, int64_t watermark)
+ * @brief Avança a marca d'água do gerente até a fatia `watermark`, entrega as fatias que
+ * ficaram para trás e relata as que todos os gerentes já entregaram.
+ */
+static void analyticsAdvance(int consumer_index, int64_t watermark)
+{
+    if (watermark <= analytics.watermark[consumer_index])
+    {
+        return;
+    }
+
+    pthread_mutex_lock(&analytics.mutex);
+    for (int slot = 0; slot < ANALYTICS_LATENESS; slot++)
+    {
+        int64_t index = analytics.local_index[consumer_index][slot];
+        if (index >= 0 && index <= watermark - ANALYTICS_LATENESS)
+        {
+            analyticsDeliver(consumer_index, slot);
+        }
+    }
+    analytics.watermark[consumer_index] = watermark;
+
+    int64_t low = watermark;
+    for (int c = 0; c < NUM_CONSUMERS; c++)
+    {
+        low = analytics.watermark[c] < low ? analytics.watermark[c] : low;
+    }
+    int64_t limit = low - ANALYTICS_LATENESS;
+    limit = limit < analytics.last_index ? limit : analytics.last_index;
+    if (low == INT64_MAX && analytics.last_index >= 0)
+    {
+        // Todos terminaram: relata até o fim da última janela fixa, mesmo incompleta.
+        limit = analytics.last_index + ANALYTICS_SLICES - 1 - analytics.last_index % ANALYTICS_SLICES;
+    }
+    while (analytics.next_report >= 0 && analytics.next_report <= limit)
+    {
+        analyticsReport(analytics.next_report++);
+    }
+    pthread_mutex_unlock(&analytics.mutex);
+}
+
+/**
+ * @fn void analyticsAdd(int consumer_index, int64_t timestamp_ns, int64_t amount_cents)
+ * @brief Acrescenta uma venda lida pelo gerente `consumer_index` à sua fatia.
+ */
+void analyticsAdd(int consumer_index, int64_t timestamp_ns, int64_t amount_cents)
+{
+    if (analytics.slice_ns == 0)
+    {
+        return;
+    }
+
+    int64_t index = timestamp_ns / analytics.slice_ns;
+    analyticsAdvance(consumer_index, index);
+    if (index <= analytics.watermark[consumer_index] - ANALYTICS_LATENESS)
+    {
+        atomic_fetch_add_explicit(&analytics.late, 1, memory_order_relaxed);
+        return;
+    }
+
+    int slot = (int)(index % ANALYTICS_LATENESS);
+    if (analytics.local_index[consumer_index][slot] != index)
+    {
+        windowReset(&analytics.local[consumer_index][slot]);
+        analytics.local_index[consumer_index][slot] = index;
+    }
+    windowAdd(&analytics.local[consumer_index][slot], amount_cents);
+}
+
+/**
+ * @fn void analyticsTick(int consumer_index)
+ * @brief Avança a marca d'água de um gerente ocioso até a fatia do relógio, para que as
+ * janelas dos outros gerentes não esperem por ele.
+ */
+void analyticsTick(int consumer_index)
+{
+    if (analytics.slice_ns > 0)
+    {
+        analyticsAdvance(consumer_index, realtimeNs() / analytics.slice_ns);
+    }
+}
+
+/**
+ * @fn void analyticsDone(int consumer_index)
+ * @brief Entrega todas as fatias do gerente, que não lerá mais vendas.
+ */
+void analyticsDone(int consumer_index)
+{
+    if (analytics.slice_ns > 0)
+    {
+        analyticsAdvance(consumer_index, INT64_MAX);
+    }
+}
+
+/**
+ * @fn void printAnalyticsStats(void)
+ * @brief Imprime o resumo da análise em janelas.
+ */
+void printAnalyticsStats(void)
+{
+    printf("Análise em janelas de %.3f s: %" PRId64 " janelas fixas com vendas, %" PRId64 " vendas atrasadas\n",
+           ANALYTICS_SLICES * analytics.slice_ns / 1e9, analytics.windows, atomic_load(&analytics.late));
+}
+
+/**
+ * @struct priority_latency
+ * @brief Latências de um gerente por nível de prioridade, somadas ao final da rodada.
+ */
+typedef struct
+{
+    _Alignas(64) window_stats latency[NUM_PRIORITIES]; /**< Do instante da venda à leitura, em nanossegundos. */
+} priority_latency;
+
+priority_latency priority_latencies[NUM_CONSUMERS];
+
+/**
+ * @fn void priorityStatsReset(void)
+ * @brief Zera as latências por prioridade antes de uma rodada.
+ */
+void priorityStatsReset(void)
+{
+    for (int c = 0; c < NUM_CONSUMERS; c++)
+    {
+        for (int p = 0; p < NUM_PRIORITIES; p++)
+        {
+            windowReset(&priority_latencies[c].latency[p]);
+        }
+    }
+}
+
+/**
+ * @fn void priorityObserve(int consumer_index, const slot_ref *ref, int64_t latency_ns)
+ * @brief Registra a latência de uma venda lida pelo gerente `consumer_index` no nível de
+ * `ref`; não faz nada fora da topologia de prioridades.
+ */
+void priorityObserve(int consumer_index, const slot_ref *ref, int64_t latency_ns)
+{
+    if (ref->priority >= 0)
+    {
+        windowAdd(&priority_latencies[consumer_index].latency[ref->priority], latency_ns);
+    }
+}
+
+/**
+ * @fn void printPriorityStats(const char *indent)
+ * @brief Imprime, para cada nível, as vendas lidas e a latência média, mediana e p99,
+ * cada linha precedida de `indent`.
+ */
+void printPriorityStats(const char *indent)
+{
+    for (int p = 0; p < NUM_PRIORITIES; p++)
+    {
+        window_stats total;
+        windowReset(&total);
+        for (int c = 0; c < NUM_CONSUMERS; c++)
+        {
+            windowMerge(&total, &priority_latencies[c].latency[p]);
+        }
+        printf("%sprioridade %-10s %10" PRId64 " vendas | latência média %9.2f us, p50 %9.2f us, p99 %9.2f us\n",
+               indent, sale_priority_names[p], total.count, total.count > 0 ? total.mean / 1e3 : 0.0,
+               total.count > 0 ? windowQuantile(&total, 0.5) / 1e3 : 0.0,
+               total.count > 0 ? windowQuantile(&total, 0.99) / 1e3 : 0.0);
+    }
+}
+
+/**
+ * @fn int64_t consumerWaitNs(void)
+ * @brief Prazo de cada espera de um gerente: `--prazo-ms` e, com a análise ligada, no
+ * máximo uma fatia, para que a marca d'água avance mesmo sem vendas.
+ *
+ * @return O prazo em nanossegundos, ou 0 para esperar indefinidamente.
+ */
+int64_t consumerWaitNs(void)
+{
+    int64_t wait_ns = config.timeout_ns;
+    if (analytics.slice_ns > 0 && (wait_ns == 0 || analytics.slice_ns < wait_ns))
+    {
+        wait_ns = analytics.slice_ns;
+    }
+    return wait_ns;
+}
+
+/**
+ * @struct sink_block
+ * @brief Bloco de até SINK_BLOCK_ROWS vendas processadas, uma coluna por campo.
+ *
+ * Cada gerente preenche o seu bloco sem sincronização e o entrega à thread de escrita
+ * quando ele enche; blocos livres voltam por uma lista protegida pelo mutex do `sales_sink`,
+ * que é tocado uma vez por bloco, não por venda.
+ */
+typedef struct sink_block
+{
+    struct sink_block *next;                 /**< Próximo bloco na lista livre ou na fila. */
+    int rows;                                /**< Vendas no bloco. */
+    int64_t timestamp_ns[SINK_BLOCK_ROWS];   /**< Coluna dos instantes. */
+    int64_t amount_cents[SINK_BLOCK_ROWS];   /**< Coluna dos valores. */
+    uint32_t register_id[SINK_BLOCK_ROWS];   /**< Coluna dos caixas. */
+    uint32_t sku[SINK_BLOCK_ROWS];           /**< Coluna dos SKUs. */
+    uint32_t store_id[SINK_BLOCK_ROWS];      /**< Coluna das lojas. */
+} sink_block;
+
+/**
+ * @struct sink_index_entry
+ * @brief Entrada do índice do rodapé: posição do bloco, tamanho de cada coluna comprimida
+ * e os agregados do bloco, que permitem responder somas e intervalos sem ler as colunas.
+ */
+typedef struct
+{
+    uint64_t offset;                       /**< Início do bloco no arquivo. */
+    uint32_t rows;                         /**< Vendas no bloco. */
+    uint32_t column_bytes[SINK_COLUMNS];   /**< Bytes de cada coluna, na ordem do bloco. */
+    int64_t first_ns;                      /**< Menor instante do bloco. */
+    int64_t last_ns;                       /**< Maior instante do bloco. */
+    int64_t amount_sum;                    /**< Soma dos valores, em centavos. */
+    int64_t amount_min;                    /**< Menor valor. */
+    int64_t amount_max;                    /**< Maior valor. */
+} sink_index_entry;
+
+/**
+ * @struct sink_trailer
+ * @brief Fim do arquivo colunar: onde começa o índice e quantos blocos ele tem.
+ */
+typedef struct
+{
+    uint64_t index_offset; /**< Início do índice no arquivo. */
+    uint64_t blocks;       /**< Entradas do índice. */
+    uint64_t rows;         /**< Total de vendas. */
+    char magic[8];         /**< SINK_MAGIC. */
+} sink_trailer;
+
+/**
+ * @enum sink_io_mode
+ * @brief Como os buffers de saída do arquivo colunar chegam ao disco.
+ */
+typedef enum
+{
+    SINK_IO_URING,  /**< Escritas assíncronas submetidas a um io_uring. */
+    SINK_IO_PWRITE  /**< Uma thread de E/S que grava cada buffer com `pwrite`. */
+} sink_io_mode;
+
+/**
+ * @struct sink_buffer
+ * @brief Buffer de saída do arquivo colunar e a escrita em andamento dele.
+ */
+typedef struct
+{
+    unsigned char *data;  /**< SINK_WRITE_BYTES bytes, alinhados em página. */
+    size_t used;          /**< Bytes ocupados. */
+    size_t done;          /**< Bytes já gravados da escrita em andamento. */
+    uint64_t offset;      /**< Posição do primeiro byte no arquivo. */
+    int blocks;           /**< Blocos de vendas no buffer. */
+    int busy;             /**< Diferente de zero enquanto a escrita não termina. */
+    int64_t submitted_ns; /**< Instante da submissão, em CLOCK_MONOTONIC. */
+} sink_buffer;
+
+/**
+ * @struct sink_uring
+ * @brief Anéis de submissão e de conclusão de um io_uring, mapeados do kernel.
+ *
+ * Usa as chamadas de sistema diretamente, sem liburing, como o futex de `wait_sem`. Só a
+ * thread de escrita do arquivo colunar submete e colhe, por isso os índices que pertencem
+ * a ela (`sq_tail`, `cq_head`) são apenas publicados com release.
+ */
+typedef struct
+{
+    int fd;                     /**< Descritor do io_uring, ou -1. */
+    unsigned *sq_tail;          /**< Fim do anel de submissão. */
+    unsigned *sq_mask;          /**< Máscara do anel de submissão. */
+    unsigned *sq_array;         /**< Índices das SQEs submetidas. */
+    struct io_uring_sqe *sqes;  /**< Entradas de submissão. */
+    unsigned *cq_head;          /**< Início do anel de conclusão. */
+    unsigned *cq_tail;          /**< Fim do anel de conclusão. */
+    unsigned *cq_mask;          /**< Máscara do anel de conclusão. */
+    struct io_uring_cqe *cqes;  /**< Entradas de conclusão. */
+    void *sq_ring;              /**< Mapeamento do anel de submissão. */
+    void *cq_ring;              /**< Mapeamento do anel de conclusão, se separado. */
+    size_t sq_ring_size;        /**< Tamanho de `sq_ring`. */
+    size_t cq_ring_size;        /**< Tamanho de `cq_ring`. */
+    size_t sqes_size;           /**< Tamanho do mapeamento de `sqes`. */
+} sink_uring;
+
+/**
+ * @struct sales_sink
+ * @brief Gravação colunar das vendas processadas pelos gerentes.
+ *
+ * O arquivo começa com SINK_MAGIC, a versão e SINK_BLOCK_ROWS (16 bytes), seguidos dos
+ * blocos e, no fim, do índice (`sink_index_entry`) e do `sink_trailer`. Em cada bloco, as
+ * colunas vêm uma após a outra, codificadas em varints LEB128: os instantes como diferenças
+ * para o anterior, os valores em zigue-zague (podem ser negativos) e os campos de 32 bits
+ * diretamente. Vendas vizinhas têm instantes próximos e caixas e lojas pequenos, por isso a
+ * maior parte das colunas cabe em um ou dois bytes por venda.
+ *
+ * Os gerentes só copiam os campos para o bloco corrente; a codificação fica com uma thread
+ * dedicada, que acumula os blocos codificados em buffers de SINK_WRITE_BYTES (dezenas de
+ * blocos cada). Um buffer cheio é submetido como uma escrita na sua posição do arquivo e a
+ * codificação segue no próximo dos SINK_IO_BUFFERS buffers; ela só espera se todos estiverem
+ * sendo gravados. Com io_uring, a própria thread de escrita submete e colhe as conclusões
+ * sem bloquear; sem ele, uma thread de E/S grava os buffers com `pwrite`. A latência de
+ * submissão é o tempo para entregar o buffer (`io_uring_enter` ou a fila da thread de E/S)
+ * e a de conclusão, da submissão até a escrita terminar. Se a thread de escrita se atrasar
+ * e a lista livre esvaziar, o gerente aloca um bloco extra em vez de esperar.
+ */
+typedef struct
+{
+    int active;                            /**< Diferente de zero com o arquivo aberto. */
+    int fd;                                /**< Arquivo de saída. */
+    sink_block *current[NUM_CONSUMERS];    /**< Bloco em preenchimento de cada gerente. */
+    pthread_mutex_t mutex;                 /**< Protege `free_blocks`, a fila e `closing`. */
+    pthread_cond_t ready;                  /**< Sinaliza blocos na fila ou o fechamento. */
+    sink_block *free_blocks;               /**< Blocos livres. */
+    sink_block *full_head;                 /**< Primeiro bloco cheio a gravar. */
+    sink_block *full_tail;                 /**< Último bloco cheio a gravar. */
+    int closing;                           /**< Diferente de zero depois de `sinkClose`. */
+    pthread_t writer;                      /**< Thread de escrita. */
+    sink_io_mode io;                       /**< Caminho das escritas. */
+    sink_buffer buffers[SINK_IO_BUFFERS];  /**< Buffers de saída. */
+    int filling;                           /**< Buffer sendo preenchido pela thread de escrita. */
+    sink_uring uring;                      /**< io_uring, no modo SINK_IO_URING. */
+    pthread_t io_thread;                   /**< Thread de `pwrite`, no modo SINK_IO_PWRITE. */
+    pthread_mutex_t io_mutex;              /**< Protege `busy`, a fila de E/S e `io_stop`. */
+    pthread_cond_t io_cond;                /**< Sinaliza buffers submetidos e concluídos. */
+    int io_queue[SINK_IO_BUFFERS];         /**< Buffers submetidos à thread de `pwrite`. */
+    int io_queue_head;                     /**< Primeiro buffer da fila de E/S. */
+    int io_queue_count;                    /**< Buffers na fila de E/S. */
+    int io_stop;                           /**< Diferente de zero para encerrar a thread de E/S. */
+    uint64_t offset;                       /**< Bytes já entregues ao arquivo ou aos buffers. */
+    sink_index_entry *index;               /**< Índice dos blocos gravados. */
+    size_t index_count;                    /**< Entradas em `index`. */
+    size_t index_capacity;                 /**< Capacidade de `index`. */
+    int64_t rows;                          /**< Vendas gravadas. */
+    int64_t submissions;                   /**< Buffers submetidos. */
+    window_stats submit_latency;           /**< Latências de submissão, em nanossegundos. */
+    window_stats complete_latency;         /**< Latências de conclusão, em nanossegundos. */
+    int failed;                            /**< Diferente de zero após um erro de escrita. */
+    _Atomic int64_t extra_blocks;          /**< Blocos alocados além do conjunto inicial. */
+    _Atomic int64_t lost;                  /**< Vendas não gravadas por falta de memória. */
+} sales_sink;
+
+sales_sink sink;
+
+/**
+ * @fn static unsigned char *putVarint(unsigned char *out, uint64_t value)
+ * @brief Codifica `value` em LEB128 (7 bits por byte, o bit alto indica continuação).
+ */
+static unsigned char *putVarint(unsigned char *out, uint64_t value)
+{
+    while (value >= 0x80)
+    {
+        *out++ = (unsigned char)(value | 0x80);
+        value >>= 7;
+    }
+    *out++ = (unsigned char)value;
+    return out;
+}
+
+/**
+ * @fn static const unsigned char *getVarint(const unsigned char *in, const unsigned char *end, uint64_t *value)
+ * @brief Decodifica um varint LEB128 de no máximo 10 bytes.
+ *
+ * @return O byte seguinte ao varint, ou NULL se ele estiver truncado.
+ */
+static const unsigned char *getVarint(const unsigned char *in, const unsigned char *end, uint64_t *value)
+{
+    uint64_t v = 0;
+    for (int shift = 0; in < end && shift < 64; shift += 7)
+    {
+        unsigned char byte = *in++;
+        v |= (uint64_t)(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0)
+        {
+            *value = v;
+            return in;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @fn static uint64_t zigzag(int64_t value)
+ * @brief Mapeia inteiros com sinal em sem sinal de forma que valores pequenos em módulo
+ * fiquem pequenos (0, -1, 1, -2... viram 0, 1, 2, 3...).
+ */
+static uint64_t zigzag(int64_t value)
+{
+    return ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+}
+
+/**
+ * @fn static int64_t unzigzag(uint64_t value)
+ * @brief Inverso de `zigzag`.
+ */
+static int64_t unzigzag(uint64_t value)
+{
+    return (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+}
+
+/**
+ * @fn static int sinkUringSetup(void)
+ * @brief Cria o io_uring da thread de escrita e mapeia seus anéis.
+ *
+ * @return 0 em caso de sucesso, -1 se o kernel não oferece io_uring (ou ele está bloqueado,
+ * como em alguns contêineres).
+ */
+static int sinkUringSetup(void)
+{
+    sink_uring *u = &sink.uring;
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    u->fd = (int)syscall(SYS_io_uring_setup, 2 * SINK_IO_BUFFERS, &params);
+    if (u->fd < 0)
+    {
+        return -1;
+    }
+
+    u->sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    u->cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP)
+    {
+        u->sq_ring_size = u->cq_ring_size > u->sq_ring_size ? u->cq_ring_size : u->sq_ring_size;
+    }
+    u->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    u->sq_ring = mmap(NULL, u->sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, u->fd,
+                      IORING_OFF_SQ_RING);
+    u->cq_ring = (params.features & IORING_FEAT_SINGLE_MMAP)
+                     ? u->sq_ring
+                     : mmap(NULL, u->cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, u->fd,
+                            IORING_OFF_CQ_RING);
+    u->sqes = mmap(NULL, u->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, u->fd, IORING_OFF_SQES);
+    if (u->sq_ring == MAP_FAILED || u->cq_ring == MAP_FAILED || u->sqes == MAP_FAILED)
+    {
+        int error = errno;
+        if (u->sqes != MAP_FAILED)
+        {
+            munmap(u->sqes, u->sqes_size);
+        }
+        if (u->cq_ring != MAP_FAILED && u->cq_ring != u->sq_ring)
+        {
+            munmap(u->cq_ring, u->cq_ring_size);
+        }
+        if (u->sq_ring != MAP_FAILED)
+        {
+            munmap(u->sq_ring, u->sq_ring_size);
+        }
+        close(u->fd);
+        errno = error;
+        u->fd = -1;
+        return -1;
+    }
+
+    char *sq = u->sq_ring;
+    char *cq = u->cq_ring;
+    u->sq_tail = (unsigned *)(sq + params.sq_off.tail);
+    u->sq_mask = (unsigned *)(sq + params.sq_off.ring_mask);
+    u->sq_array = (unsigned *)(sq + params.sq_off.array);
+    u->cq_head = (unsigned *)(cq + params.cq_off.head);
+    u->cq_tail = (unsigned *)(cq + params.cq_off.tail);
+    u->cq_mask = (unsigned *)(cq + params.cq_off.ring_mask);
+    u->cqes = (struct io_uring_cqe *)(cq + params.cq_off.cqes);
+    return 0;
+}
+
+/**
+ * @fn static void sinkUringTeardown(void)
+ * @brief Desfaz os mapeamentos e fecha o io_uring.
+ */
+static void sinkUringTeardown(void)
+{
+    sink_uring *u = &sink.uring;
+    munmap(u->sqes, u->sqes_size);
+    if (u->cq_ring != u->sq_ring)
+    {
+        munmap(u->cq_ring, u->cq_ring_size);
+    }
+    munmap(u->sq_ring, u->sq_ring_size);
+    close(u->fd);
+    u->fd = -1;
+}
+
+/**
+ * @fn static void sinkUringWrite(int b)
+ * @brief Submete a parte ainda não gravada do buffer `b` como IORING_OP_WRITE.
+ *
+ * Se o kernel recusar a submissão, marca o arquivo como falho e libera o buffer, já que
+ * nenhuma conclusão virá para ele.
+ */
+static void sinkUringWrite(int b)
+{
+    sink_uring *u = &sink.uring;
+    sink_buffer *buffer = &sink.buffers[b];
+    unsigned tail = *u->sq_tail;
+    unsigned index = tail & *u->sq_mask;
+    struct io_uring_sqe *sqe = &u->sqes[index];
+
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = IORING_OP_WRITE;
+    sqe->fd = sink.fd;
+    sqe->addr = (uint64_t)(uintptr_t)(buffer->data + buffer->done);
+    sqe->len = (uint32_t)(buffer->used - buffer->done);
+    sqe->off = buffer->offset + buffer->done;
+    sqe->user_data = (uint64_t)b;
+    u->sq_array[index] = index;
+    atomic_store_explicit((_Atomic unsigned *)u->sq_tail, tail + 1, memory_order_release);
+
+    struct timespec pause = {0, 1000000};
+    for (int retries = 0; syscall(SYS_io_uring_enter, u->fd, 1, 0, 0, NULL, 0) < 0;)
+    {
+        if (errno == EINTR)
+        {
+            continue;
+        }
+        if (errno == EAGAIN && retries++ < SINK_URING_RETRIES)
+        {
+            nanosleep(&pause, NULL);
+            continue;
+        }
+        // O kernel não consumiu a SQE: retira-a, para que uma submissão seguinte não a leve.
+        atomic_store_explicit((_Atomic unsigned *)u->sq_tail, tail, memory_order_release);
+        perror("Erro ao submeter a escrita do arquivo colunar");
+        sink.failed = 1;
+        buffer->busy = 0;
+        return;
+    }
+}
+
+/**
+ * @fn static int sinkCompleted(int b, ssize_t result)
+ * @brief Registra o resultado de uma escrita do buffer `b`.
+ *
+ * @return 1 se o buffer terminou (gravado ou com erro), 0 se falta gravar parte dele.
+ */
+static int sinkCompleted(int b, ssize_t result)
+{
+    sink_buffer *buffer = &sink.buffers[b];
+    if (result <= 0)
+    {
+        errno = result < 0 ? (int)-result : EIO;
+        perror("Erro ao gravar o arquivo colunar");
+        sink.failed = 1;
+        return 1;
+    }
+    buffer->done += (size_t)result;
+    if (buffer->done < buffer->used)
+    {
+        return 0;
+    }
+    windowAdd(&sink.complete_latency, monotonicNs() - buffer->submitted_ns);
+    return 1;
+}
+
+/**
+ * @fn static void sinkUringReap(int wait)
+ * @brief Colhe as conclusões do io_uring, resubmetendo escritas parciais.
+ *
+ * @param wait Diferente de zero para esperar ao menos uma conclusão.
+ */
+static void sinkUringReap(int wait)
+{
+    sink_uring *u = &sink.uring;
+    if (wait)
+    {
+        while (syscall(SYS_io_uring_enter, u->fd, 0, 1, IORING_ENTER_GETEVENTS, NULL, 0) < 0 && errno == EINTR)
+        {
+        }
+    }
+
+    unsigned head = *u->cq_head;
+    unsigned tail = atomic_load_explicit((_Atomic unsigned *)u->cq_tail, memory_order_acquire);
+    for (; head != tail; head++)
+    {
+        struct io_uring_cqe *cqe = &u->cqes[head & *u->cq_mask];
+        int b = (int)cqe->user_data;
+        int finished = sinkCompleted(b, cqe->res);
+        atomic_store_explicit((_Atomic unsigned *)u->cq_head, head + 1, memory_order_release);
+        if (finished)
+        {
+            sink.buffers[b].busy = 0;
+        }
+        else
+        {
+            sinkUringWrite(b);
+        }
+    }
+}
+
+/**
+ * @fn static int sinkInFlight(void)
+ * @brief Diferente de zero se algum buffer de saída está sendo gravado.
+ */
+static int sinkInFlight(void)
+{
+    for (int b = 0; b < SINK_IO_BUFFERS; b++)
+    {
+        if (sink.buffers[b].busy)
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @fn void *sinkIoThread(void *args)
+ * @brief Thread de E/S do modo SINK_IO_PWRITE: grava com `pwrite` os buffers submetidos.
+ */
+void *sinkIoThread(void *args)
+{
+    (void)args;
+    pthread_mutex_lock(&sink.io_mutex);
+    for (;;)
+    {
+        while (sink.io_queue_count == 0 && !sink.io_stop)
+        {
+            pthread_cond_wait(&sink.io_cond, &sink.io_mutex);
+        }
+        if (sink.io_queue_count == 0)
+        {
+            break;
+        }
+        int b = sink.io_queue[sink.io_queue_head];
+        sink.io_queue_head = (sink.io_queue_head + 1) % SINK_IO_BUFFERS;
+        sink.io_queue_count--;
+        pthread_mutex_unlock(&sink.io_mutex);
+
+        sink_buffer *buffer = &sink.buffers[b];
+        for (;;)
+        {
+            ssize_t written =
+                pwrite(sink.fd, buffer->data + buffer->done, buffer->used - buffer->done, buffer->offset + buffer->done);
+            if (written < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            if (sinkCompleted(b, written < 0 ? -errno : written))
+            {
+                break;
+            }
+        }
+
+        pthread_mutex_lock(&sink.io_mutex);
+        buffer->busy = 0;
+        pthread_cond_broadcast(&sink.io_cond);
+    }
+    pthread_mutex_unlock(&sink.io_mutex);
+    return NULL;
+}
+
+/**
+ * @fn static void sinkSubmitBuffer(int b)
+ * @brief Submete a escrita do buffer `b` na sua posição do arquivo.
+ */
+static void sinkSubmitBuffer(int b)
+{
+    sink_buffer *buffer = &sink.buffers[b];
+    buffer->done = 0;
+    buffer->busy = 1;
+    buffer->submitted_ns = monotonicNs();
+    sink.submissions++;
+
+    if (sink.io == SINK_IO_URING)
+    {
+        sinkUringWrite(b);
+    }
+    else
+    {
+        pthread_mutex_lock(&sink.io_mutex);
+        sink.io_queue[(sink.io_queue_head + sink.io_queue_count) % SINK_IO_BUFFERS] = b;
+        sink.io_queue_count++;
+        pthread_cond_broadcast(&sink.io_cond);
+        pthread_mutex_unlock(&sink.io_mutex);
+    }
+    windowAdd(&sink.submit_latency, monotonicNs() - buffer->submitted_ns);
+}
+
+/**
+ * @fn static void sinkWaitBuffer(int b)
+ * @brief Espera a escrita do buffer `b` terminar.
+ */
+static void sinkWaitBuffer(int b)
+{
+    if (sink.io == SINK_IO_URING)
+    {
+        while (sink.buffers[b].busy)
+        {
+            sinkUringReap(1);
+        }
+        return;
+    }
+    pthread_mutex_lock(&sink.io_mutex);
+    while (sink.buffers[b].busy)
+    {
+        pthread_cond_wait(&sink.io_cond, &sink.io_mutex);
+    }
+    pthread_mutex_unlock(&sink.io_mutex);
+}
+
+/**
+ * @fn static void sinkFlush(void)
+ * @brief Submete o buffer em preenchimento e passa ao próximo, esperando se ele ainda
+ * estiver sendo gravado.
+ */
+static void sinkFlush(void)
+{
+    sink_buffer *buffer = &sink.buffers[sink.filling];
+    if (buffer->used == 0)
+    {
+        return;
+    }
+    if (!sink.failed)
+    {
+        sinkSubmitBuffer(sink.filling);
+    }
+    sink.filling = (sink.filling + 1) % SINK_IO_BUFFERS;
+    sinkWaitBuffer(sink.filling);
+    sink.buffers[sink.filling].used = 0;
+    sink.buffers[sink.filling].blocks = 0;
+    sink.buffers[sink.filling].offset = sink.offset;
+}
+
+/**
+ * @fn static void sinkEmit(const void *data, size_t size)
+ * @brief Acrescenta `size` bytes ao arquivo pelos buffers de saída.
+ */
+static void sinkEmit(const void *data, size_t size)
+{
+    const unsigned char *p = data;
+    while (size > 0)
+    {
+        sink_buffer *buffer = &sink.buffers[sink.filling];
+        size_t chunk = SINK_WRITE_BYTES - buffer->used < size ? SINK_WRITE_BYTES - buffer->used : size;
+        memcpy(buffer->data + buffer->used, p, chunk);
+        buffer->used += chunk;
+        sink.offset += chunk;
+        p += chunk;
+        size -= chunk;
+        if (buffer->used == SINK_WRITE_BYTES)
+        {
+            sinkFlush();
+        }
+    }
+}
+
+/**
+ * @fn static void sinkEncodeBlock(const sink_block *b)
+ * @brief Codifica as colunas do bloco `b` no buffer de saída e registra sua entrada no índice.
+ */
+static void sinkEncodeBlock(const sink_block *b)
+{
+    // Pior caso: 10 bytes por campo de 64 bits e 5 por campo de 32 bits.
+    if (SINK_WRITE_BYTES - sink.buffers[sink.filling].used < (size_t)b->rows * (2 * 10 + 3 * 5))
+    {
+        sinkFlush();
+    }
+    if (sink.index_count == sink.index_capacity)
+    {
+        size_t capacity = sink.index_capacity > 0 ? sink.index_capacity * 2 : 64;
+        sink_index_entry *index = realloc(sink.index, capacity * sizeof(sink_index_entry));
+        if (index == NULL)
+        {
+            sink.failed = 1;
+            return;
+        }
+        sink.index = index;
+        sink.index_capacity = capacity;
+    }
+
+    sink_index_entry *entry = &sink.index[sink.index_count++];
+    memset(entry, 0, sizeof(*entry));
+    entry->offset = sink.offset;
+    entry->rows = (uint32_t)b->rows;
+    entry->first_ns = INT64_MAX;
+    entry->last_ns = INT64_MIN;
+    entry->amount_min = INT64_MAX;
+    entry->amount_max = INT64_MIN;
+
+    sink_buffer *buffer = &sink.buffers[sink.filling];
+    unsigned char *start = buffer->data + buffer->used;
+    unsigned char *p = start;
+    int64_t previous = 0;
+    for (int i = 0; i < b->rows; i++)
+    {
+        p = putVarint(p, zigzag(b->timestamp_ns[i] - previous));
+        previous = b->timestamp_ns[i];
+        entry->first_ns = b->timestamp_ns[i] < entry->first_ns ? b->timestamp_ns[i] : entry->first_ns;
+        entry->last_ns = b->timestamp_ns[i] > entry->last_ns ? b->timestamp_ns[i] : entry->last_ns;
+    }
+    entry->column_bytes[0] = (uint32_t)(p - start);
+    for (int i = 0; i < b->rows; i++)
+    {
+        p = putVarint(p, zigzag(b->amount_cents[i]));
+        entry->amount_sum += b->amount_cents[i];
+        entry->amount_min = b->amount_cents[i] < entry->amount_min ? b->amount_cents[i] : entry->amount_min;
+        entry->amount_max = b->amount_cents[i] > entry->amount_max ? b->amount_cents[i] : entry->amount_max;
+    }
+    entry->column_bytes[1] = (uint32_t)(p - start) - entry->column_bytes[0];
+
+    const uint32_t *columns[] = {b->register_id, b->sku, b->store_id};
+    for (int c = 0; c < 3; c++)
+    {
+        unsigned char *column = p;
+        for (int i = 0; i < b->rows; i++)
+        {
+            p = putVarint(p, columns[c][i]);
+        }
+        entry->column_bytes[2 + c] = (uint32_t)(p - column);
+    }
+
+    buffer->used += p - start;
+    buffer->blocks++;
+    sink.offset += p - start;
+    sink.rows += b->rows;
+}
+
+/**
+ * @fn void *sinkWriter(void *args)
+ * @brief Thread de escrita: codifica os blocos entregues pelos gerentes e, no fechamento,
+ * grava o restante, o índice e o rodapé e espera todas as escritas terminarem.
+ */
+void *sinkWriter(void *args)
+{
+    (void)args;
+    for (;;)
+    {
+        pthread_mutex_lock(&sink.mutex);
+        // Sem blocos a codificar, espera no io_uring para medir a conclusão quando ela ocorre.
+        while (sink.io == SINK_IO_URING && sink.full_head == NULL && !sink.closing && sinkInFlight())
+        {
+            pthread_mutex_unlock(&sink.mutex);
+            sinkUringReap(1);
+            pthread_mutex_lock(&sink.mutex);
+        }
+        while (sink.full_head == NULL && !sink.closing)
+        {
+            pthread_cond_wait(&sink.ready, &sink.mutex);
+        }
+        sink_block *b = sink.full_head;
+        if (b != NULL)
+        {
+            sink.full_head = b->next;
+            sink.full_tail = sink.full_head != NULL ? sink.full_tail : NULL;
+        }
+        pthread_mutex_unlock(&sink.mutex);
+        if (b == NULL)
+        {
+            break;
+        }
+
+        sinkEncodeBlock(b);
+        if (sink.io == SINK_IO_URING)
+        {
+            sinkUringReap(0);
+        }
+
+        pthread_mutex_lock(&sink.mutex);
+        b->next = sink.free_blocks;
+        sink.free_blocks = b;
+        pthread_mutex_unlock(&sink.mutex);
+    }
+
+    sink_trailer trailer = {sink.offset, sink.index_count, (uint64_t)sink.rows, SINK_MAGIC};
+    sinkEmit(sink.index, sink.index_count * sizeof(sink_index_entry));
+    sinkEmit(&trailer, sizeof(trailer));
+    sinkFlush();
+    for (int b = 0; b < SINK_IO_BUFFERS; b++)
+    {
+        sinkWaitBuffer(b);
+    }
+    return NULL;
+}
+
+/**
+ * @fn int sinkOpen(const char *path)
+ * @brief Cria o arquivo colunar `path`, o conjunto de blocos, os buffers de saída e as
+ * threads de escrita e, sem io_uring, de E/S.
+ *
+ * O io_uring é usado a menos que `config.sink_pwrite` esteja ligado; se o kernel não o
+ * oferecer, a gravação passa a `pwrite` com um aviso.
+ *
+ * @return 0 em caso de sucesso, -1 em caso de erro.
+ */
+int sinkOpen(const char *path)
+{
+    memset(&sink, 0, sizeof(sink));
+    sink.fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    int allocated = 1;
+    for (int b = 0; b < SINK_IO_BUFFERS; b++)
+    {
+        void *data = NULL;
+        allocated = allocated && posix_memalign(&data, 4096, SINK_WRITE_BYTES) == 0;
+        sink.buffers[b].data = data;
+    }
+    if (sink.fd < 0 || !allocated)
+    {
+        if (sink.fd >= 0)
+        {
+            close(sink.fd);
+        }
+        for (int b = 0; b < SINK_IO_BUFFERS; b++)
+        {
+            free(sink.buffers[b].data);
+        }
+        return -1;
+    }
+    for (int i = 0; i < SINK_POOL_BLOCKS; i++)
+    {
+        sink_block *b = malloc(sizeof(sink_block));
+        if (b != NULL)
+        {
+            b->next = sink.free_blocks;
+            sink.free_blocks = b;
+        }
+    }
+
+    uint32_t header[2] = {1, SINK_BLOCK_ROWS};
+    sinkEmit(SINK_MAGIC, 8);
+    sinkEmit(header, sizeof(header));
+    windowReset(&sink.submit_latency);
+    windowReset(&sink.complete_latency);
+
+    sink.io = config.sink_pwrite ? SINK_IO_PWRITE : SINK_IO_URING;
+    if (sink.io == SINK_IO_URING && sinkUringSetup() != 0)
+    {
+        fprintf(stderr, "io_uring indisponível (%s); gravando com pwrite\n", strerror(errno));
+        sink.io = SINK_IO_PWRITE;
+    }
+    pthread_mutex_init(&sink.mutex, NULL);
+    pthread_cond_init(&sink.ready, NULL);
+    pthread_mutex_init(&sink.io_mutex, NULL);
+    pthread_cond_init(&sink.io_cond, NULL);
+    if (sink.io == SINK_IO_PWRITE)
+    {
+        pthread_create(&sink.io_thread, NULL, sinkIoThread, NULL);
+    }
+    sink.active = 1;
+    pthread_create(&sink.writer, NULL, sinkWriter, NULL);
+    return 0;
+}
+
+/**
+ * @fn static void sinkSubmit(sink_block *b)
+ * @brief Entrega o bloco `b` à thread de escrita.
+ */
+static void sinkSubmit(sink_block *b)
+{
+    b->next = NULL;
+    pthread_mutex_lock(&sink.mutex);
+    if (sink.full_tail != NULL)
+    {
+        sink.full_tail->next = b;
+    }
+    else
+    {
+        sink.full_head = b;
+    }
+    sink.full_tail = b;
+    pthread_cond_signal(&sink.ready);
+    pthread_mutex_unlock(&sink.mutex);
+}
+
+/**
+ * @fn void sinkAppend(int consumer_index, const sale_record *sale)
+ * @brief Acrescenta a venda processada ao bloco do gerente, entregando-o quando enche.
+ *
+ * Não faz nada sem `--colunar`.
+ */
+void sinkAppend(int consumer_index, const sale_record *sale)
+{
+    if (!sink.active)
+    {
+        return;
+    }
+    sink_block *b = sink.current[consumer_index];
+    if (b == NULL)
+    {
+        pthread_mutex_lock(&sink.mutex);
+        b = sink.free_blocks;
+        sink.free_blocks = b != NULL ? b->next : NULL;
+        pthread_mutex_unlock(&sink.mutex);
+        if (b == NULL)
+        {
+            b = malloc(sizeof(sink_block));
+            if (b == NULL)
+            {
+                atomic_fetch_add(&sink.lost, 1);
+                return;
+            }
+            atomic_fetch_add(&sink.extra_blocks, 1);
+        }
+        b->rows = 0;
+        sink.current[consumer_index] = b;
+    }
+
+    int row = b->rows++;
+    b->timestamp_ns[row] = sale->timestamp_ns;
+    b->amount_cents[row] = sale->amount_cents;
+    b->register_id[row] = sale->register_id;
+    b->sku[row] = sale->sku;
+    b->store_id[row] = sale->store_id;
+    if (b->rows == SINK_BLOCK_ROWS)
+    {
+        sinkSubmit(b);
+        sink.current[consumer_index] = NULL;
+    }
+}
+
+/**
+ * @fn int sinkClose(void)
+ * @brief Entrega os blocos parciais dos gerentes, espera a thread de escrita terminar o
+ * arquivo e libera os blocos. Deve ser chamada depois que os gerentes encerraram.
+ *
+ * @return 0 em caso de sucesso, -1 se alguma escrita falhou.
+ */
+int sinkClose(void)
+{
+    if (!sink.active)
+    {
+        return 0;
+    }
+    for (int i = 0; i < NUM_CONSUMERS; i++)
+    {
+        if (sink.current[i] != NULL)
+        {
+            sinkSubmit(sink.current[i]);
+            sink.current[i] = NULL;
+        }
+    }
+    pthread_mutex_lock(&sink.mutex);
+    sink.closing = 1;
+    pthread_cond_signal(&sink.ready);
+    pthread_mutex_unlock(&sink.mutex);
+    pthread_join(sink.writer, NULL);
+    if (sink.io == SINK_IO_URING)
+    {
+        sinkUringTeardown();
+    }
+    else
+    {
+        pthread_mutex_lock(&sink.io_mutex);
+        sink.io_stop = 1;
+        pthread_cond_broadcast(&sink.io_cond);
+        pthread_mutex_unlock(&sink.io_mutex);
+        pthread_join(sink.io_thread, NULL);
+    }
+
+    while (sink.free_blocks != NULL)
+    {
+        sink_block *b = sink.free_blocks;
+        sink.free_blocks = b->next;
+        free(b);
+    }
+    close(sink.fd);
+    for (int b = 0; b < SINK_IO_BUFFERS; b++)
+    {
+        free(sink.buffers[b].data);
+        sink.buffers[b].data = NULL;
+    }
+    free(sink.index);
+    sink.index = NULL;
+    pthread_mutex_destroy(&sink.mutex);
+    pthread_cond_destroy(&sink.ready);
+    pthread_mutex_destroy(&sink.io_mutex);
+    pthread_cond_destroy(&sink.io_cond);
+    sink.active = 0;
+    return sink.failed ? -1 : 0;
+}
+
+/**
+ * @fn void printSinkStats(void)
+ * @brief Imprime o volume gravado no arquivo colunar, a taxa de compressão e as latências
+ * de submissão e de conclusão das escritas.
+ */
+void printSinkStats(void)
+{
+    double raw = (double)sink.rows * (2 * sizeof(int64_t) + 3 * sizeof(uint32_t));
+    printf("Arquivo colunar: %" PRId64 " vendas em %zu blocos, %" PRIu64 " bytes (%.2f bytes/venda, %.1fx menor que "
+           "as colunas sem compressão), %" PRId64 " blocos extras, %" PRId64 " vendas perdidas\n",
+           sink.rows, sink.index_count, sink.offset, sink.rows > 0 ? (double)sink.offset / sink.rows : 0.0,
+           sink.offset > 0 ? raw / sink.offset : 0.0, atomic_load(&sink.extra_blocks), atomic_load(&sink.lost));
+    printf("Escritas (%s): %" PRId64 " submissões, %.1f blocos por submissão | submissão média %.2f us, p99 %.2f "
+           "us | conclusão média %.2f us, p99 %.2f us, máx %.2f us\n",
+           sink.io == SINK_IO_URING ? "io_uring" : "pwrite", sink.submissions,
+           sink.submissions > 0 ? (double)sink.index_count / sink.submissions : 0.0, sink.submit_latency.mean / 1e3,
+           windowQuantile(&sink.submit_latency, 0.99) / 1e3, sink.complete_latency.mean / 1e3,
+           windowQuantile(&sink.complete_latency, 0.99) / 1e3,
+           sink.complete_latency.count > 0 ? sink.complete_latency.max / 1e3 : 0.0);
+}
+
+/**
+ * @fn int sinkRead(const char *path)
+ * @brief Lê um arquivo colunar, decodifica todas as colunas, confere os agregados do índice
+ * e imprime um resumo por bloco.
+ *
+ * @return 0 se o arquivo é válido, 1 caso contrário.
+ */
+int sinkRead(const char *path)
+{
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    off_t size = fd >= 0 ? lseek(fd, 0, SEEK_END) : -1;
+    if (size < (off_t)(16 + sizeof(sink_trailer)))
+    {
+        fprintf(stderr, "Arquivo colunar inválido: %s\n", path);
+        if (fd >= 0)
+        {
+            close(fd);
+        }
+        return 1;
+    }
+    const unsigned char *data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED)
+    {
+        perror("Erro ao mapear o arquivo colunar");
+        return 1;
+    }
+
+    sink_trailer trailer;
+    memcpy(&trailer, data + size - sizeof(trailer), sizeof(trailer));
+    int valid = memcmp(data, SINK_MAGIC, 8) == 0 && memcmp(trailer.magic, SINK_MAGIC, 8) == 0 &&
+                trailer.blocks < (uint64_t)size && trailer.index_offset < (uint64_t)size &&
+                trailer.index_offset + trailer.blocks * sizeof(sink_index_entry) + sizeof(trailer) == (uint64_t)size;
+    const sink_index_entry *index = (const sink_index_entry *)(data + trailer.index_offset);
+    int64_t rows = 0, total = 0;
+
+    for (uint64_t b = 0; valid && b < trailer.blocks; b++)
+    {
+        const sink_index_entry *entry = &index[b];
+        const unsigned char *p = data + entry->offset;
+        const unsigned char *end = data + trailer.index_offset;
+        int64_t timestamp = 0, sum = 0, first = INT64_MAX, last = INT64_MIN;
+        valid = entry->offset <= trailer.index_offset;
+        for (int c = 0; valid && c < SINK_COLUMNS; c++)
+        {
+            const unsigned char *column_end = p + entry->column_bytes[c];
+            valid = column_end <= end;
+            for (uint32_t i = 0; valid && i < entry->rows; i++)
+            {
+                uint64_t value;
+                p = getVarint(p, column_end, &value);
+                valid = p != NULL;
+                if (valid && c == 0)
+                {
+                    timestamp += unzigzag(value);
+                    first = timestamp < first ? timestamp : first;
+                    last = timestamp > last ? timestamp : last;
+                }
+                else if (valid && c == 1)
+                {
+                    sum += unzigzag(value);
+                }
+            }
+            valid = valid && p == column_end;
+        }
+        valid = valid && sum == entry->amount_sum && first == entry->first_ns && last == entry->last_ns;
+        if (valid)
+        {
+            printf("Bloco %4" PRIu64 ": %5" PRIu32 " vendas, R$ %" PRId64 ".%02" PRId64 " (mín R$ %" PRId64
+                   ".%02" PRId64 ", máx R$ %" PRId64 ".%02" PRId64 "), %.3f s, colunas de %" PRIu32 "/%" PRIu32
+                   "/%" PRIu32 "/%" PRIu32 "/%" PRIu32 " bytes\n",
+                   b, entry->rows, sum / 100, sum % 100, entry->amount_min / 100, entry->amount_min % 100,
+                   entry->amount_max / 100, entry->amount_max % 100, (last - first) / 1e9, entry->column_bytes[0],
+                   entry->column_bytes[1], entry->column_bytes[2], entry->column_bytes[3], entry->column_bytes[4]);
+            rows += entry->rows;
+            total += sum;
+        }
+    }
+    valid = valid && rows == (int64_t)trailer.rows;
+    munmap((void *)data, size);
+
+    if (!valid)
+    {
+        fprintf(stderr, "Arquivo colunar corrompido: %s\n", path);
+        return 1;
+    }
+    printf("%s: %" PRId64 " vendas em %" PRIu64 " blocos, total R$ %" PRId64 ".%02" PRId64 "\n", path, rows,
+           trailer.blocks, total / 100, total % 100);
+    return 0;
+}
+
+/**
+ * @struct sales_replay
+ * @brief Vendas gravadas que os produtores reproduzem em vez de gerá-las com `rand()`.
+ *
+ * O arquivo é mapeado com `mmap`. No formato binário, uma sequência de `sale_record` (como
+ * o arquivo de saída do pipeline), as vendas são lidas direto do mapeamento; um arquivo
+ * `.csv` tem uma venda por linha, `timestamp_ns,caixa,sku,centavos`, e é convertido uma vez
+ * na abertura. Linhas que não começam por um dígito (cabeçalho, comentários) são ignoradas.
+ *
+ * Cada venda vai para o produtor do seu caixa, preservando a ordem por caixa do arquivo;
+ * `by_producer` guarda os índices das vendas de cada produtor, contíguos a partir de
+ * `first[p]`. O pipeline, cujas threads de ingestão não correspondem a caixas, usa o
+ * cursor compartilhado `next_shared`. A venda `i` é publicada no instante
+ * `start_ns + (timestamp_i - base_ns) / config.replay_speed`.
+ */
+typedef struct
+{
+    const sale_record *sales;        /**< Vendas gravadas, no mapeamento ou em `parsed`. */
+    int64_t count;                   /**< Número de vendas; 0 quando não há reprodução. */
+    void *map;                       /**< Mapeamento do arquivo. */
+    size_t map_size;                 /**< Tamanho do mapeamento. */
+    sale_record *parsed;             /**< Vendas convertidas do CSV, ou NULL. */
+    int64_t *by_producer;            /**< Índices das vendas, agrupados por produtor. */
+    int64_t first[NUM_PRODUCERS + 1]; /**< Início do grupo de cada produtor em `by_producer`. */
+    int64_t next[NUM_PRODUCERS];     /**< Próxima venda de cada produtor, relativa a `first`. */
+    _Atomic int64_t next_shared;     /**< Próxima venda do cursor compartilhado. */
+    int64_t base_ns;                 /**< Menor instante gravado. */
+    int64_t start_ns;                /**< Início da reprodução em CLOCK_MONOTONIC. */
+} sales_replay;
+
+sales_replay replay;
+
+/**
+ * @fn static int replayProducerOf(const sale_record *sale)
+ * @brief Produtor que reproduz a venda: o do seu caixa, como na simulação.
+ */
+static int replayProducerOf(const sale_record *sale)
+{
+    return (int)((sale->register_id + NUM_PRODUCERS - 1) % NUM_PRODUCERS);
+}
+
+/**
+ * @fn static int parseCsvField(const char **cursor, const char *end, int64_t *value)
+ * @brief Lê um inteiro com sinal opcional de `*cursor` e pula o separador seguinte.
+ *
+ * O mapeamento não termina em '\0', por isso a leitura é limitada por `end` em vez de usar
+ * `strtoll`.
+ *
+ * @return 1 se um número foi lido, 0 caso contrário.
+ */
+static int parseCsvField(const char **cursor, const char *end, int64_t *value)
+{
+    const char *p = *cursor;
+    int negative = p < end && *p == '-';
+    p += negative;
+    if (p == end || *p < '0' || *p > '9')
+    {
+        return 0;
+    }
+    int64_t v = 0;
+    while (p < end && *p >= '0' && *p <= '9')
+    {
+        v = v * 10 + (*p++ - '0');
+    }
+    while (p < end && (*p == ' ' || *p == '\t'))
+    {
+        p++;
+    }
+    if (p < end && (*p == ',' || *p == ';'))
+    {
+        p++;
+    }
+    while (p < end && (*p == ' ' || *p == '\t'))
+    {
+        p++;
+    }
+    *value = negative ? -v : v;
+    *cursor = p;
+    return 1;
+}
+
+/**
+ * @fn static int64_t replayParseCsv(const char *data, size_t size)
+ * @brief Converte as linhas do CSV mapeado em `replay.parsed`.
+ *
+ * @return O número de vendas, ou -1 se faltar memória ou alguma linha for inválida.
+ */
+static int64_t replayParseCsv(const char *data, size_t size)
+{
+    const char *end = data + size;
+    int64_t lines = 0;
+    for (const char *p = data; p < end; p++)
+    {
+        lines += *p == '\n';
+    }
+    replay.parsed = malloc((lines + 1) * sizeof(sale_record));
+    if (replay.parsed == NULL)
+    {
+        return -1;
+    }
+
+    int64_t count = 0;
+    for (const char *p = data; p < end;)
+    {
+        const char *eol = memchr(p, '\n', end - p);
+        eol = eol != NULL ? eol : end;
+        if (*p >= '0' && *p <= '9')
+        {
+            int64_t fields[4];
+            const char *cursor = p;
+            for (int i = 0; i < 4; i++)
+            {
+                if (!parseCsvField(&cursor, eol, &fields[i]))
+                {
+                    fprintf(stderr, "Linha %" PRId64 " inválida no arquivo de vendas\n", count + 1);
+                    return -1;
+                }
+            }
+            sale_record *sale = &replay.parsed[count++];
+            memset(sale, 0, sizeof(*sale));
+            sale->timestamp_ns = fields[0];
+            sale->register_id = (uint32_t)fields[1];
+            sale->sku = (uint32_t)fields[2];
+            sale->amount_cents = fields[3];
+        }
+        p = eol < end ? eol + 1 : end;
+    }
+    return count;
+}
+
+/**
+ * @fn int replayOpen(const char *path)
+ * @brief Mapeia o arquivo de vendas `path` e distribui as vendas entre os produtores.
+ *
+ * @return 0 em caso de sucesso, -1 se o arquivo não puder ser lido, estiver vazio ou for
+ * inválido.
+ */
+int replayOpen(const char *path)
+{
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        return -1;
+    }
+    off_t size = lseek(fd, 0, SEEK_END);
+    if (size <= 0)
+    {
+        close(fd);
+        return -1;
+    }
+    replay.map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (replay.map == MAP_FAILED)
+    {
+        replay.map = NULL;
+        return -1;
+    }
+    replay.map_size = size;
+    madvise(replay.map, size, MADV_SEQUENTIAL);
+
+    size_t length = strlen(path);
+    if (length >= 4 && strcmp(path + length - 4, ".csv") == 0)
+    {
+        replay.count = replayParseCsv(replay.map, size);
+        replay.sales = replay.parsed;
+    }
+    else if (size % sizeof(sale_record) == 0)
+    {
+        replay.count = size / sizeof(sale_record);
+        replay.sales = replay.map;
+    }
+    else
+    {
+        replay.count = -1;
+    }
+    replay.by_producer = replay.count > 0 ? malloc(replay.count * sizeof(int64_t)) : NULL;
+    if (replay.by_producer == NULL)
+    {
+        replay.count = 0;
+        return -1;
+    }
+
+    // Ordenação por contagem: índices de cada produtor contíguos, na ordem do arquivo.
+    replay.base_ns = INT64_MAX;
+    for (int64_t i = 0; i < replay.count; i++)
+    {
+        replay.first[replayProducerOf(&replay.sales[i]) + 1]++;
+        replay.base_ns = replay.sales[i].timestamp_ns < replay.base_ns ? replay.sales[i].timestamp_ns : replay.base_ns;
+    }
+    for (int p = 0; p < NUM_PRODUCERS; p++)
+    {
+        replay.first[p + 1] += replay.first[p];
+    }
+    for (int64_t i = 0; i < replay.count; i++)
+    {
+        int p = replayProducerOf(&replay.sales[i]);
+        replay.by_producer[replay.first[p] + replay.next[p]++] = i;
+    }
+    return 0;
+}
+
+/**
+ * @fn void replayClose(void)
+ * @brief Desfaz o mapeamento e libera os índices da reprodução.
+ */
+void replayClose(void)
+{
+    if (replay.map != NULL)
+    {
+        munmap(replay.map, replay.map_size);
+    }
+    free(replay.parsed);
+    free(replay.by_producer);
+    memset(&replay, 0, sizeof(replay));
+}
+
+/**
+ * @fn int64_t replayCount(int producer_index)
+ * @brief Vendas gravadas do produtor `producer_index`, ou de todos se for -1.
+ */
+int64_t replayCount(int producer_index)
+{
+    if (producer_index < 0)
+    {
+        return replay.count;
+    }
+    return replay.first[producer_index + 1] - replay.first[producer_index];
+}
+
+/**
+ * @fn void replayStart(void)
+ * @brief Volta os cursores ao início e marca o instante zero da reprodução.
+ */
+void replayStart(void)
+{
+    memset(replay.next, 0, sizeof(replay.next));
+    atomic_store(&replay.next_shared, 0);
+    replay.start_ns = monotonicNs();
+}
+
+/**
+ * @fn const sale_record *replayNext(int producer_index)
+ * @brief Espera o instante da próxima venda gravada do produtor e a devolve.
+ *
+ * Com `producer_index` igual a -1, usa o cursor compartilhado por todas as threads. A
+ * pausa é absoluta (`clock_nanosleep` com TIMER_ABSTIME), de modo que atrasos de uma venda
+ * não se acumulam nas seguintes.
+ *
+ * @return A venda, que deve ser copiada com `replayCopy`, ou NULL se as vendas acabaram.
+ */
+const sale_record *replayNext(int producer_index)
+{
+    int64_t index;
+    if (producer_index < 0)
+    {
+        index = atomic_fetch_add_explicit(&replay.next_shared, 1, memory_order_relaxed);
+        if (index >= replay.count)
+        {
+            return NULL;
+        }
+    }
+    else
+    {
+        if (replay.next[producer_index] >= replayCount(producer_index))
+        {
+            return NULL;
+        }
+        index = replay.by_producer[replay.first[producer_index] + replay.next[producer_index]++];
+    }
+
+    const sale_record *sale = &replay.sales[index];
+    if (config.replay_speed > 0)
+    {
+        int64_t offset = (int64_t)((sale->timestamp_ns - replay.base_ns) / config.replay_speed);
+        int64_t now = monotonicNs();
+        int64_t target = replay.start_ns + offset;
+        target = target - now > REPLAY_MAX_SLEEP_NS ? now + REPLAY_MAX_SLEEP_NS : target;
+        struct timespec when = {target / 1000000000LL, target % 1000000000LL};
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &when, NULL) == EINTR)
+        {
+        }
+    }
+    return sale;
+}
+
+/**
+ * @fn void replayCopy(sale_record *sale, const sale_record *recorded)
+ * @brief Escreve no lugar a venda gravada `recorded`, com o instante atual e a loja
+ * recalculada a partir do caixa.
+ *
+ * O instante é o da reprodução para que as latências e as janelas de análise meçam esta
+ * execução; o formato do tráfego fica nos intervalos entre as publicações.
+ */
+void replayCopy(sale_record *sale, const sale_record *recorded)
+{
+    *sale = *recorded;
+    sale->store_id = sale->register_id > 0 ? storeOf((int)sale->register_id) : 0;
+    memset(sale->reserved, 0, sizeof(sale->reserved));
+    sale->timestamp_ns = realtimeNs();
+}
+
+/**
+ * @fn void fillSale(sale_record *sale, int register_id, int64_t amount_cents)
+ * @brief Escreve no lugar uma venda aleatória de `amount_cents` para o caixa `register_id`.
+ *
+ * O valor é sorteado pelo caixa antes de reservar a posição, para que a topologia de
+ * prioridades escolha o nível; o instante é lido de CLOCK_REALTIME. Todos os campos são
+ * escritos, inclusive os reservados, porque a posição do anel pode conter a venda de uma
+ * volta anterior.
+ */
+void fillSale(sale_record *sale, int register_id, int64_t amount_cents)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+
+    sale->timestamp_ns = (int64_t)now.tv_sec * 1000000000LL + now.tv_nsec;
+    sale->amount_cents = amount_cents;
+    sale->register_id = (uint32_t)register_id;
+    sale->sku = (uint32_t)(rand() % 100000);
+    sale->store_id = storeOf(register_id);
+    memset(sale->reserved, 0, sizeof(sale->reserved));
+}
+
+/**
+ * @fn void *producer(void *args)
+ * @brief Função executada pelas threads produtoras.
+ *
+ * Cada produtor gera um número pré-definido de vendas (itens). Para cada venda,
+ * ele reserva uma posição do anel ou de sua faixa (`salesClaim`, que espera se a fila
+ * estiver cheia), escreve a venda diretamente nela e a publica (`salesCommit`), sem cópia
+ * intermediária. Com `--replay`, as vendas e os intervalos entre elas vêm do arquivo
+ * gravado (`replayNext`) em vez de `rand()`.
+ * Ao final de sua produção, decrementa o contador `active_producers`, usado apenas nas
+ * mensagens; o fechamento das filas fica a cargo de `main`. Os argumentos vêm da arena da
+ * execução e não são liberados pela thread.
+ *
+ * @param args Ponteiro para uma estrutura `producer_args` contendo o ID da thread e o número de vendas a produzir.
+ * @return NULL.
+ */
+void *producer(void *args)
+{
+    producer_args *p_args = (producer_args *)args;
+    int tid = p_args->thread_id;
+    int sales_to_produce = p_args->num_sales;
+    uint64_t mallocs = mallocCount();
+
+    for (size_t i = 0; i < sales_to_produce; i++)
+    {
+        // O valor vem antes da reserva: ele decide o nível na topologia de prioridades.
+        const sale_record *recorded = replay.count > 0 ? replayNext(tid - 1) : NULL;
+        int64_t drawn_cents = recorded != NULL ? recorded->amount_cents : rand() % 100000 + 100;
+        slot_ref ref;
+        sale_record *sale = salesClaimPriority(tid - 1, priorityOf(drawn_cents), &ref);
+        if (recorded != NULL)
+        {
+            replayCopy(sale, recorded);
+        }
+        else
+        {
+            fillSale(sale, tid, drawn_cents);
+        }
+
+        // Depois do commit a posição pertence aos consumidores; guardamos o que será impresso.
+        int64_t amount_cents = sale->amount_cents;
+        uint32_t sku = sale->sku;
+        salesCommit(&ref);
+
+        if (ref.outcome == SLOT_QUEUED)
+        {
+            printf("(P) TID %d | VENDA: R$ %" PRId64 ".%02" PRId64 " | SKU %" PRIu32 " | Buffer: %d/%d\n",
+                   tid, amount_cents / 100, amount_cents % 100, sku, salesBacklog(&ref), BUFFER_SIZE);
+        }
+        else
+        {
+            printf("(P) TID %d | VENDA: R$ %" PRId64 ".%02" PRId64 " | SKU %" PRIu32 " | Buffer cheio: %s\n",
+                   tid, amount_cents / 100, amount_cents % 100, sku,
+                   ref.outcome == SLOT_SPILLED     ? "gravada no transbordo"
+                   : ref.outcome == SLOT_TIMED_OUT ? "prazo esgotado, descartada"
+                                                   : "descartada");
+        }
+
+        if (replay.count == 0)
+        {
+            sleep((rand() % 3) + 1); // Pausa menor para aumentar a concorrência
+        }
+    }
+
+    // No final do producer
+    pthread_mutex_lock(&mutex);
+    active_producers--;
+    printf(">>>> (P) Caixa %d finalizou. Produtores ativos: %d <<<<\n", tid, active_producers);
+    pthread_mutex_unlock(&mutex);
+
+    mallocAccount(mallocs);
+    pthread_exit(NULL);
+}
+
+/**
+ * @fn static int consumeSpilled(int tid, int64_t store_totals[NUM_STORES])
+ * @brief Processa uma venda do arquivo de transbordo, se houver alguma.
+ *
+ * @return 1 se processou uma venda, 0 se o transbordo está vazio.
+ */
+static int consumeSpilled(int tid, int64_t store_totals[NUM_STORES])
+{
+    sale_record sale;
+    if (!spillTake(&sale))
+    {
+        return 0;
+    }
+
+    store_totals[sale.store_id % NUM_STORES] += sale.amount_cents;
+    analyticsAdd(tid - 1, sale.timestamp_ns, sale.amount_cents);
+    sinkAppend(tid - 1, &sale);
+    printf("    (C) TID %d | PROCESSOU: R$ %" PRId64 ".%02" PRId64 " do caixa %" PRIu32 " | do transbordo\n",
+           tid, sale.amount_cents / 100, sale.amount_cents % 100, sale.register_id);
+    return 1;
+}
+
+/**
+ * @fn void *consumer(void *args)
+ * @brief Função executada pelas threads consumidoras.
+ *
+ * Cada consumidor opera em um loop infinito, tentando processar vendas. Ele aguarda
+ * até que uma venda esteja publicada no anel ou em uma de suas faixas (`salesPeek`). Se
+ * as filas foram fechadas (não há mais produtores ativos) e estão vazias, ele encerra.
+ * Caso contrário, lê a venda no lugar e devolve a posição aos produtores (`salesRelease`).
+ *
+ * Na topologia por loja, o gerente acumula o total de cada loja e, a cada REBALANCE_EVERY
+ * vendas, verifica se deve ceder uma partição (`maybeRebalance`).
+ *
+ * Com a política `disco`, depois de cada venda da fila o gerente processa também uma
+ * venda do arquivo de transbordo, e antes de encerrar esvazia o arquivo.
+ *
+ * @param args Ponteiro para uma estrutura `consumer_args` contendo o ID da thread.
+ * @return NULL.
+ */
+void *consumer(void *args)
+{
+    consumer_args *c_args = (consumer_args *)args;
+    int tid = c_args->thread_id;
+    int sales_processed = 0;
+    int64_t store_totals[NUM_STORES] = {0};
+    uint64_t mallocs = mallocCount();
+
+    while (1)
+    {
+        // Espera por um item. Este é o ponto de bloqueio.
+        slot_ref ref;
+        int64_t wait_ns = consumerWaitNs();
+        struct timespec deadline = deadlineAfter(wait_ns);
+        const sale_record *sale = salesPeekUntil(tid - 1, &ref, wait_ns > 0 ? &deadline : NULL);
+        if (sale == NULL && errno == ETIMEDOUT)
+        {
+            analyticsTick(tid - 1);
+            if (wait_ns == config.timeout_ns)
+            {
+                printf("    (C) TID %d | Nenhuma venda em %lld ms\n", tid, config.timeout_ns / 1000000);
+            }
+            sales_processed += consumeSpilled(tid, store_totals);
+            continue;
+        }
+        if (sale == NULL)
+        {
+            // Filas fechadas e vazias: não há mais produtores nem vendas.
+            break;
+        }
+
+        int64_t amount_cents = sale->amount_cents;
+        uint32_t register_id = sale->register_id;
+        store_totals[sale->store_id % NUM_STORES] += amount_cents;
+        priorityObserve(tid - 1, &ref, realtimeNs() - sale->timestamp_ns);
+        analyticsAdd(tid - 1, sale->timestamp_ns, amount_cents);
+        sinkAppend(tid - 1, sale);
+        salesRelease(&ref);
+        sales_processed++;
+
+        printf("    (C) TID %d | PROCESSOU: R$ %" PRId64 ".%02" PRId64 " do caixa %" PRIu32 " | Buffer: %d/%d\n",
+               tid, amount_cents / 100, amount_cents % 100, register_id, salesBacklog(&ref), BUFFER_SIZE);
+
+        // As vendas do transbordo são intercaladas com as da fila, uma para uma.
+        sales_processed += consumeSpilled(tid, store_totals);
+
+        int target;
+        int moved = config.topology == TOPOLOGY_SHARDS && sales_processed % REBALANCE_EVERY == 0
+                        ? maybeRebalance(tid - 1, &target)
+                        : -1;
+        if (moved >= 0)
+        {
+            printf(">>>> (C) Gerente %d cedeu a partição %d ao gerente %d <<<<\n", tid, moved, target + 1);
+        }
+    }
+
+    while (consumeSpilled(tid, store_totals))
+    {
+        sales_processed++;
+    }
+    analyticsDone(tid - 1);
+
+    printf(">>>> (C) Gerente %d finalizou. Total de vendas processadas: %d <<<<\n", tid, sales_processed);
+    if (config.topology == TOPOLOGY_SHARDS)
+    {
+        for (int i = 0; i < NUM_STORES; i++)
+        {
+            if (store_totals[i] != 0)
+            {
+                printf("     Gerente %d | Loja %d: R$ %" PRId64 ".%02" PRId64 "\n",
+                       tid, i + 1, store_totals[i] / 100, store_totals[i] % 100);
+            }
+        }
+    }
+    mallocAccount(mallocs);
+    pthread_exit(NULL);
+}
+
+/**
+ * @struct bench_state
+ * @brief Latências coletadas pelos consumidores durante uma rodada do benchmark.
+ */
+typedef struct
+{
+    int64_t *latencies;        /**< Latência de cada venda, do commit à leitura, em nanossegundos. */
+    _Atomic long long next;    /**< Próxima posição livre em `latencies`. */
+} bench_state;
+
+bench_state bench;
+
+/**
+ * @fn static int64_t benchAmount(int i)
+ * @brief Valor da `i`-ésima venda de um produtor do benchmark.
+ *
+ * Com `--alto-valor` ligado, mistura em proporção fixa estornos, vendas de valor alto e
+ * vendas normais, para que a topologia de prioridades tenha os três níveis ocupados; com
+ * `-H 0`, todas as vendas são normais, como referência de vazão.
+ */
+static int64_t benchAmount(int i)
+{
+    int64_t amount_cents = 100 + i % 100000;
+    if (config.high_value_cents == 0)
+    {
+        return amount_cents;
+    }
+    if (i % BENCH_REFUND_EVERY == 0)
+    {
+        return -(100 + i % 10000);
+    }
+    if (i % BENCH_HIGH_VALUE_EVERY == 1)
+    {
+        return config.high_value_cents + i % 100000;
+    }
+    return amount_cents % config.high_value_cents;
+}
+
+/**
+ * @fn void *benchProducer(void *args)
+ * @brief Produtor do benchmark: publica `num_sales` vendas sem mensagens, pausando
+ * `config.bench_gap_ns` entre elas, ou reproduz as vendas gravadas do seu caixa.
+ *
+ * O instante da venda é gravado imediatamente antes do commit, de modo que a latência
+ * medida pelo consumidor é a da passagem pelo anel, incluindo o tempo para acordar.
+ */
+void *benchProducer(void *args)
+{
+    producer_args *p_args = (producer_args *)args;
+    struct timespec gap = {config.bench_gap_ns / 1000000000LL, config.bench_gap_ns % 1000000000LL};
+    uint64_t mallocs = mallocCount();
+
+    for (int i = 0; i < p_args->num_sales; i++)
+    {
+        if (replay.count > 0)
+        {
+            const sale_record *recorded = replayNext(p_args->thread_id - 1);
+            slot_ref ref;
+            replayCopy(salesClaimPriority(p_args->thread_id - 1, priorityOf(recorded->amount_cents), &ref), recorded);
+            salesCommit(&ref);
+            continue;
+        }
+
+        slot_ref ref;
+        int64_t amount_cents = benchAmount(i);
+        sale_record *sale = salesClaimPriority(p_args->thread_id - 1, priorityOf(amount_cents), &ref);
+        sale->amount_cents = amount_cents;
+        sale->register_id = (uint32_t)p_args->thread_id;
+        sale->sku = (uint32_t)i;
+        sale->store_id = storeOf(p_args->thread_id);
+        memset(sale->reserved, 0, sizeof(sale->reserved));
+        sale->timestamp_ns = realtimeNs();
+        salesCommit(&ref);
+
+        if (config.bench_gap_ns > 0)
+        {
+            nanosleep(&gap, NULL);
+        }
+    }
+
+    mallocAccount(mallocs);
+    return NULL;
+}
+
+/**
+ * @fn void *benchConsumer(void *args)
+ * @brief Consumidor do benchmark: lê vendas até as filas serem fechadas e esvaziadas,
+ * registrando a latência de cada uma.
+ */
+void *benchConsumer(void *args)
+{
+    int consumer_index = (int)(intptr_t)args;
+    uint64_t mallocs = mallocCount();
+    for (;;)
+    {
+        slot_ref ref;
+        int64_t wait_ns = consumerWaitNs();
+        struct timespec deadline = deadlineAfter(wait_ns);
+        const sale_record *sale = salesPeekUntil(consumer_index, &ref, wait_ns > 0 ? &deadline : NULL);
+        if (sale == NULL && errno == ETIMEDOUT)
+        {
+            analyticsTick(consumer_index);
+            continue;
+        }
+        if (sale == NULL)
+        {
+            break;
+        }
+
+        int64_t latency = realtimeNs() - sale->timestamp_ns;
+        priorityObserve(consumer_index, &ref, latency);
+        analyticsAdd(consumer_index, sale->timestamp_ns, sale->amount_cents);
+        sinkAppend(consumer_index, sale);
+        salesRelease(&ref);
+        long long received = atomic_fetch_add_explicit(&bench.next, 1, memory_order_relaxed);
+        bench.latencies[received] = latency;
+
+        sale_record spilled;
+        if (spillTake(&spilled))
+        {
+            bench.latencies[atomic_fetch_add_explicit(&bench.next, 1, memory_order_relaxed)] =
+                realtimeNs() - spilled.timestamp_ns;
+            analyticsAdd(consumer_index, spilled.timestamp_ns, spilled.amount_cents);
+            sinkAppend(consumer_index, &spilled);
+        }
+
+        int target;
+        if (config.topology == TOPOLOGY_SHARDS && received % REBALANCE_EVERY == 0)
+        {
+            maybeRebalance(consumer_index, &target);
+        }
+    }
+
+    sale_record spilled;
+    while (spillTake(&spilled))
+    {
+        bench.latencies[atomic_fetch_add_explicit(&bench.next, 1, memory_order_relaxed)] =
+            realtimeNs() - spilled.timestamp_ns;
+        analyticsAdd(consumer_index, spilled.timestamp_ns, spilled.amount_cents);
+        sinkAppend(consumer_index, &spilled);
+    }
+    analyticsDone(consumer_index);
+
+    mallocAccount(mallocs);
+    return NULL;
+}
+
+/**
+ * @fn static int compareLatency(const void *a, const void *b)
+ * @brief Comparador de `int64_t` para `qsort`.
+ */
+static int compareLatency(const void *a, const void *b)
+{
+    int64_t x = *(const int64_t *)a;
+    int64_t y = *(const int64_t *)b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * @fn int runBenchmark(wait_strategy strategy)
+ * @brief Mede uma rodada do anel com a estratégia `strategy`.
+ *
+ * Cria NUM_PRODUCERS produtores com `config.bench_sales` vendas cada (com `--replay`, as
+ * vendas gravadas do caixa, limitadas a `config.bench_sales`) e NUM_CONSUMERS
+ * consumidores, e imprime a vazão, a latência média, a mediana e o percentil 99, e o uso
+ * de CPU do processo (tempo de usuário mais sistema dividido pelo tempo decorrido, em
+ * núcleos). As estratégias que giram trocam CPU por latência; as que dormem, o contrário.
+ *
+ * @return 0 em caso de sucesso, -1 se faltar memória ou o anel não puder ser criado.
+ */
+int runBenchmark(wait_strategy strategy)
+{
+    pthread_t producers[NUM_PRODUCERS];
+    pthread_t consumers[NUM_CONSUMERS];
+    producer_args args[NUM_PRODUCERS];
+    long long total = 0;
+    for (int i = 0; i < NUM_PRODUCERS; i++)
+    {
+        args[i].thread_id = i + 1;
+        args[i].num_sales = (int)config.bench_sales;
+        if (replay.count > 0 && replayCount(i) < config.bench_sales)
+        {
+            args[i].num_sales = (int)replayCount(i);
+        }
+        total += args[i].num_sales;
+    }
+
+    bench.latencies = malloc(total * sizeof(int64_t));
+    if (bench.latencies == NULL || salesCreate(strategy) != 0 || analyticsCreate(config.window_ns) != 0 ||
+        (config.sink_path != NULL && sinkOpen(config.sink_path) != 0))
+    {
+        free(bench.latencies);
+        return -1;
+    }
+    atomic_store(&bench.next, 0);
+    priorityStatsReset();
+
+    struct rusage usage_start, usage_end;
+    struct timespec wall_start, wall_end;
+    getrusage(RUSAGE_SELF, &usage_start);
+    clock_gettime(CLOCK_MONOTONIC, &wall_start);
+    replayStart();
+
+    int run_producers = config.role != SHM_MANAGERS;
+    int run_consumers = config.role != SHM_REGISTERS;
+    for (int i = 0; run_consumers && i < NUM_CONSUMERS; i++)
+    {
+        pthread_create(&consumers[i], NULL, benchConsumer, (void *)(intptr_t)i);
+    }
+    for (int i = 0; run_producers && i < NUM_PRODUCERS; i++)
+    {
+        pthread_create(&producers[i], NULL, benchProducer, &args[i]);
+    }
+
+    for (int i = 0; run_producers && i < NUM_PRODUCERS; i++)
+    {
+        pthread_join(producers[i], NULL);
+    }
+    long long dropped = atomic_load(&overflow_stats.dropped_oldest) + atomic_load(&overflow_stats.dropped_newest) +
+                        atomic_load(&overflow_stats.timed_out);
+    if (run_producers)
+    {
+        salesPublishExpected(total - dropped);
+        salesClose();
+    }
+    for (int i = 0; run_consumers && i < NUM_CONSUMERS; i++)
+    {
+        pthread_join(consumers[i], NULL);
+    }
+    if (!run_producers)
+    {
+        // O processo dos caixas informou no anel quantas vendas publicou.
+        total = atomic_load(&ringSharedHeader(ring)->expected);
+        dropped = 0;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &wall_end);
+    int sink_failed = sinkClose() != 0;
+    getrusage(RUSAGE_SELF, &usage_end);
+
+    double wall = (wall_end.tv_sec - wall_start.tv_sec) + (wall_end.tv_nsec - wall_start.tv_nsec) / 1e9;
+    double cpu = (usage_end.ru_utime.tv_sec - usage_start.ru_utime.tv_sec) +
+                 (usage_end.ru_utime.tv_usec - usage_start.ru_utime.tv_usec) / 1e6 +
+                 (usage_end.ru_stime.tv_sec - usage_start.ru_stime.tv_sec) +
+                 (usage_end.ru_stime.tv_usec - usage_start.ru_stime.tv_usec) / 1e6;
+
+    long long received = atomic_load(&bench.next);
+    qsort(bench.latencies, received, sizeof(int64_t), compareLatency);
+    double mean = 0;
+    for (long long i = 0; i < received; i++)
+    {
+        mean += bench.latencies[i];
+    }
+    mean = received > 0 ? mean / received : 0;
+
+    if (!run_consumers)
+    {
+        printf("%-8s %12.0f vendas/s publicadas no anel compartilhado | CPU %5.2f núcleos\n",
+               wait_strategy_names[strategy], (total - dropped) / wall, cpu / wall);
+        received = total - dropped;
+    }
+    else
+    {
+        printf("%-8s %12.0f vendas/s | latência média %9.2f us, p50 %9.2f us, p99 %9.2f us | CPU %5.2f núcleos\n",
+               wait_strategy_names[strategy], received / wall, mean / 1e3,
+               received > 0 ? bench.latencies[received / 2] / 1e3 : 0.0,
+               received > 0 ? bench.latencies[received * 99 / 100] / 1e3 : 0.0, cpu / wall);
+    }
+    if (config.topology == TOPOLOGY_SHARDS)
+    {
+        printf("         partições migradas: %d\n", atomic_load(&shards.migrations));
+    }
+    if (config.topology == TOPOLOGY_PRIORITY)
+    {
+        printPriorityStats("         ");
+    }
+    if (config.topology == TOPOLOGY_SEGMENTS)
+    {
+        printSegmentStats("         ");
+    }
+    printAllocStats("         ");
+    printf("         ");
+    printOverflowStats();
+    if (config.window_ns > 0)
+    {
+        printf("         ");
+        printAnalyticsStats();
+    }
+    if (config.sink_path != NULL)
+    {
+        printf("         ");
+        printSinkStats();
+    }
+    analyticsDestroy();
+
+    free(bench.latencies);
+    salesDestroy();
+    return received + dropped == total && !sink_failed ? 0 : -1;
+}
+
+/**
+ * @struct pipeline_worker
+ * @brief Estado de uma thread de um estágio do pipeline.
+ *
+ * Cada estágio usa só a parte que lhe interessa: o gerador da ingestão, os totais por
+ * loja da agregação ou o lote de escrita da persistência. Os contadores são locais e
+ * somados aos do estágio quando a thread termina, para não disputar linhas de cache.
+ */
+typedef struct pipeline_worker
+{
+    struct pipeline_stage *stage;             /**< Estágio da thread. */
+    int index;                                /**< Índice da thread no estágio. */
+    uint64_t rng;                             /**< Estado do gerador xorshift da ingestão. */
+    int64_t store_totals[NUM_STORES];         /**< Totais por loja da agregação, em centavos. */
+    int64_t latency_ns;                       /**< Soma das latências de ponta a ponta da persistência. */
+    int batch_count;                          /**< Vendas em `batch`. */
+    sale_record batch[PIPELINE_WRITE_BATCH];  /**< Lote da persistência. */
+} pipeline_worker;
+
+/**
+ * @struct pipeline_stage
+ * @brief Estágio do pipeline: uma função aplicada por um conjunto de threads às vendas do
+ * anel de entrada, cujo resultado segue para o anel de saída.
+ *
+ * Um estágio sem entrada é a fonte e gera vendas diretamente nas posições do anel de
+ * saída; um estágio sem saída é o destino. `process` devolve 0 para descartar a venda.
+ * A última thread de um estágio a terminar fecha o anel de saída (`ringClose`), e o
+ * fechamento se propaga assim até o destino.
+ *
+ * As métricas permitem achar o gargalo: `busy_ns` é o tempo gasto em `process` (a
+ * ocupação do estágio), `blocked_ns` o tempo esperando espaço no anel de saída (o estágio
+ * seguinte não acompanha) e a profundidade do anel de entrada é amostrada pelo monitor.
+ */
+typedef struct pipeline_stage
+{
+    const char *name;                                    /**< Nome impresso nas métricas. */
+    int (*process)(pipeline_worker *worker, sale_record *sale); /**< Trabalho por venda. */
+    void (*finish)(pipeline_worker *worker);             /**< Chamada ao fim de cada thread, ou NULL. */
+    int workers;                                         /**< Threads do estágio. */
+    sales_ring *in;                                      /**< Anel de entrada; NULL na fonte. */
+    sales_ring *out;                                     /**< Anel de saída; NULL no destino. */
+    _Atomic int running;                                 /**< Threads ainda em execução. */
+    _Atomic int64_t processed;                           /**< Vendas tratadas. */
+    _Atomic int64_t dropped;                             /**< Vendas descartadas por `process`. */
+    _Atomic int64_t busy_ns;                             /**< Tempo em `process`. */
+    _Atomic int64_t blocked_ns;                          /**< Tempo esperando espaço no anel de saída. */
+    int64_t depth_sum;                                   /**< Soma das amostras de profundidade da entrada. */
+    int64_t depth_max;                                   /**< Maior profundidade amostrada da entrada. */
+} pipeline_stage;
+
+/**
+ * @struct sales_pipeline
+ * @brief Estágios do pipeline e resultados compartilhados.
+ */
+typedef struct
+{
+    pipeline_stage stages[NUM_PIPELINE_STAGES]; /**< Estágios, da fonte ao destino. */
+    int64_t sales_per_worker;                   /**< Vendas geradas por thread de ingestão. */
+    int output_fd;                              /**< Arquivo da persistência. */
+    pthread_mutex_t mutex;                      /**< Protege `store_totals` e `latency_ns`. */
+    int64_t store_totals[NUM_STORES];           /**< Totais por loja somados pela agregação. */
+    int64_t latency_ns;                         /**< Soma das latências de ponta a ponta. */
+    _Atomic int done;                           /**< Diferente de zero quando o destino terminou. */
+    int64_t samples;                            /**< Amostras feitas pelo monitor. */
+} sales_pipeline;
+
+sales_pipeline pipeline;
+
+/**
+ * @fn static int ingestSale(pipeline_worker *worker, sale_record *sale)
+ * @brief Fonte: gera uma venda sintética; cerca de uma em mil tem valor inválido, para
+ * exercitar a validação. Com `--replay`, copia a próxima venda gravada.
+ *
+ * @return 1, ou 0 se as vendas gravadas acabaram.
+ */
+static int ingestSale(pipeline_worker *worker, sale_record *sale)
+{
+    if (replay.count > 0)
+    {
+        const sale_record *recorded = replayNext(-1);
+        if (recorded != NULL)
+        {
+            replayCopy(sale, recorded);
+        }
+        return recorded != NULL;
+    }
+
+    uint64_t x = worker->rng;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    worker->rng = x;
+
+    sale->amount_cents = 100 + (int64_t)(x % 100000);
+    if (x % 1000 == 0)
+    {
+        sale->amount_cents = -sale->amount_cents;
+    }
+    sale->register_id = (uint32_t)((x >> 20) % NUM_PRODUCERS) + 1;
+    sale->sku = (uint32_t)(x >> 32) % 100000;
+    sale->store_id = 0;
+    memset(sale->reserved, 0, sizeof(sale->reserved));
+    sale->timestamp_ns = realtimeNs();
+    return 1;
+}
+
+/**
+ * @fn static int validateSale(pipeline_worker *worker, sale_record *sale)
+ * @brief Descarta vendas com valor fora de (0, R$ 1.000.000,00] ou sem caixa.
+ */
+static int validateSale(pipeline_worker *worker, sale_record *sale)
+{
+    (void)worker;
+    return sale->amount_cents > 0 && sale->amount_cents <= 100000000 && sale->register_id != 0;
+}
+
+/**
+ * @fn static int aggregateSale(pipeline_worker *worker, sale_record *sale)
+ * @brief Enriquece a venda com a loja do caixa e soma o valor ao total da loja.
+ */
+static int aggregateSale(pipeline_worker *worker, sale_record *sale)
+{
+    sale->store_id = storeOf((int)sale->register_id);
+    worker->store_totals[sale->store_id] += sale->amount_cents;
+    return 1;
+}
+
+/**
+ * @fn static void aggregateFinish(pipeline_worker *worker)
+ * @brief Soma os totais da thread aos do pipeline.
+ */
+static void aggregateFinish(pipeline_worker *worker)
+{
+    pthread_mutex_lock(&pipeline.mutex);
+    for (int i = 0; i < NUM_STORES; i++)
+    {
+        pipeline.store_totals[i] += worker->store_totals[i];
+    }
+    pthread_mutex_unlock(&pipeline.mutex);
+}
+
+/**
+ * @fn static void persistFlush(pipeline_worker *worker)
+ * @brief Grava o lote da thread no arquivo de saída com um único `write`.
+ */
+static void persistFlush(pipeline_worker *worker)
+{
+    const char *data = (const char *)worker->batch;
+    size_t left = worker->batch_count * sizeof(sale_record);
+    while (left > 0)
+    {
+        ssize_t written = write(pipeline.output_fd, data, left);
+        if (written < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (written < 0)
+        {
+            perror("Erro ao gravar as vendas do pipeline");
+            break;
+        }
+        data += written;
+        left -= (size_t)written;
+    }
+    worker->batch_count = 0;
+}
+
+/**
+ * @fn static int persistSale(pipeline_worker *worker, sale_record *sale)
+ * @brief Destino: acumula a venda no lote da thread e registra a latência de ponta a ponta.
+ */
+static int persistSale(pipeline_worker *worker, sale_record *sale)
+{
+    worker->latency_ns += realtimeNs() - sale->timestamp_ns;
+    worker->batch[worker->batch_count++] = *sale;
+    if (worker->batch_count == PIPELINE_WRITE_BATCH)
+    {
+        persistFlush(worker);
+    }
+    return 1;
+}
+
+/**
+ * @fn static void persistFinish(pipeline_worker *worker)
+ * @brief Grava o lote restante e soma a latência da thread à do pipeline.
+ */
+static void persistFinish(pipeline_worker *worker)
+{
+    persistFlush(worker);
+    pthread_mutex_lock(&pipeline.mutex);
+    pipeline.latency_ns += worker->latency_ns;
+    pthread_mutex_unlock(&pipeline.mutex);
+}
+
+/**
+ * @fn void *pipelineWorker(void *args)
+ * @brief Laço de uma thread de estágio: lê do anel de entrada, aplica `process` e publica
+ * no anel de saída, até a entrada ser fechada e esvaziada.
+ *
+ * A venda é copiada uma vez por salto (32 bytes), para liberar logo a posição de entrada;
+ * a fonte escreve direto na posição reservada do anel de saída.
+ */
+void *pipelineWorker(void *args)
+{
+    pipeline_worker *worker = (pipeline_worker *)args;
+    pipeline_stage *stage = worker->stage;
+    int64_t processed = 0, dropped = 0, busy_ns = 0, blocked_ns = 0;
+    uint64_t mallocs = mallocCount();
+
+    for (int64_t i = 0; stage->in != NULL || replay.count > 0 || i < pipeline.sales_per_worker; i++)
+    {
+        uint64_t pos;
+        sale_record sale;
+        if (stage->in == NULL && replay.count > 0)
+        {
+            // A venda gravada só existe depois da pausa de reprodução: sem reservar antes.
+            if (!stage->process(worker, &sale))
+            {
+                break;
+            }
+            int64_t start = monotonicNs();
+            *ringClaim(stage->out, &pos) = sale;
+            ringCommit(stage->out, pos);
+            blocked_ns += monotonicNs() - start;
+            processed++;
+            continue;
+        }
+        if (stage->in == NULL)
+        {
+            int64_t start = monotonicNs();
+            sale_record *slot = ringClaim(stage->out, &pos);
+            int64_t claimed = monotonicNs();
+            stage->process(worker, slot);
+            ringCommit(stage->out, pos);
+            blocked_ns += claimed - start;
+            busy_ns += monotonicNs() - claimed;
+            processed++;
+            continue;
+        }
+
+        const sale_record *input = ringPeek(stage->in, &pos);
+        if (input == NULL)
+        {
+            break;
+        }
+        sale = *input;
+        ringRelease(stage->in, pos);
+
+        int64_t start = monotonicNs();
+        int keep = stage->process(worker, &sale);
+        int64_t done = monotonicNs();
+        busy_ns += done - start;
+        processed++;
+        if (!keep)
+        {
+            dropped++;
+            continue;
+        }
+        if (stage->out != NULL)
+        {
+            sale_record *slot = ringClaim(stage->out, &pos);
+            *slot = sale;
+            ringCommit(stage->out, pos);
+            blocked_ns += monotonicNs() - done;
+        }
+    }
+
+    if (stage->finish != NULL)
+    {
+        stage->finish(worker);
+    }
+    atomic_fetch_add(&stage->processed, processed);
+    atomic_fetch_add(&stage->dropped, dropped);
+    atomic_fetch_add(&stage->busy_ns, busy_ns);
+    atomic_fetch_add(&stage->blocked_ns, blocked_ns);
+    mallocAccount(mallocs);
+    if (atomic_fetch_sub(&stage->running, 1) == 1)
+    {
+        if (stage->out != NULL)
+        {
+            ringClose(stage->out);
+        }
+        else
+        {
+            atomic_store(&pipeline.done, 1);
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @fn void *pipelineMonitor(void *args)
+ * @brief Amostra a profundidade do anel de entrada de cada estágio a cada milissegundo.
+ */
+void *pipelineMonitor(void *args)
+{
+    (void)args;
+    struct timespec period = {0, 1000000};
+    while (!atomic_load(&pipeline.done))
+    {
+        for (int i = 1; i < NUM_PIPELINE_STAGES; i++)
+        {
+            pipeline_stage *stage = &pipeline.stages[i];
+            int64_t depth = ringSize(stage->in);
+            stage->depth_sum += depth;
+            stage->depth_max = depth > stage->depth_max ? depth : stage->depth_max;
+        }
+        pipeline.samples++;
+        nanosleep(&period, NULL);
+    }
+    return NULL;
+}
+
+/**
+ * @fn static void pipelineRelease(sales_ring *rings[], int count)
+ * @brief Libera o que `runPipeline` já criou: os `count` primeiros anéis, a arena, o
+ * arquivo de saída e o mutex.
+ */
+static void pipelineRelease(sales_ring *rings[], int count)
+{
+    for (int i = 0; i < count; i++)
+    {
+        ringDestroy(rings[i]);
+    }
+    arenaDestroy();
+    close(pipeline.output_fd);
+    pthread_mutex_destroy(&pipeline.mutex);
+}
+
+/**
+ * @fn int runPipeline(void)
+ * @brief Executa o pipeline ingestão → validação → agregação → persistência.
+ *
+ * Cada estágio tem `config.pipeline_workers[i]` threads e os estágios são ligados por
+ * anéis de PIPELINE_CAPACITY posições com a estratégia de espera `config.strategy`. Ao fim,
+ * imprime por estágio a vazão, os descartes, a ocupação (tempo em `process` dividido pelo
+ * tempo total das threads), a profundidade média e máxima da fila de entrada e a espera
+ * por espaço na saída, e aponta o estágio mais ocupado como gargalo.
+ *
+ * @return 0 se todas as vendas geradas foram persistidas ou descartadas pela validação,
+ * 1 em caso de falha.
+ */
+int runPipeline(void)
+{
+    static const struct
+    {
+        const char *name;
+        int (*process)(pipeline_worker *worker, sale_record *sale);
+        void (*finish)(pipeline_worker *worker);
+    } kinds[NUM_PIPELINE_STAGES] = {
+        {"ingestão", ingestSale, NULL},
+        {"validação", validateSale, NULL},
+        {"agregação", aggregateSale, aggregateFinish},
+        {"persistência", persistSale, persistFinish},
+    };
+
+    memset(&pipeline, 0, sizeof(pipeline));
+    pipeline.sales_per_worker = config.bench_sales > 0 ? config.bench_sales : PIPELINE_SALES;
+    pipeline.output_fd = open(config.output_path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (pipeline.output_fd < 0)
+    {
+        perror("Erro ao abrir o arquivo de saída do pipeline");
+        return 1;
+    }
+    pthread_mutex_init(&pipeline.mutex, NULL);
+
+    int total_workers = 0;
+    sales_ring *rings[NUM_PIPELINE_STAGES - 1];
+    for (int i = 0; i < NUM_PIPELINE_STAGES - 1; i++)
+    {
+        rings[i] = ringCreate(PIPELINE_CAPACITY, config.strategy);
+        if (rings[i] == NULL)
+        {
+            perror("Erro ao alocar os anéis do pipeline");
+            pipelineRelease(rings, i);
+            return 1;
+        }
+    }
+    for (int i = 0; i < NUM_PIPELINE_STAGES; i++)
+    {
+        pipeline_stage *stage = &pipeline.stages[i];
+        stage->name = kinds[i].name;
+        stage->process = kinds[i].process;
+        stage->finish = kinds[i].finish;
+        stage->workers = config.pipeline_workers[i];
+        stage->in = i > 0 ? rings[i - 1] : NULL;
+        stage->out = i < NUM_PIPELINE_STAGES - 1 ? rings[i] : NULL;
+        atomic_init(&stage->running, stage->workers);
+        total_workers += stage->workers;
+    }
+
+    pipeline_worker *workers = NULL;
+    pthread_t *threads = NULL;
+    if (arenaCreate(total_workers * (sizeof(pipeline_worker) + sizeof(pthread_t)) + 2 * ARENA_ALIGN) == 0)
+    {
+        workers = arenaAlloc(total_workers * sizeof(pipeline_worker));
+        threads = arenaAlloc(total_workers * sizeof(pthread_t));
+    }
+    if (workers == NULL || threads == NULL)
+    {
+        perror("Erro ao alocar as threads do pipeline");
+        pipelineRelease(rings, NUM_PIPELINE_STAGES - 1);
+        return 1;
+    }
+
+    if (replay.count > 0)
+    {
+        printf("Pipeline: %" PRId64 " vendas reproduzidas de %s;", replay.count, config.replay_path);
+    }
+    else
+    {
+        printf("Pipeline: %d x %" PRId64 " vendas geradas;", config.pipeline_workers[0], pipeline.sales_per_worker);
+    }
+    printf(" threads por estágio: %d, %d, %d, %d; anéis de %d posições (%s)\n",
+           config.pipeline_workers[0], config.pipeline_workers[1], config.pipeline_workers[2], config.pipeline_workers[3], PIPELINE_CAPACITY,
+           wait_strategy_names[config.strategy]);
+
+    int64_t start = monotonicNs();
+    replayStart();
+    pthread_t monitor;
+    pthread_create(&monitor, NULL, pipelineMonitor, NULL);
+    for (int i = 0, t = 0; i < NUM_PIPELINE_STAGES; i++)
+    {
+        for (int w = 0; w < pipeline.stages[i].workers; w++, t++)
+        {
+            workers[t].stage = &pipeline.stages[i];
+            workers[t].index = w;
+            workers[t].rng = 0x9e3779b97f4a7c15ULL * (uint64_t)(w + 1);
+            pthread_create(&threads[t], NULL, pipelineWorker, &workers[t]);
+        }
+    }
+    for (int t = 0; t < total_workers; t++)
+    {
+        pthread_join(threads[t], NULL);
+    }
+    pthread_join(monitor, NULL);
+    double wall = (monotonicNs() - start) / 1e9;
+
+    int bottleneck = 0;
+    double worst = -1;
+    for (int i = 0; i < NUM_PIPELINE_STAGES; i++)
+    {
+        pipeline_stage *stage = &pipeline.stages[i];
+        double busy = atomic_load(&stage->busy_ns) / 1e9 / (stage->workers * wall);
+        printf("%-13s %2d threads | %10.0f vendas/s | %8" PRId64 " descartadas | ocupação %5.1f%% | ", stage->name,
+               stage->workers, atomic_load(&stage->processed) / wall, atomic_load(&stage->dropped), busy * 100);
+        if (stage->in != NULL)
+        {
+            printf("fila média %6.1f, máx %4" PRId64 " | ",
+                   pipeline.samples > 0 ? (double)stage->depth_sum / pipeline.samples : 0.0, stage->depth_max);
+        }
+        else
+        {
+            printf("%-24s | ", "fonte");
+        }
+        printf("espera na saída %7.3f s\n", atomic_load(&stage->blocked_ns) / 1e9);
+        if (busy > worst)
+        {
+            worst = busy;
+            bottleneck = i;
+        }
+    }
+
+    int64_t generated = atomic_load(&pipeline.stages[0].processed);
+    int64_t rejected = atomic_load(&pipeline.stages[1].dropped);
+    int64_t persisted = atomic_load(&pipeline.stages[NUM_PIPELINE_STAGES - 1].processed);
+    printf("Gargalo: %s | %" PRId64 " vendas persistidas em %s, latência média de ponta a ponta %.2f us\n",
+           pipeline.stages[bottleneck].name, persisted, config.output_path,
+           persisted > 0 ? pipeline.latency_ns / 1e3 / persisted : 0.0);
+    for (int i = 0; i < NUM_STORES; i++)
+    {
+        printf("     Loja %d: R$ %" PRId64 ".%02" PRId64 "\n", i + 1, pipeline.store_totals[i] / 100,
+               pipeline.store_totals[i] % 100);
+    }
+
+    printAllocStats("");
+
+    pipelineRelease(rings, NUM_PIPELINE_STAGES - 1);
+    return generated == persisted + rejected ? 0 : 1;
+}
+
+/**
+ * @struct wire_sale
+ * @brief Venda no protocolo binário do servidor de ingestão: 24 bytes, sem preenchimento,
+ * na ordem de bytes do host (os clientes são locais).
+ *
+ * Não há cabeçalho nem delimitador; uma conexão é uma sequência de `wire_sale`.
+ */
+typedef struct
+{
+    int64_t timestamp_ns; /**< Instante do envio em CLOCK_REALTIME, para medir a latência. */
+    int64_t amount_cents; /**< Valor em centavos. */
+    uint32_t register_id; /**< Caixa de origem. */
+    uint32_t sku;         /**< Código do produto. */
+} wire_sale;
+
+_Static_assert(sizeof(wire_sale) == 24, "wire_sale deve ter 24 bytes");
+
+/**
+ * @struct server_conn
+ * @brief Conexão aceita pelo servidor de ingestão e os bytes de uma venda incompleta.
+ *
+ * As conexões encerradas voltam a um pool da thread de ingestão (`next`), de onde são
+ * reaproveitadas pelas próximas: com clientes que conectam e desconectam o tempo todo, o
+ * buffer de SERVER_READ_BYTES não passa de novo pelo `malloc`.
+ */
+typedef struct server_conn
+{
+    struct server_conn *next;               /**< Próxima conexão livre do pool. */
+    int fd;                                 /**< Socket da conexão. */
+    size_t used;                            /**< Bytes em `buffer`. */
+    unsigned char buffer[SERVER_READ_BYTES]; /**< Dados lidos e ainda não convertidos. */
+} server_conn;
+
+/**
+ * @struct server_consumer
+ * @brief Resultados de um gerente do servidor de ingestão, somados ao final.
+ */
+typedef struct
+{
+    int index;                /**< Índice do gerente. */
+    int64_t received;         /**< Vendas lidas do anel. */
+    window_stats latency;     /**< Latências do envio pelo cliente até a leitura, em nanossegundos. */
+} server_consumer;
+
+/**
+ * @fn static int parseAddress(const char *spec, struct sockaddr_storage *addr, socklen_t *length)
+ * @brief Converte `unix:CAMINHO`, `tcp:PORTA` ou `tcp:IP:PORTA` (IPv4; padrão 127.0.0.1)
+ * em um endereço de socket.
+ *
+ * @return 0 em caso de sucesso, -1 se o endereço for inválido.
+ */
+static int parseAddress(const char *spec, struct sockaddr_storage *addr, socklen_t *length)
+{
+    memset(addr, 0, sizeof(*addr));
+    if (strncmp(spec, "unix:", 5) == 0)
+    {
+        struct sockaddr_un *un = (struct sockaddr_un *)addr;
+        if (strlen(spec + 5) == 0 || strlen(spec + 5) >= sizeof(un->sun_path))
+        {
+            return -1;
+        }
+        un->sun_family = AF_UNIX;
+        strcpy(un->sun_path, spec + 5);
+        *length = sizeof(*un);
+        return 0;
+    }
+    if (strncmp(spec, "tcp:", 4) == 0)
+    {
+        struct sockaddr_in *in = (struct sockaddr_in *)addr;
+        char host[64] = "127.0.0.1";
+        const char *port = strrchr(spec + 4, ':');
+        if (port != NULL)
+        {
+            size_t n = port - (spec + 4);
+            if (n >= sizeof(host))
+            {
+                return -1;
+            }
+            memcpy(host, spec + 4, n);
+            host[n] = '\0';
+            port++;
+        }
+        else
+        {
+            port = spec + 4;
+        }
+        long number = strtol(port, NULL, 10);
+        in->sin_family = AF_INET;
+        in->sin_port = htons((uint16_t)number);
+        *length = sizeof(*in);
+        return number > 0 && number < 65536 && inet_pton(AF_INET, host, &in->sin_addr) == 1 ? 0 : -1;
+    }
+    return -1;
+}
+
+/**
+ * @fn static int removeStaleSocket(const struct sockaddr_storage *addr, socklen_t length)
+ * @brief Prepara o caminho de um socket Unix para `bind`, apagando o socket deixado por uma
+ * execução anterior.
+ *
+ * O caminho só é apagado se for um socket sem ninguém escutando (o `connect` de teste é
+ * recusado); um servidor vivo ou um arquivo que não é socket ficam intactos. Endereços TCP
+ * não são tocados.
+ *
+ * @return 0 se o endereço pode ser usado, -1 (com `errno` em EADDRINUSE) se não pode.
+ */
+static int removeStaleSocket(const struct sockaddr_storage *addr, socklen_t length)
+{
+    if (addr->ss_family != AF_UNIX)
+    {
+        return 0;
+    }
+    const char *path = ((const struct sockaddr_un *)addr)->sun_path;
+    struct stat st;
+    if (lstat(path, &st) != 0)
+    {
+        return 0;
+    }
+    int probe = S_ISSOCK(st.st_mode) ? socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0) : -1;
+    int stale = probe >= 0 && connect(probe, (const struct sockaddr *)addr, length) != 0 && errno == ECONNREFUSED;
+    if (probe >= 0)
+    {
+        close(probe);
+    }
+    if (!stale)
+    {
+        errno = EADDRINUSE;
+        return -1;
+    }
+    unlink(path);
+    return 0;
+}
+
+/**
+ * @fn void *serverConsumer(void *args)
+ * @brief Gerente do servidor de ingestão: lê vendas do anel até ele ser fechado e
+ * esvaziado, registrando a latência desde o envio pelo cliente.
+ */
+void *serverConsumer(void *args)
+{
+    server_consumer *c = (server_consumer *)args;
+    uint64_t mallocs = mallocCount();
+    uint64_t pos;
+    const sale_record *sale;
+    while ((sale = ringPeek(ring, &pos)) != NULL)
+    {
+        windowAdd(&c->latency, realtimeNs() - sale->timestamp_ns);
+        analyticsAdd(c->index, sale->timestamp_ns, sale->amount_cents);
+        sinkAppend(c->index, sale);
+        ringRelease(ring, pos);
+        c->received++;
+    }
+    analyticsDone(c->index);
+    mallocAccount(mallocs);
+    return NULL;
+}
+
+/**
+ * @fn static int64_t serverEnqueue(server_conn *conn)
+ * @brief Converte as vendas completas do buffer da conexão e as publica no anel em lote.
+ *
+ * Cada venda é escrita direto na posição reservada; o lote inteiro é sinalizado aos
+ * gerentes com um único `ringSignal`, exceto quando o anel enche no meio do lote: aí o que
+ * já foi publicado é sinalizado antes de esperar por espaço. A venda incompleta do fim do
+ * buffer é movida para o início.
+ *
+ * @return Número de vendas publicadas.
+ */
+static int64_t serverEnqueue(server_conn *conn)
+{
+    size_t count = conn->used / sizeof(wire_sale);
+    unsigned int pending = 0;
+    for (size_t i = 0; i < count; i++)
+    {
+        wire_sale wire;
+        memcpy(&wire, conn->buffer + i * sizeof(wire_sale), sizeof(wire));
+
+        uint64_t pos;
+        sale_record *sale = ringTryClaim(ring, &pos);
+        if (sale == NULL)
+        {
+            ringSignal(ring, pending);
+            pending = 0;
+            sale = ringClaim(ring, &pos);
+        }
+        sale->timestamp_ns = wire.timestamp_ns;
+        sale->amount_cents = wire.amount_cents;
+        sale->register_id = wire.register_id;
+        sale->sku = wire.sku;
+        sale->store_id = wire.register_id > 0 ? storeOf((int)wire.register_id) : 0;
+        memset(sale->reserved, 0, sizeof(sale->reserved));
+        ringPublish(ring, pos);
+        pending++;
+    }
+    ringSignal(ring, pending);
+
+    size_t consumed = count * sizeof(wire_sale);
+    memmove(conn->buffer, conn->buffer + consumed, conn->used - consumed);
+    conn->used -= consumed;
+    return (int64_t)count;
+}
+
+/**
+ * @fn int runServer(void)
+ * @brief Servidor de ingestão: aceita conexões em `config.server_address` e publica no anel
+ * as vendas recebidas, consumidas por NUM_CONSUMERS gerentes.
+ *
+ * Uma única thread atende todas as conexões com epoll. A cada evento de leitura ela lê até
+ * SERVER_READ_BYTES do socket e publica todas as vendas completas em lote (`serverEnqueue`)
+ * num anel próprio de SERVER_CAPACITY vendas. Com o
+ * anel cheio, a thread espera, e a contrapressão chega aos clientes pelo próprio TCP. O
+ * servidor encerra com SIGINT ou SIGTERM, recebidos por um signalfd no mesmo epoll, ou,
+ * com `--conexoes K`, depois que K clientes se conectaram e desconectaram.
+ *
+ * @return 0 em caso de sucesso, 1 em caso de erro.
+ */
+int runServer(void)
+{
+    struct sockaddr_storage addr;
+    socklen_t length;
+    if (parseAddress(config.server_address, &addr, &length) != 0)
+    {
+        fprintf(stderr, "Endereço inválido: %s\n", config.server_address);
+        return 1;
+    }
+    if (removeStaleSocket(&addr, length) != 0)
+    {
+        perror("Erro ao abrir o servidor de ingestão");
+        return 1;
+    }
+    int listen_fd = socket(addr.ss_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    int one = 1;
+    setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    if (listen_fd < 0 || bind(listen_fd, (struct sockaddr *)&addr, length) != 0 || listen(listen_fd, 128) != 0)
+    {
+        perror("Erro ao abrir o servidor de ingestão");
+        return 1;
+    }
+
+    // Os sinais de término chegam pelo signalfd; as demais threads herdam o bloqueio.
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, NULL);
+    int signal_fd = signalfd(-1, &signals, SFD_NONBLOCK | SFD_CLOEXEC);
+    int epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    static int listen_tag, signal_tag;
+    struct epoll_event event = {.events = EPOLLIN, .data.ptr = &listen_tag};
+    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, listen_fd, &event);
+    event.data.ptr = &signal_tag;
+    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, signal_fd, &event);
+
+    ring = ringCreate(SERVER_CAPACITY, config.strategy);
+    if (ring == NULL || analyticsCreate(config.window_ns) != 0 ||
+        (config.sink_path != NULL && sinkOpen(config.sink_path) != 0))
+    {
+        perror("Erro ao alocar as filas de vendas");
+        return 1;
+    }
+    server_consumer *consumers = arenaCreate(NUM_CONSUMERS * (sizeof(server_consumer) + ARENA_ALIGN)) == 0
+                                     ? arenaAlloc(NUM_CONSUMERS * sizeof(server_consumer))
+                                     : NULL;
+    if (consumers == NULL)
+    {
+        perror("Erro ao alocar a arena da execução");
+        return 1;
+    }
+    pthread_t threads[NUM_CONSUMERS];
+    for (int i = 0; i < NUM_CONSUMERS; i++)
+    {
+        consumers[i].index = i;
+        windowReset(&consumers[i].latency);
+        pthread_create(&threads[i], NULL, serverConsumer, &consumers[i]);
+    }
+
+    printf("Servidor de ingestão em %s (%s), %d gerentes\n", config.server_address,
+           wait_strategy_names[config.strategy], NUM_CONSUMERS);
+    fflush(stdout);
+
+    int64_t received = 0, events = 0, accepted = 0, open_connections = 0, reused = 0;
+    int64_t start = 0;
+    server_conn *free_conns = NULL;
+    uint64_t mallocs = mallocCount();
+    int running = 1;
+    while (running)
+    {
+        struct epoll_event ready[SERVER_MAX_EVENTS];
+        int n = epoll_wait(epoll_fd, ready, SERVER_MAX_EVENTS, -1);
+        for (int e = 0; e < n; e++)
+        {
+            if (ready[e].data.ptr == &signal_tag)
+            {
+                running = 0;
+                continue;
+            }
+            if (ready[e].data.ptr == &listen_tag)
+            {
+                int fd;
+                while ((fd = accept4(listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0)
+                {
+                    server_conn *conn = free_conns;
+                    if (conn != NULL)
+                    {
+                        free_conns = conn->next;
+                        reused++;
+                    }
+                    else if ((conn = malloc(sizeof(server_conn))) == NULL)
+                    {
+                        close(fd);
+                        continue;
+                    }
+                    conn->fd = fd;
+                    conn->used = 0;
+                    struct epoll_event conn_event = {.events = EPOLLIN | EPOLLRDHUP, .data.ptr = conn};
+                    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &conn_event);
+                    start = accepted++ == 0 ? monotonicNs() : start;
+                    open_connections++;
+                }
+                continue;
+            }
+
+            // Uma leitura por evento: o epoll é por nível e volta a esta conexão se ainda
+            // houver dados, sem que um cliente rápido monopolize a thread.
+            server_conn *conn = ready[e].data.ptr;
+            ssize_t bytes = read(conn->fd, conn->buffer + conn->used, SERVER_READ_BYTES - conn->used);
+            if (bytes > 0)
+            {
+                conn->used += (size_t)bytes;
+                received += serverEnqueue(conn);
+                events++;
+            }
+            else if (bytes == 0 || (errno != EAGAIN && errno != EINTR))
+            {
+                epoll_ctl(epoll_fd, EPOLL_CTL_DEL, conn->fd, NULL);
+                close(conn->fd);
+                conn->next = free_conns;
+                free_conns = conn;
+                open_connections--;
+                running = !(config.connections > 0 && accepted >= config.connections && open_connections == 0);
+            }
+        }
+    }
+    double wall = start > 0 ? (monotonicNs() - start) / 1e9 : 0.0;
+    mallocAccount(mallocs);
+
+    ringClose(ring);
+    window_stats *latency = &consumers[0].latency;
+    int64_t consumed = 0;
+    for (int i = 0; i < NUM_CONSUMERS; i++)
+    {
+        pthread_join(threads[i], NULL);
+        consumed += consumers[i].received;
+        if (i > 0)
+        {
+            windowMerge(latency, &consumers[i].latency);
+        }
+    }
+    int sink_failed = sinkClose() != 0;
+
+    printf("Servidor: %" PRId64 " vendas de %" PRId64 " conexões em %.3f s (%.0f vendas/s), %.1f vendas por evento "
+           "de leitura | latência média %.2f us, p50 %.2f us, p99 %.2f us\n",
+           received, accepted, wall, wall > 0 ? received / wall : 0.0, events > 0 ? (double)received / events : 0.0,
+           latency->count > 0 ? latency->mean / 1e3 : 0.0,
+           latency->count > 0 ? windowQuantile(latency, 0.5) / 1e3 : 0.0,
+           latency->count > 0 ? windowQuantile(latency, 0.99) / 1e3 : 0.0);
+    if (config.window_ns > 0)
+    {
+        printAnalyticsStats();
+    }
+    if (config.sink_path != NULL)
+    {
+        printSinkStats();
+    }
+    printf("Conexões: %" PRId64 " de %" PRId64 " reaproveitadas do pool\n", reused, accepted);
+    printAllocStats("");
+
+    while (free_conns != NULL)
+    {
+        server_conn *next = free_conns->next;
+        free(free_conns);
+        free_conns = next;
+    }
+    arenaDestroy();
+    analyticsDestroy();
+    ringDestroy(ring);
+    close(epoll_fd);
+    close(signal_fd);
+    close(listen_fd);
+    if (addr.ss_family == AF_UNIX)
+    {
+        unlink(((struct sockaddr_un *)&addr)->sun_path);
+    }
+    return consumed == received && !sink_failed ? 0 : 1;
+}
+
+/**
+ * @fn void *clientThread(void *args)
+ * @brief Conexão do cliente de carga: envia `num_sales` vendas em lotes de CLIENT_BATCH por
+ * `write`, pausando `config.bench_gap_ns` entre lotes.
+ *
+ * @return NULL; `num_sales` é zerado se a conexão falhar.
+ */
+void *clientThread(void *args)
+{
+    producer_args *p_args = (producer_args *)args;
+    struct sockaddr_storage addr;
+    socklen_t length;
+    parseAddress(config.client_address, &addr, &length);
+    int fd = socket(addr.ss_family, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0 || connect(fd, (struct sockaddr *)&addr, length) != 0)
+    {
+        perror("Erro ao conectar ao servidor de ingestão");
+        p_args->num_sales = 0;
+        if (fd >= 0)
+        {
+            close(fd);
+        }
+        return NULL;
+    }
+    if (addr.ss_family == AF_INET)
+    {
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    }
+
+    struct timespec gap = {config.bench_gap_ns / 1000000000LL, config.bench_gap_ns % 1000000000LL};
+    wire_sale batch[CLIENT_BATCH];
+    for (int sent = 0; sent < p_args->num_sales;)
+    {
+        int n = p_args->num_sales - sent < CLIENT_BATCH ? p_args->num_sales - sent : CLIENT_BATCH;
+        int64_t now = realtimeNs();
+        for (int i = 0; i < n; i++)
+        {
+            batch[i].timestamp_ns = now;
+            batch[i].amount_cents = 100 + (sent + i) % 100000;
+            batch[i].register_id = (uint32_t)p_args->thread_id;
+            batch[i].sku = (uint32_t)(sent + i);
+        }
+        const char *p = (const char *)batch;
+        size_t left = n * sizeof(wire_sale);
+        while (left > 0)
+        {
+            ssize_t written = write(fd, p, left);
+            if (written < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            if (written < 0)
+            {
+                perror("Erro ao enviar vendas");
+                p_args->num_sales = sent;
+                close(fd);
+                return NULL;
+            }
+            p += written;
+            left -= (size_t)written;
+        }
+        sent += n;
+        if (config.bench_gap_ns > 0)
+        {
+            nanosleep(&gap, NULL);
+        }
+    }
+    close(fd);
+    return NULL;
+}
+
+/**
+ * @fn int runClient(void)
+ * @brief Cliente de carga: abre `config.connections` conexões (padrão NUM_PRODUCERS) com o
+ * servidor de ingestão, cada uma enviando `config.bench_sales` vendas de um caixa.
+ *
+ * @return 0 se todas as vendas foram enviadas, 1 caso contrário.
+ */
+int runClient(void)
+{
+    struct sockaddr_storage addr;
+    socklen_t length;
+    if (parseAddress(config.client_address, &addr, &length) != 0)
+    {
+        fprintf(stderr, "Endereço inválido: %s\n", config.client_address);
+        return 1;
+    }
+    int connections = config.connections > 0 ? config.connections : NUM_PRODUCERS;
+    long long per_connection = config.bench_sales > 0 ? config.bench_sales : PIPELINE_SALES;
+    pthread_t *threads = NULL;
+    producer_args *args = NULL;
+    if (arenaCreate(connections * (sizeof(pthread_t) + sizeof(producer_args)) + 2 * ARENA_ALIGN) == 0)
+    {
+        threads = arenaAlloc(connections * sizeof(pthread_t));
+        args = arenaAlloc(connections * sizeof(producer_args));
+    }
+    if (threads == NULL || args == NULL)
+    {
+        perror("Erro ao alocar a arena da execução");
+        return 1;
+    }
+
+    int64_t start = monotonicNs();
+    for (int i = 0; i < connections; i++)
+    {
+        args[i].thread_id = i % NUM_PRODUCERS + 1;
+        args[i].num_sales = (int)per_connection;
+        pthread_create(&threads[i], NULL, clientThread, &args[i]);
+    }
+    long long sent = 0;
+    for (int i = 0; i < connections; i++)
+    {
+        pthread_join(threads[i], NULL);
+        sent += args[i].num_sales;
+    }
+    double wall = (monotonicNs() - start) / 1e9;
+
+    printf("Cliente: %lld vendas enviadas por %d conexões em %.3f s (%.0f vendas/s)\n", sent, connections, wall,
+           sent / wall);
+    arenaDestroy();
+    return sent == per_connection * connections ? 0 : 1;
+}
+
+/**
+ * @struct service_worker
+ * @brief Caixa ou gerente do modo serviço, com os contadores que o autoescalador lê.
+ *
+ * Só a thread escreve os contadores (com armazenamentos relaxados, sem disputa); a thread
+ * de controle os lê a cada período e guarda em `seen_*` o que já contabilizou. Cada
+ * trabalhador ocupa suas próprias linhas de cache.
+ */
+typedef struct
+{
+    _Alignas(64) _Atomic int stop; /**< Pedido de parada, escrito pela thread de controle. */
+    int index;                     /**< Posição no pool; o caixa é `index + 1`. */
+    pthread_t thread;              /**< Thread em execução nesta posição. */
+    _Atomic int64_t sales;         /**< Vendas publicadas (caixa) ou processadas (gerente). */
+    _Atomic int64_t busy_ns;       /**< Tempo do gerente processando vendas. */
+    _Atomic int64_t latency_ns;    /**< Soma das latências da venda até o gerente. */
+    int64_t seen_sales;            /**< `sales` na última medição. */
+    int64_t seen_busy_ns;          /**< `busy_ns` na última medição. */
+    int64_t seen_latency_ns;       /**< `latency_ns` na última medição. */
+} service_worker;
+
+/**
+ * @struct service_pool
+ * @brief Threads de um papel do modo serviço.
+ *
+ * As posições 0 a `count - 1` estão em execução; acrescentar usa a posição `count` e
+ * retirar para a última. As posições vêm da arena da execução, de modo que iniciar e parar
+ * threads em regime não chama `malloc`.
+ */
+typedef struct
+{
+    const char *name;          /**< Nome do papel nas mensagens e nos comandos. */
+    void *(*run)(void *args);  /**< Função das threads. */
+    service_worker *workers;   /**< SERVICE_MAX_THREADS posições. */
+    int count;                 /**< Threads em execução. */
+    int minimum;               /**< Menor número de threads permitido. */
+    int peak;                  /**< Maior número de threads já em execução. */
+    int64_t retired_sales;     /**< Vendas das threads já retiradas. */
+} service_pool;
+
+/**
+ * @struct control_conn
+ * @brief Conexão no socket de controle e a linha de comando ainda incompleta.
+ */
+typedef struct
+{
+    int fd;          /**< Socket, ou -1 se a posição está livre. */
+    size_t used;     /**< Bytes em `line`. */
+    char line[256];  /**< Comando em leitura, até o `\n`. */
+} control_conn;
+
+/**
+ * @struct sales_service
+ * @brief Estado do modo serviço: os pools, as medições do último período e o autoescalador.
+ */
+typedef struct
+{
+    service_pool registers;                   /**< Caixas. */
+    service_pool managers;                    /**< Gerentes. */
+    control_conn control[SERVICE_MAX_CONTROL]; /**< Conexões de controle. */
+    int64_t depth;                            /**< Profundidade da fila na última medição. */
+    double produced_rate;                     /**< Vendas publicadas por segundo no último período. */
+    double consumed_rate;                     /**< Vendas processadas por segundo no último período. */
+    double latency_ns;                        /**< Latência média do último período. */
+    double utilization;                       /**< Ocupação média dos gerentes no último período. */
+    int idle_ticks;                           /**< Períodos seguidos de gerentes ociosos. */
+    int cooldown;                             /**< Períodos até a próxima decisão do autoescalador. */
+    int64_t scale_ups;                        /**< Gerentes acrescentados pelo autoescalador. */
+    int64_t scale_downs;                      /**< Gerentes retirados pelo autoescalador. */
+} sales_service;
+
+sales_service service;
+
+/**
+ * @fn void *serviceProducer(void *args)
+ * @brief Caixa do modo serviço: publica vendas sem fim, com `config.bench_gap_ns` entre
+ * elas, até receber o pedido de parada ou o anel ser fechado.
+ */
+void *serviceProducer(void *args)
+{
+    service_worker *w = (service_worker *)args;
+    struct timespec gap = {config.bench_gap_ns / 1000000000LL, config.bench_gap_ns % 1000000000LL};
+    uint64_t mallocs = mallocCount();
+    int64_t sales = 0;
+    while (!atomic_load_explicit(&w->stop, memory_order_relaxed))
+    {
+        int64_t amount_cents = rand() % 100000 + 100;
+        uint64_t pos;
+        struct timespec deadline = deadlineAfter(SERVICE_POLL_NS);
+        sale_record *sale = ringClaimUntil(ring, &pos, &deadline);
+        if (sale == NULL && errno == EPIPE)
+        {
+            break;
+        }
+        if (sale == NULL)
+        {
+            continue;
+        }
+        fillSale(sale, w->index + 1, amount_cents);
+        ringCommit(ring, pos);
+        atomic_store_explicit(&w->sales, ++sales, memory_order_relaxed);
+        if (config.bench_gap_ns > 0)
+        {
+            nanosleep(&gap, NULL);
+        }
+    }
+    mallocAccount(mallocs);
+    return NULL;
+}
+
+/**
+ * @fn void *serviceConsumer(void *args)
+ * @brief Gerente do modo serviço: processa vendas até receber o pedido de parada ou, no
+ * encerramento, até o anel ser fechado e esvaziado.
+ *
+ * O processamento de cada venda custa `config.service_work_ns` de espera ativa, simulando
+ * a validação e o enriquecimento do fluxo real; é esse custo que faz a fila crescer e o
+ * autoescalador agir. Um gerente retirado deixa as vendas restantes para os outros.
+ */
+void *serviceConsumer(void *args)
+{
+    service_worker *w = (service_worker *)args;
+    uint64_t mallocs = mallocCount();
+    int64_t sales = 0, busy_ns = 0, latency_ns = 0;
+    while (!atomic_load_explicit(&w->stop, memory_order_relaxed))
+    {
+        uint64_t pos;
+        struct timespec deadline = deadlineAfter(SERVICE_POLL_NS);
+        const sale_record *sale = ringPeekUntil(ring, &pos, &deadline);
+        if (sale == NULL && errno == ETIMEDOUT)
+        {
+            continue;
+        }
+        if (sale == NULL)
+        {
+            break;
+        }
+
+        int64_t start = monotonicNs();
+        latency_ns += realtimeNs() - sale->timestamp_ns;
+        ringRelease(ring, pos);
+        while (monotonicNs() - start < config.service_work_ns)
+        {
+            cpuRelax();
+        }
+        busy_ns += monotonicNs() - start;
+        atomic_store_explicit(&w->busy_ns, busy_ns, memory_order_relaxed);
+        atomic_store_explicit(&w->latency_ns, latency_ns, memory_order_relaxed);
+        atomic_store_explicit(&w->sales, ++sales, memory_order_relaxed);
+    }
+    mallocAccount(mallocs);
+    return NULL;
+}
+
+/**
+ * @fn static int serviceResize(service_pool *pool, int target)
+ * @brief Inicia ou para threads de `pool` até haver `target` em execução, limitado a
+ * `pool->minimum` e SERVICE_MAX_THREADS.
+ *
+ * Parar é pedir a parada à última thread e esperar por ela, o que leva no máximo
+ * SERVICE_POLL_NS mais o processamento de uma venda.
+ *
+ * @return O número de threads em execução.
+ */
+static int serviceResize(service_pool *pool, int target)
+{
+    target = target < pool->minimum ? pool->minimum : target > SERVICE_MAX_THREADS ? SERVICE_MAX_THREADS : target;
+    while (pool->count < target)
+    {
+        service_worker *w = &pool->workers[pool->count];
+        atomic_store(&w->stop, 0);
+        atomic_store(&w->sales, 0);
+        atomic_store(&w->busy_ns, 0);
+        atomic_store(&w->latency_ns, 0);
+        w->seen_sales = w->seen_busy_ns = w->seen_latency_ns = 0;
+        w->index = pool->count;
+        if (pthread_create(&w->thread, NULL, pool->run, w) != 0)
+        {
+            break;
+        }
+        pool->count++;
+    }
+    while (pool->count > target)
+    {
+        service_worker *w = &pool->workers[pool->count - 1];
+        atomic_store(&w->stop, 1);
+        pthread_join(w->thread, NULL);
+        pool->retired_sales += atomic_load(&w->sales);
+        pool->count--;
+    }
+    pool->peak = pool->count > pool->peak ? pool->count : pool->peak;
+    return pool->count;
+}
 
 /**
- * @struct producer_args
- * @brief Estrutura para encapsular os argumentos a serem passados para cada thread produtora.
+ * @fn static int64_t serviceTotal(const service_pool *pool)
+ * @brief Vendas de todas as threads de `pool`, em execução ou já retiradas.
  */
-typedef struct
+static int64_t serviceTotal(const service_pool *pool)
 {
-    int thread_id;
-    int num_sales;
-} producer_args;
+    int64_t total = pool->retired_sales;
+    for (int i = 0; i < pool->count; i++)
+    {
+        total += atomic_load_explicit(&pool->workers[i].sales, memory_order_relaxed);
+    }
+    return total;
+}
 
 /**
- * @struct consumer_args
- * @brief Estrutura para encapsular os argumentos a serem passados para cada thread consumidora.
+ * @fn static void serviceTick(int64_t elapsed_ns)
+ * @brief Mede o último período e, com `config.autoscale`, ajusta o número de gerentes.
+ *
+ * Um gerente é acrescentado quando a fila passa de `config.scale_depth` vendas ou a
+ * latência média passa de `config.scale_latency_ns`, até `config.scale_max`: como o custo
+ * das vendas é de CPU, gerentes além do número de processadores só disputariam os mesmos
+ * núcleos sem esvaziar a fila. Um é retirado depois de
+ * SCALE_IDLE_TICKS períodos seguidos sem pressão e com ocupação média abaixo de
+ * SCALE_IDLE_UTILIZATION. Depois de cada mudança, SCALE_COOLDOWN_TICKS períodos sem nova
+ * decisão dão tempo para a fila refletir a nova escala.
  */
-typedef struct
+static void serviceTick(int64_t elapsed_ns)
 {
-    int thread_id;
-} consumer_args;
+    int64_t produced = 0, consumed = 0, busy_ns = 0, latency_ns = 0;
+    for (int i = 0; i < service.registers.count; i++)
+    {
+        service_worker *w = &service.registers.workers[i];
+        int64_t sales = atomic_load_explicit(&w->sales, memory_order_relaxed);
+        produced += sales - w->seen_sales;
+        w->seen_sales = sales;
+    }
+    for (int i = 0; i < service.managers.count; i++)
+    {
+        service_worker *w = &service.managers.workers[i];
+        int64_t sales = atomic_load_explicit(&w->sales, memory_order_relaxed);
+        int64_t busy = atomic_load_explicit(&w->busy_ns, memory_order_relaxed);
+        int64_t latency = atomic_load_explicit(&w->latency_ns, memory_order_relaxed);
+        consumed += sales - w->seen_sales;
+        busy_ns += busy - w->seen_busy_ns;
+        latency_ns += latency - w->seen_latency_ns;
+        w->seen_sales = sales;
+        w->seen_busy_ns = busy;
+        w->seen_latency_ns = latency;
+    }
 
-double buffer[BUFFER_SIZE];
-int count = 0;
-int in_idx = 0;
-int out_idx = 0;
+    service.depth = ringSize(ring);
+    service.produced_rate = produced * 1e9 / elapsed_ns;
+    service.consumed_rate = consumed * 1e9 / elapsed_ns;
+    service.latency_ns = consumed > 0 ? (double)latency_ns / consumed : 0.0;
+    service.utilization = (double)busy_ns / ((double)elapsed_ns * service.managers.count);
 
-pthread_mutex_t mutex;
-sem_t empty_slots;
-sem_t full_slots;
-pthread_cond_t buffer_empty_cond; // Usada para garantir o término correto
+    if (!config.autoscale)
+    {
+        return;
+    }
+    int pressure = service.depth >= config.scale_depth || service.latency_ns >= config.scale_latency_ns;
+    service.idle_ticks = !pressure && service.utilization < SCALE_IDLE_UTILIZATION ? service.idle_ticks + 1 : 0;
+    if (service.cooldown > 0)
+    {
+        service.cooldown--;
+        return;
+    }
 
-// Volatile para garantir que a leitura mais recente seja usada por todas as threads
-volatile int active_producers = NUM_PRODUCERS;
+    int before = service.managers.count;
+    if (pressure && before < config.scale_max)
+    {
+        serviceResize(&service.managers, before + 1);
+    }
+    else if (service.idle_ticks >= SCALE_IDLE_TICKS)
+    {
+        serviceResize(&service.managers, before - 1);
+    }
+    if (service.managers.count != before)
+    {
+        service.scale_ups += service.managers.count > before;
+        service.scale_downs += service.managers.count < before;
+        service.idle_ticks = 0;
+        service.cooldown = SCALE_COOLDOWN_TICKS;
+        printf(">>>> Autoescala: %d -> %d gerentes (fila %" PRId64 ", latência %.0f us, ocupação %.0f%%) <<<<\n",
+               before, service.managers.count, service.depth, service.latency_ns / 1e3, service.utilization * 100);
+        fflush(stdout);
+    }
+}
 
 /**
- * @fn void *producer(void *args)
- * @brief Função executada pelas threads produtoras.
- *
- * Cada produtor gera um número pré-definido de vendas (itens). Para cada venda,
- * ele aguarda um espaço livre no buffer (`sem_wait(&empty_slots)`), adquire o
- * bloqueio do mutex, insere o item, atualiza os contadores e libera o mutex.
- * Por fim, sinaliza que um novo item está disponível para consumo (`sem_post(&full_slots)`).
- * Ao final de sua produção, decrementa o contador `active_producers` e, se for o
- * último produtor, acorda as threads consumidoras para que possam encerrar.
+ * @fn static int serviceState(char *out, size_t size)
+ * @brief Escreve em `out` a linha de estado do serviço.
  *
- * @param args Ponteiro para uma estrutura `producer_args` contendo o ID da thread e o número de vendas a produzir.
- * @return NULL.
+ * @return O número de caracteres escritos, como `snprintf`.
  */
-void *producer(void *args)
+static int serviceState(char *out, size_t size)
 {
-    producer_args *p_args = (producer_args *)args;
-    int tid = p_args->thread_id;
-    int sales_to_produce = p_args->num_sales;
+    int n = snprintf(out, size,
+                     "caixas %d | gerentes %d | fila %" PRId64 "/%d | %.0f vendas/s publicadas, %.0f processadas | "
+                     "latência %.0f us | ocupação %.0f%%\n",
+                     service.registers.count, service.managers.count, service.depth, SERVICE_CAPACITY,
+                     service.produced_rate, service.consumed_rate, service.latency_ns / 1e3,
+                     service.utilization * 100);
+    return n < (int)size ? n : (int)size - 1;
+}
 
-    for (size_t i = 0; i < sales_to_produce; i++)
+/**
+ * @fn static int serviceCommand(char *line, char *reply, size_t size)
+ * @brief Executa um comando do socket de controle e escreve a resposta em `reply`.
+ *
+ * Comandos: `estado`; `caixas N`, `caixas +N` ou `caixas -N` (e o mesmo para `gerentes`),
+ * que fixam, acrescentam ou retiram threads; `parar`, que encerra o serviço.
+ *
+ * @return 1 se o serviço deve encerrar, 0 caso contrário.
+ */
+static int serviceCommand(char *line, char *reply, size_t size)
+{
+    char *end = line + strcspn(line, "\r\n");
+    *end = '\0';
+    char *arg = strchr(line, ' ');
+    if (arg != NULL)
     {
-        double sale_value = (rand() % 100000) / 100.0 + 1.0;
-
-        sem_wait(&empty_slots); // Espera por um slot vazio
-
-        pthread_mutex_lock(&mutex);
-        buffer[in_idx] = sale_value;
-        in_idx = (in_idx + 1) % BUFFER_SIZE;
-        count++;
-        printf("(P) TID %d | VENDA: R$ %.2f | Buffer: %d/%d\n",
-               tid, sale_value, count, BUFFER_SIZE);
-        pthread_mutex_unlock(&mutex);
+        *arg++ = '\0';
+    }
 
-        sem_post(&full_slots); // Sinaliza que um slot foi preenchido
+    service_pool *pool = strcmp(line, service.registers.name) == 0  ? &service.registers
+                         : strcmp(line, service.managers.name) == 0 ? &service.managers
+                                                                    : NULL;
+    if (pool != NULL && arg != NULL)
+    {
+        char *number_end;
+        long n = strtol(arg, &number_end, 10);
+        if (number_end != arg && *number_end == '\0')
+        {
+            int before = pool->count;
+            serviceResize(pool, (int)(*arg == '+' || *arg == '-' ? before + n : n));
+            printf(">>>> Controle: %d -> %d %s <<<<\n", before, pool->count, pool->name);
+            fflush(stdout);
+            serviceState(reply, size);
+            return 0;
+        }
+    }
+    if (strcmp(line, "estado") == 0)
+    {
+        serviceState(reply, size);
+        return 0;
+    }
+    if (strcmp(line, "parar") == 0)
+    {
+        snprintf(reply, size, "encerrando\n");
+        return 1;
+    }
+    snprintf(reply, size, "erro: use estado, caixas [+|-]N, gerentes [+|-]N ou parar\n");
+    return 0;
+}
 
-        sleep((rand() % 3) + 1); // Pausa menor para aumentar a concorrência
+/**
+ * @fn static int serviceControl(control_conn *conn)
+ * @brief Lê do socket de controle e executa os comandos completos da conexão.
+ *
+ * @return 1 se algum comando pediu o encerramento, 0 se a conexão continua, -1 se ela
+ * foi fechada.
+ */
+static int serviceControl(control_conn *conn)
+{
+    ssize_t bytes = read(conn->fd, conn->line + conn->used, sizeof(conn->line) - 1 - conn->used);
+    if (bytes == 0 || (bytes < 0 && errno != EAGAIN && errno != EINTR))
+    {
+        return -1;
+    }
+    if (bytes < 0)
+    {
+        return 0;
     }
+    conn->used += (size_t)bytes;
+    conn->line[conn->used] = '\0';
 
-    // No final do producer
-    pthread_mutex_lock(&mutex);
-    active_producers--;
-    printf(">>>> (P) Caixa %d finalizou. Produtores ativos: %d <<<<\n", tid, active_producers);
-    if (active_producers == 0)
+    int stop = 0;
+    char *newline;
+    while ((newline = strchr(conn->line, '\n')) != NULL)
     {
-        // Acorda TODOS os consumidores que possam estar esperando no sem_wait.
-        // Eles irão acordar, verificar a condição de término e sair.
-        for (int i = 0; i < NUM_CONSUMERS; i++)
+        *newline = '\0';
+        char reply[256];
+        stop |= serviceCommand(conn->line, reply, sizeof(reply));
+        if (write(conn->fd, reply, strlen(reply)) < 0)
         {
-            sem_post(&full_slots);
+            return -1;
         }
+        size_t consumed = (size_t)(newline + 1 - conn->line);
+        memmove(conn->line, newline + 1, conn->used - consumed + 1);
+        conn->used -= consumed;
     }
-    pthread_mutex_unlock(&mutex);
-
-    free(p_args);
-    pthread_exit(NULL);
+    // Uma linha que não cabe no buffer não é um comando válido: descarta a conexão.
+    return conn->used == sizeof(conn->line) - 1 ? -1 : stop;
 }
 
 /**
- * @fn void *consumer(void *args)
- * @brief Função executada pelas threads consumidoras.
+ * @fn int runService(void)
+ * @brief Modo serviço: caixas e gerentes rodam sem fim sobre um anel de SERVICE_CAPACITY
+ * vendas, e o número de threads de cada papel muda em tempo de execução.
  *
- * Cada consumidor opera em um loop infinito, tentando processar vendas. Ele aguarda
- * até que um item esteja disponível no buffer (`sem_wait(&full_slots)`). Após ser
- * acordado, ele verifica a condição de término: se não há mais produtores ativos e
- * o buffer está vazio. Se a condição for verdadeira, ele encerra. Caso contrário,
- * ele adquire o bloqueio do mutex, consome um item do buffer, atualiza os contadores,
- * libera o mutex e sinaliza que um espaço no buffer foi liberado (`sem_post(&empty_slots)`).
+ * A thread principal atende com epoll o socket de controle (`config.service_address`, ver
+ * `serviceCommand`), um signalfd e um timerfd de SERVICE_TICK_NS. SIGUSR1 acrescenta um
+ * caixa e SIGUSR2 retira um; SIGINT e SIGTERM encerram. A cada período o serviço mede a
+ * fila e a vazão e, com `--autoescala`, ajusta os gerentes (`serviceTick`); a cada
+ * SERVICE_REPORT_TICKS períodos imprime uma linha de estado. No encerramento os caixas
+ * param primeiro e o anel é fechado, de modo que os gerentes processam tudo o que foi
+ * publicado antes de terminar.
  *
- * @param args Ponteiro para uma estrutura `consumer_args` contendo o ID da thread.
- * @return NULL.
+ * Em regime, sem mudanças de escala, nenhuma thread chama `malloc`; acrescentar uma thread
+ * passa pelas alocações internas de `pthread_create` na thread de controle, que entram na
+ * contagem de `printAllocStats` quando ela está ligada (COUNT_MALLOC).
+ *
+ * @return 0 se todas as vendas publicadas foram processadas, 1 caso contrário.
  */
-void *consumer(void *args)
+int runService(void)
 {
-    consumer_args *c_args = (consumer_args *)args;
-    int tid = c_args->thread_id;
-    int sales_processed = 0;
+    struct sockaddr_storage addr;
+    socklen_t length;
+    if (parseAddress(config.service_address, &addr, &length) != 0)
+    {
+        fprintf(stderr, "Endereço inválido: %s\n", config.service_address);
+        return 1;
+    }
+    if (removeStaleSocket(&addr, length) != 0)
+    {
+        perror("Erro ao abrir o socket de controle");
+        return 1;
+    }
+    int listen_fd = socket(addr.ss_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    int one = 1;
+    setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    if (listen_fd < 0 || bind(listen_fd, (struct sockaddr *)&addr, length) != 0 || listen(listen_fd, 16) != 0)
+    {
+        perror("Erro ao abrir o socket de controle");
+        return 1;
+    }
 
-    while (1)
+    // Bloqueados antes de criar as threads, que herdam a máscara; chegam pelo signalfd.
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    sigaddset(&signals, SIGUSR1);
+    sigaddset(&signals, SIGUSR2);
+    pthread_sigmask(SIG_BLOCK, &signals, NULL);
+    int signal_fd = signalfd(-1, &signals, SFD_NONBLOCK | SFD_CLOEXEC);
+    int timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    struct itimerspec period = {{0, SERVICE_TICK_NS}, {0, SERVICE_TICK_NS}};
+    timerfd_settime(timer_fd, 0, &period, NULL);
+    int epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    static int listen_tag, signal_tag, timer_tag;
+    struct epoll_event event = {.events = EPOLLIN, .data.ptr = &listen_tag};
+    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, listen_fd, &event);
+    event.data.ptr = &signal_tag;
+    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, signal_fd, &event);
+    event.data.ptr = &timer_tag;
+    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, timer_fd, &event);
+
+    ring = ringCreate(SERVICE_CAPACITY, config.strategy);
+    service_worker *workers = NULL;
+    if (arenaCreate(2 * SERVICE_MAX_THREADS * sizeof(service_worker) + ARENA_ALIGN) == 0)
     {
-        // Espera por um item. Este é o ponto de bloqueio.
-        sem_wait(&full_slots);
+        workers = arenaAlloc(2 * SERVICE_MAX_THREADS * sizeof(service_worker));
+    }
+    if (ring == NULL || workers == NULL)
+    {
+        perror("Erro ao alocar as filas de vendas");
+        return 1;
+    }
+    service.registers = (service_pool){"caixas", serviceProducer, workers, 0, 0, 0, 0};
+    service.managers = (service_pool){"gerentes", serviceConsumer, workers + SERVICE_MAX_THREADS, 0, 1, 0, 0};
+    for (int i = 0; i < SERVICE_MAX_CONTROL; i++)
+    {
+        service.control[i].fd = -1;
+    }
+    if (config.scale_max == 0)
+    {
+        // Nunca abaixo dos gerentes iniciais, senão o autoescalador não cresce com poucas CPUs.
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        config.scale_max = cpus < NUM_CONSUMERS         ? NUM_CONSUMERS
+                           : cpus > SERVICE_MAX_THREADS ? SERVICE_MAX_THREADS
+                                                        : (int)cpus;
+    }
+    serviceResize(&service.managers, NUM_CONSUMERS);
+    serviceResize(&service.registers, NUM_PRODUCERS);
 
-        // Após acordar, a primeira coisa é verificar se devemos terminar.
-        // Bloqueamos o mutex para ler 'count' e 'active_producers' de forma segura.
-        pthread_mutex_lock(&mutex);
-        if (active_producers == 0 && count == 0)
-        {
-            // Não há mais produtores e o buffer está vazio. O trabalho acabou.
-            // Precisamos liberar o mutex antes de sair.
-            pthread_mutex_unlock(&mutex);
+    printf("Serviço em %s (%s): %d caixas, %d gerentes, custo de %lld ns por venda, autoescala %s\n",
+           config.service_address, wait_strategy_names[config.strategy], service.registers.count,
+           service.managers.count, config.service_work_ns, config.autoscale ? "ligada" : "desligada");
+    if (config.autoscale)
+    {
+        printf("Autoescala: cresce com fila >= %lld ou latência >= %lld us, até %d gerentes; encolhe com ocupação "
+               "< %.0f%% por %d períodos de %lld ms\n",
+               config.scale_depth, config.scale_latency_ns / 1000, config.scale_max, SCALE_IDLE_UTILIZATION * 100,
+               SCALE_IDLE_TICKS, SERVICE_TICK_NS / 1000000);
+    }
+    fflush(stdout);
 
-            // Como consumimos um 'sem_wait' para entrar aqui,
-            // mas não vamos consumir um item, precisamos devolver o "ticket"
-            // para que outra thread consumidora também possa sair.
-            sem_post(&full_slots);
+    int64_t start = monotonicNs(), last_tick = start, ticks = 0;
+    uint64_t mallocs = mallocCount();
+    int running = 1;
+    while (running)
+    {
+        struct epoll_event ready[SERVER_MAX_EVENTS];
+        int n = epoll_wait(epoll_fd, ready, SERVER_MAX_EVENTS, -1);
+        for (int e = 0; e < n && running; e++)
+        {
+            if (ready[e].data.ptr == &signal_tag)
+            {
+                struct signalfd_siginfo info;
+                while (read(signal_fd, &info, sizeof(info)) == sizeof(info))
+                {
+                    if (info.ssi_signo == SIGUSR1 || info.ssi_signo == SIGUSR2)
+                    {
+                        int before = service.registers.count;
+                        serviceResize(&service.registers, before + (info.ssi_signo == SIGUSR1 ? 1 : -1));
+                        printf(">>>> Sinal: %d -> %d caixas <<<<\n", before, service.registers.count);
+                        fflush(stdout);
+                    }
+                    else
+                    {
+                        running = 0;
+                    }
+                }
+                continue;
+            }
+            if (ready[e].data.ptr == &timer_tag)
+            {
+                uint64_t expirations;
+                if (read(timer_fd, &expirations, sizeof(expirations)) != sizeof(expirations))
+                {
+                    continue;
+                }
+                int64_t now = monotonicNs();
+                serviceTick(now - last_tick);
+                last_tick = now;
+                if (++ticks % SERVICE_REPORT_TICKS == 0)
+                {
+                    char line[256];
+                    serviceState(line, sizeof(line));
+                    printf("Serviço | %s", line);
+                    fflush(stdout);
+                }
+                continue;
+            }
+            if (ready[e].data.ptr == &listen_tag)
+            {
+                int fd;
+                while ((fd = accept4(listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0)
+                {
+                    control_conn *conn = NULL;
+                    for (int i = 0; i < SERVICE_MAX_CONTROL && conn == NULL; i++)
+                    {
+                        conn = service.control[i].fd < 0 ? &service.control[i] : NULL;
+                    }
+                    if (conn == NULL)
+                    {
+                        close(fd);
+                        continue;
+                    }
+                    conn->fd = fd;
+                    conn->used = 0;
+                    struct epoll_event conn_event = {.events = EPOLLIN | EPOLLRDHUP, .data.ptr = conn};
+                    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &conn_event);
+                }
+                continue;
+            }
 
-            break;
+            control_conn *conn = ready[e].data.ptr;
+            int status = serviceControl(conn);
+            running = status != 1;
+            if (status < 0)
+            {
+                epoll_ctl(epoll_fd, EPOLL_CTL_DEL, conn->fd, NULL);
+                close(conn->fd);
+                conn->fd = -1;
+            }
         }
+    }
+    mallocAccount(mallocs);
 
-        // Se chegamos aqui, há um item para consumir.
-        double sale_value = buffer[out_idx];
-        out_idx = (out_idx + 1) % BUFFER_SIZE;
-        count--;
-        sales_processed++;
-
-        printf("    (C) TID %d | PROCESSOU: R$ %.2f | Buffer: %d/%d\n",
-               tid, sale_value, count, BUFFER_SIZE);
+    // Caixas param primeiro; com o anel fechado, os gerentes esvaziam a fila e terminam.
+    service.registers.minimum = 0;
+    serviceResize(&service.registers, 0);
+    ringClose(ring);
+    for (int i = 0; i < service.managers.count; i++)
+    {
+        pthread_join(service.managers.workers[i].thread, NULL);
+    }
+    double wall = (monotonicNs() - start) / 1e9;
+    int64_t produced = serviceTotal(&service.registers);
+    int64_t consumed = serviceTotal(&service.managers);
 
-        pthread_mutex_unlock(&mutex);
+    printf("Serviço encerrado após %.1f s: %" PRId64 " vendas publicadas, %" PRId64 " processadas (%.0f vendas/s)\n",
+           wall, produced, consumed, wall > 0 ? consumed / wall : 0.0);
+    printf("Escala: até %d caixas e %d gerentes; autoescala acrescentou %" PRId64 " e retirou %" PRId64 " gerentes\n",
+           service.registers.peak, service.managers.peak, service.scale_ups, service.scale_downs);
+    printAllocStats("");
 
-        // Libera um slot vazio para os produtores.
-        sem_post(&empty_slots);
+    for (int i = 0; i < SERVICE_MAX_CONTROL; i++)
+    {
+        if (service.control[i].fd >= 0)
+        {
+            close(service.control[i].fd);
+        }
     }
-
-    printf(">>>> (C) Gerente %d finalizou. Total de vendas processadas: %d <<<<\n", tid, sales_processed);
-    free(c_args);
-    pthread_exit(NULL);
+    arenaDestroy();
+    ringDestroy(ring);
+    close(epoll_fd);
+    close(timer_fd);
+    close(signal_fd);
+    close(listen_fd);
+    if (addr.ss_family == AF_UNIX)
+    {
+        unlink(((struct sockaddr_un *)&addr)->sun_path);
+    }
+    return consumed == produced ? 0 : 1;
 }
 
 /**
- * @fn int main()
- * @brief Ponto de entrada principal do programa.
+ * @fn int runSimulation(void)
+ * @brief Executa a simulação original, com mensagens, usando `config.strategy`.
  *
- * Inicializa os primitivos de sincronização (mutex e semáforos), cria as threads
+ * Inicializa os primitivos de sincronização (mutex e anel de vendas), cria as threads
  * produtoras e consumidoras, e aguarda a conclusão de todas elas usando `pthread_join`.
- * Após o término das threads, destrói os primitivos de sincronização e finaliza o programa.
+ * Após o término das threads, destrói os primitivos de sincronização.
  *
- * @return 0 em caso de sucesso, ou um código de erro em caso de falha.
+ * @return 0 em caso de sucesso, 1 se o anel não puder ser criado.
  */
-int main()
+int runSimulation(void)
 {
     pthread_t producers[NUM_PRODUCERS];
     pthread_t consumers[NUM_CONSUMERS];
 
-    srand(time(NULL));
-
     pthread_mutex_init(&mutex, NULL);
     pthread_cond_init(&buffer_empty_cond, NULL);
 
-    // Inicializa semáforos
-    sem_init(&empty_slots, 0, BUFFER_SIZE); // Começa com N slots vazios
-    sem_init(&full_slots, 0, 0);            // Começa com 0 slots preenchidos
+    // Inicializa as filas e seus semáforos
+    if (salesCreate(config.strategy) != 0 || analyticsCreate(config.window_ns) != 0)
+    {
+        perror("Erro ao alocar as filas de vendas");
+        return 1;
+    }
+    if (config.sink_path != NULL && sinkOpen(config.sink_path) != 0)
+    {
+        perror("Erro ao criar o arquivo colunar");
+        return 1;
+    }
 
     printf("--- Iniciando Simulação com %d Produtores e %d Consumidores ---\n\n",
            NUM_PRODUCERS, NUM_CONSUMERS);
+    replayStart();
+
+    int run_producers = config.role != SHM_MANAGERS;
+    int run_consumers = config.role != SHM_REGISTERS;
+
+    // Os argumentos das threads vêm da arena da execução, liberada de uma vez no fim.
+    if (arenaCreate(NUM_PRODUCERS * sizeof(producer_args) + NUM_CONSUMERS * sizeof(consumer_args) +
+                    (NUM_PRODUCERS + NUM_CONSUMERS) * ARENA_ALIGN) != 0)
+    {
+        perror("Erro ao alocar a arena da execução");
+        return 1;
+    }
 
     // Cria as threads produtoras
-    for (int i = 0; i < NUM_PRODUCERS; i++)
+    for (int i = 0; run_producers && i < NUM_PRODUCERS; i++)
     {
-        producer_args *args = malloc(sizeof(producer_args));
+        producer_args *args = arenaAlloc(sizeof(producer_args));
         args->thread_id = i + 1;
         args->num_sales = (rand() % 6) + 5; // Menos vendas para a simulação ser mais rápida
+        if (replay.count > 0)
+        {
+            args->num_sales = (int)replayCount(i);
+        }
         pthread_create(&producers[i], NULL, producer, (void *)args);
     }
 
     // Cria as threads consumidoras
-    for (int i = 0; i < NUM_CONSUMERS; i++)
+    for (int i = 0; run_consumers && i < NUM_CONSUMERS; i++)
     {
-        consumer_args *args = malloc(sizeof(consumer_args));
+        consumer_args *args = arenaAlloc(sizeof(consumer_args));
         args->thread_id = i + 1;
         pthread_create(&consumers[i], NULL, consumer, (void *)args);
     }
 
     // Espera todas as threads terminarem
-    for (int i = 0; i < NUM_PRODUCERS; i++)
+    for (int i = 0; run_producers && i < NUM_PRODUCERS; i++)
     {
         pthread_join(producers[i], NULL);
     }
 
-    // Após os produtores terminarem, precisamos garantir que os consumidores acordem
-    // caso estejam esperando em sem_wait.
-    for (int i = 0; i < NUM_CONSUMERS; i++)
+    // Sem produtores, fecha as filas: os gerentes esvaziam o que restou e encerram.
+    if (run_producers)
     {
-        sem_post(&full_slots);
+        salesClose();
     }
 
-    for (int i = 0; i < NUM_CONSUMERS; i++)
+    for (int i = 0; run_consumers && i < NUM_CONSUMERS; i++)
     {
         pthread_join(consumers[i], NULL);
     }
 
+    int sink_failed = sinkClose() != 0;
+
     // Destrói os primitivos de sincronização
     pthread_mutex_destroy(&mutex);
     pthread_cond_destroy(&buffer_empty_cond);
-    sem_destroy(&empty_slots);
-    sem_destroy(&full_slots);
+    if (config.overflow != OVERFLOW_BLOCK || config.timeout_ns > 0)
+    {
+        printOverflowStats();
+    }
+    if (config.topology == TOPOLOGY_PRIORITY)
+    {
+        printPriorityStats("");
+    }
+    if (config.topology == TOPOLOGY_SEGMENTS)
+    {
+        printSegmentStats("");
+    }
+    printAllocStats("");
+    arenaDestroy();
+    if (config.window_ns > 0)
+    {
+        printAnalyticsStats();
+    }
+    if (config.sink_path != NULL)
+    {
+        printSinkStats();
+    }
+    analyticsDestroy();
+    salesDestroy();
 
     printf("\n--- Simulação Concluída ---\n");
 
+    return sink_failed;
+}
+
+/**
+ * @fn int parseArguments(int argc, char *argv[])
+ * @brief Lê as opções de linha de comando para `config`.
+ *
+ * - `-w, --espera E`: estratégia de espera (`sem`, `spin`, `futex` ou `eventfd`).
+ * - `-B, --benchmark N`: em vez da simulação, mede o anel com N vendas por produtor,
+ *   com a estratégia de `-w` ou, se ela não for informada, com todas.
+ * - `-g, --pausa-ns NS`: pausa entre vendas de um produtor no benchmark.
+ * - `-t, --topologia T`: `anel` (um anel compartilhado, padrão), `faixas` (uma faixa
+ *   SPSC por caixa), `lojas` (partições por loja com gerente dono), `prioridades` (um
+ *   anel por nível: estornos, valor alto e normal) ou `segmentada` (fila sem limite fixo,
+ *   de segmentos reaproveitados).
+ * - `-o, --transbordo P`: política para fila cheia: `bloquear` (padrão), `descartar-antiga`
+ *   (não disponível com `faixas`, cujo único leitor é o gerente, nem com `segmentada`),
+ *   `descartar-nova` ou `disco`.
+ * - `-f, --arquivo-transbordo ARQ`: arquivo mapeado da política `disco`.
+ * - `-T, --prazo-ms MS`: prazo de cada espera. Um caixa que não consegue posição a tempo
+ *   descarta a venda (política `bloquear`); um gerente sem vendas volta ao transbordo.
+ * - `-j, --janela-ms MS`: liga a análise em janelas de MS milissegundos (média, desvio e
+ *   quantis dos valores), com janelas deslizantes a cada MS / ANALYTICS_SLICES.
+ * - `-P, --pipeline I,V,A,S`: roda o pipeline com I threads de ingestão, V de validação, A
+ *   de agregação e S de persistência (estágios omitidos ficam com 1); `--benchmark` define
+ *   as vendas por thread de ingestão.
+ * - `-s, --saida ARQ`: arquivo da persistência do pipeline.
+ * - `-r, --replay ARQ`: reproduz as vendas gravadas em ARQ (binário de `sale_record`, como a
+ *   saída do pipeline, ou `.csv`) em vez de gerá-las. No benchmark, `--benchmark` passa a
+ *   limitar as vendas reproduzidas por produtor.
+ * - `-x, --velocidade F`: divide os intervalos gravados por F (padrão 1, tempo real); com 0
+ *   as vendas são publicadas sem pausa.
+ * - `-c, --colunar ARQ`: grava as vendas processadas pelos gerentes no arquivo colunar ARQ.
+ *   Não vale com `--pipeline`, cuja persistência grava em `--saida`.
+ * - `-L, --ler-colunar ARQ`: confere e resume o arquivo colunar ARQ e encerra.
+ * - `-u, --sem-uring`: grava o arquivo colunar com uma thread de `pwrite` em vez de io_uring.
+ * - `-m, --memoria NOME`: põe o anel em um objeto de memória compartilhada NOME (como
+ *   `/vendas`), para caixas e gerentes em processos separados. Só com a topologia `anel`,
+ *   sem a política `disco` e sem a estratégia `eventfd`; o benchmark roda só a estratégia
+ *   de `-w`, que vale para os dois processos.
+ * - `-R, --papel P`: com `--memoria`, `caixas` roda só os produtores, `gerentes` só os
+ *   consumidores e `ambos` (padrão) os dois.
+ * - `-S, --servidor END`: roda o servidor de ingestão em END (`unix:CAMINHO`, `tcp:PORTA` ou
+ *   `tcp:IP:PORTA`), que publica no anel as vendas recebidas. Só com a topologia `anel` e
+ *   sem `--memoria`.
+ * - `-C, --cliente END`: roda o cliente de carga contra o servidor em END, com
+ *   `--benchmark` vendas por conexão e `--pausa-ns` entre lotes.
+ * - `-k, --conexoes K`: conexões do cliente (padrão NUM_PRODUCERS); no servidor, encerra
+ *   depois que K clientes se conectaram e desconectaram.
+ * - `-p, --pesos P1,P2,...`: na topologia de faixas, quantas vendas seguidas o gerente lê
+ *   de cada faixa antes de passar à próxima; faixas omitidas ficam com peso 1.
+ * - `-q, --prioridade estrita|E,A,N`: na topologia de prioridades, leitura estrita (padrão)
+ *   ou ponderada, com os pesos dos estornos, do valor alto e do normal.
+ * - `-H, --alto-valor C`: valor em centavos a partir do qual a venda tem prioridade alta
+ *   (padrão PRIORITY_HIGH_CENTS); 0 deixa todas as vendas positivas no nível normal.
+ * - `-M, --limite-memoria MiB`: limite brando de memória da fila segmentada, a partir do
+ *   qual vale a política de fila cheia (padrão: o do diretório, 1 GiB).
+ * - `-D, --servico END`: roda sem fim como serviço, com o socket de controle em END (mesmo
+ *   formato de `--servidor`), pelo qual caixas e gerentes são acrescentados ou retirados
+ *   (ver `runService`). Só com a topologia `anel` e sem `--memoria`; `--pausa-ns` é a pausa
+ *   entre vendas de cada caixa.
+ * - `-a, --autoescala P,L[,G]`: no serviço, acrescenta gerentes, até G (padrão: o número de
+ *   CPUs, no mínimo NUM_CONSUMERS), quando a fila passa de P vendas ou a latência média passa de L microssegundos, e
+ *   os retira quando ficam ociosos.
+ * - `-e, --custo-ns NS`: custo simulado por venda dos gerentes do serviço (padrão
+ *   SERVICE_WORK_NS).
+ *
+ * @return 0 em caso de sucesso, -1 se alguma opção for inválida.
+ */
+int parseArguments(int argc, char *argv[])
+{
+    static const struct option options[] = {
+        {"espera", required_argument, NULL, 'w'},
+        {"benchmark", required_argument, NULL, 'B'},
+        {"pausa-ns", required_argument, NULL, 'g'},
+        {"topologia", required_argument, NULL, 't'},
+        {"pesos", required_argument, NULL, 'p'},
+        {"transbordo", required_argument, NULL, 'o'},
+        {"arquivo-transbordo", required_argument, NULL, 'f'},
+        {"prazo-ms", required_argument, NULL, 'T'},
+        {"janela-ms", required_argument, NULL, 'j'},
+        {"pipeline", required_argument, NULL, 'P'},
+        {"saida", required_argument, NULL, 's'},
+        {"replay", required_argument, NULL, 'r'},
+        {"velocidade", required_argument, NULL, 'x'},
+        {"colunar", required_argument, NULL, 'c'},
+        {"ler-colunar", required_argument, NULL, 'L'},
+        {"sem-uring", no_argument, NULL, 'u'},
+        {"memoria", required_argument, NULL, 'm'},
+        {"papel", required_argument, NULL, 'R'},
+        {"servidor", required_argument, NULL, 'S'},
+        {"cliente", required_argument, NULL, 'C'},
+        {"conexoes", required_argument, NULL, 'k'},
+        {"prioridade", required_argument, NULL, 'q'},
+        {"alto-valor", required_argument, NULL, 'H'},
+        {"limite-memoria", required_argument, NULL, 'M'},
+        {"servico", required_argument, NULL, 'D'},
+        {"autoescala", required_argument, NULL, 'a'},
+        {"custo-ns", required_argument, NULL, 'e'},
+        {NULL, 0, NULL, 0}};
+
+    int opt;
+    while ((opt = getopt_long(argc, argv, "w:B:g:t:p:o:f:T:j:P:s:r:x:c:L:um:R:S:C:k:q:H:M:D:a:e:", options, NULL)) != -1)
+    {
+        switch (opt)
+        {
+        case 'w':
+            config.strategy = NUM_WAIT_STRATEGIES;
+            for (int i = 0; i < NUM_WAIT_STRATEGIES; i++)
+            {
+                if (strcmp(optarg, wait_strategy_names[i]) == 0)
+                {
+                    config.strategy = (wait_strategy)i;
+                }
+            }
+            config.strategy_given = 1;
+            break;
+        case 'B':
+            config.bench_sales = (long long)strtod(optarg, NULL);
+            if (config.bench_sales <= 0)
+            {
+                return -1;
+            }
+            break;
+        case 'g':
+            config.bench_gap_ns = (long long)strtod(optarg, NULL);
+            break;
+        case 't':
+            if (strcmp(optarg, "anel") == 0)
+            {
+                config.topology = TOPOLOGY_RING;
+            }
+            else if (strcmp(optarg, "faixas") == 0)
+            {
+                config.topology = TOPOLOGY_LANES;
+            }
+            else if (strcmp(optarg, "lojas") == 0)
+            {
+                config.topology = TOPOLOGY_SHARDS;
+            }
+            else if (strcmp(optarg, "prioridades") == 0)
+            {
+                config.topology = TOPOLOGY_PRIORITY;
+            }
+            else if (strcmp(optarg, "segmentada") == 0)
+            {
+                config.topology = TOPOLOGY_SEGMENTS;
+            }
+            else
+            {
+                return -1;
+            }
+            break;
+        case 'p':
+        {
+            char *cursor = optarg;
+            for (int i = 0; i < NUM_PRODUCERS && *cursor != '\0'; i++)
+            {
+                char *end;
+                long weight = strtol(cursor, &end, 10);
+                if (end == cursor || weight <= 0 || weight > INT32_MAX)
+                {
+                    return -1;
+                }
+                config.lane_weights[i] = (int)weight;
+                cursor = *end == ',' ? end + 1 : end;
+            }
+            break;
+        }
+        case 'q':
+        {
+            if (strcmp(optarg, "estrita") == 0)
+            {
+                memset(config.priority_weights, 0, sizeof(config.priority_weights));
+                break;
+            }
+            char *cursor = optarg;
+            for (int i = 0; i < NUM_PRIORITIES; i++)
+            {
+                char *end;
+                long weight = strtol(cursor, &end, 10);
+                if (end == cursor || weight <= 0 || weight > INT32_MAX || (i < NUM_PRIORITIES - 1 && *end != ','))
+                {
+                    return -1;
+                }
+                config.priority_weights[i] = (int)weight;
+                cursor = end + 1;
+            }
+            break;
+        }
+        case 'M':
+            config.segment_cap_bytes = (long long)(strtod(optarg, NULL) * (1 << 20));
+            if (config.segment_cap_bytes <= 0)
+            {
+                return -1;
+            }
+            break;
+        case 'D':
+            config.service_address = optarg;
+            break;
+        case 'a':
+        {
+            char *end;
+            config.scale_depth = strtoll(optarg, &end, 10);
+            if (end == optarg || *end != ',' || config.scale_depth <= 0)
+            {
+                return -1;
+            }
+            config.scale_latency_ns = (long long)(strtod(end + 1, &end) * 1000);
+            config.scale_max = *end == ',' ? atoi(end + 1) : 0;
+            if (config.scale_latency_ns <= 0 || config.scale_max < 0 || config.scale_max > SERVICE_MAX_THREADS ||
+                (*end != ',' && *end != '\0'))
+            {
+                return -1;
+            }
+            config.autoscale = 1;
+            break;
+        }
+        case 'e':
+            config.service_work_ns = (long long)strtod(optarg, NULL);
+            if (config.service_work_ns < 0)
+            {
+                return -1;
+            }
+            break;
+        case 'H':
+            config.high_value_cents = strtoll(optarg, NULL, 10);
+            if (config.high_value_cents < 0)
+            {
+                return -1;
+            }
+            break;
+        case 'o':
+            config.overflow = NUM_OVERFLOW_POLICIES;
+            for (int i = 0; i < NUM_OVERFLOW_POLICIES; i++)
+            {
+                if (strcmp(optarg, overflow_policy_names[i]) == 0)
+                {
+                    config.overflow = (overflow_policy)i;
+                }
+            }
+            break;
+        case 'f':
+            config.spill_path = optarg;
+            break;
+        case 'T':
+            config.timeout_ns = (long long)(strtod(optarg, NULL) * 1e6);
+            if (config.timeout_ns <= 0)
+            {
+                return -1;
+            }
+            break;
+        case 'j':
+            config.window_ns = (long long)(strtod(optarg, NULL) * 1e6);
+            if (config.window_ns < ANALYTICS_SLICES)
+            {
+                return -1;
+            }
+            break;
+        case 'P':
+        {
+            char *cursor = optarg;
+            for (int i = 0; i < NUM_PIPELINE_STAGES; i++)
+            {
+                config.pipeline_workers[i] = 1;
+            }
+            for (int i = 0; i < NUM_PIPELINE_STAGES && *cursor != '\0'; i++)
+            {
+                char *end;
+                long workers = strtol(cursor, &end, 10);
+                if (end == cursor || workers <= 0 || workers > 1024)
+                {
+                    return -1;
+                }
+                config.pipeline_workers[i] = (int)workers;
+                cursor = *end == ',' ? end + 1 : end;
+            }
+            break;
+        }
+        case 's':
+            config.output_path = optarg;
+            break;
+        case 'r':
+            config.replay_path = optarg;
+            break;
+        case 'c':
+            config.sink_path = optarg;
+            break;
+        case 'L':
+            config.sink_path = optarg;
+            config.sink_read = 1;
+            break;
+        case 'u':
+            config.sink_pwrite = 1;
+            break;
+        case 'm':
+            config.shm_name = optarg;
+            break;
+        case 'S':
+            config.server_address = optarg;
+            break;
+        case 'C':
+            config.client_address = optarg;
+            break;
+        case 'k':
+            config.connections = atoi(optarg);
+            if (config.connections <= 0)
+            {
+                return -1;
+            }
+            break;
+        case 'R':
+            config.role = NUM_SHM_ROLES;
+            for (int i = 0; i < NUM_SHM_ROLES; i++)
+            {
+                if (strcmp(optarg, shm_role_names[i]) == 0)
+                {
+                    config.role = (shm_role)i;
+                }
+            }
+            break;
+        case 'x':
+            config.replay_speed = strtod(optarg, NULL);
+            if (config.replay_speed < 0)
+            {
+                return -1;
+            }
+            break;
+        default:
+            return -1;
+        }
+    }
+
+    if (config.strategy == NUM_WAIT_STRATEGIES || config.bench_gap_ns < 0 || config.bench_sales > INT32_MAX ||
+        config.overflow == NUM_OVERFLOW_POLICIES ||
+        (config.overflow == OVERFLOW_DROP_OLDEST &&
+         (config.topology == TOPOLOGY_LANES || config.topology == TOPOLOGY_SEGMENTS)) ||
+        config.role == NUM_SHM_ROLES || (config.role != SHM_BOTH && config.shm_name == NULL) ||
+        (config.shm_name != NULL && (config.topology != TOPOLOGY_RING || config.overflow == OVERFLOW_SPILL ||
+                                     config.strategy == WAIT_EVENTFD || config.pipeline_workers[0] > 0)) ||
+        (config.pipeline_workers[0] > 0 && config.sink_path != NULL && !config.sink_read) ||
+        (config.server_address != NULL && (config.topology != TOPOLOGY_RING || config.shm_name != NULL)) ||
+        (config.service_address != NULL &&
+         (config.topology != TOPOLOGY_RING || config.shm_name != NULL || config.server_address != NULL)) ||
+        (config.autoscale && config.service_address == NULL))
+    {
+        return -1;
+    }
+
     return 0;
 }
+
+/**
+ * @fn int main(int argc, char *argv[])
+ * @brief Ponto de entrada principal do programa.
+ *
+ * Lê as opções de linha de comando e executa a simulação ou, com `--benchmark`, uma
+ * rodada de medição por estratégia de espera.
+ *
+ * @return 0 em caso de sucesso, ou um código de erro em caso de falha.
+ */
+int main(int argc, char *argv[])
+{
+    if (parseArguments(argc, argv) != 0)
+    {
+        fprintf(stderr, "Uso: %s [-w sem|spin|futex|eventfd] [-t anel|faixas|lojas|prioridades|segmentada [-p pesos] [-q estrita|E,A,N] [-H centavos] [-M MiB]]\n"
+                        "       [-o bloquear|descartar-antiga|descartar-nova|disco [-f arquivo]] [-T prazo_ms]\n"
+                        "       [-j janela_ms] [-B vendas [-g pausa_ns]] [-P ingestao,validacao,agregacao,persistencia [-s arquivo]]\n"
+                        "       [-r vendas.bin|vendas.csv [-x velocidade]] [-c arquivo.col [-u]] [-L arquivo.col]\n"
+                        "       [-m /nome [-R ambos|caixas|gerentes]] [-S|-C unix:caminho|tcp:[ip:]porta [-k conexoes]]\n"
+                        "       [-D unix:caminho|tcp:[ip:]porta [-a profundidade,latencia_us[,gerentes]] [-e custo_ns]]\n",
+                argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    srand(time(NULL));
+
+    if (config.sink_read)
+    {
+        return sinkRead(config.sink_path);
+    }
+    if (config.replay_path != NULL && replayOpen(config.replay_path) != 0)
+    {
+        fprintf(stderr, "Erro ao ler as vendas gravadas de %s\n", config.replay_path);
+        replayClose();
+        return EXIT_FAILURE;
+    }
+    if (config.client_address != NULL)
+    {
+        return runClient();
+    }
+    if (config.server_address != NULL)
+    {
+        return runServer();
+    }
+    if (config.service_address != NULL)
+    {
+        return runService();
+    }
+    if (config.pipeline_workers[0] > 0)
+    {
+        int status = runPipeline();
+        replayClose();
+        return status;
+    }
+    if (config.bench_sales == 0)
+    {
+        int status = runSimulation();
+        replayClose();
+        return status;
+    }
+
+    if (config.topology == TOPOLOGY_SEGMENTS)
+    {
+        // A fila segmentada não tem BUFFER_SIZE posições: o limite é o de memória (ver segmentsCreate).
+        long long cap_bytes = config.segment_cap_bytes > 0
+                                  ? config.segment_cap_bytes
+                                  : (long long)(SEGMENT_DIRECTORY - 2) * SEGMENT_SLOTS * (long long)sizeof(ring_slot);
+        printf("Benchmark: %d produtores x %lld vendas, %d consumidores, segmentada em segmentos de %d vendas, "
+               "limite de %.1f MiB, pausa de %lld ns\n",
+               NUM_PRODUCERS, config.bench_sales, NUM_CONSUMERS, SEGMENT_SLOTS, cap_bytes / (double)(1 << 20),
+               config.bench_gap_ns);
+    }
+    else
+    {
+        printf("Benchmark: %d produtores x %lld vendas, %d consumidores, %s de %d posições, pausa de %lld ns\n",
+               NUM_PRODUCERS, config.bench_sales, NUM_CONSUMERS,
+               config.topology == TOPOLOGY_LANES      ? "faixas"
+               : config.topology == TOPOLOGY_SHARDS   ? "lojas"
+               : config.topology == TOPOLOGY_PRIORITY ? "prioridades"
+                                                      : "anel",
+               BUFFER_SIZE, config.bench_gap_ns);
+    }
+    if (replay.count > 0)
+    {
+        printf("Reproduzindo %" PRId64 " vendas de %s, velocidade %gx\n", replay.count, config.replay_path,
+               config.replay_speed);
+    }
+    int status = EXIT_SUCCESS;
+    for (int i = 0; i < NUM_WAIT_STRATEGIES; i++)
+    {
+        if ((config.strategy_given || config.shm_name != NULL) && i != (int)config.strategy)
+        {
+            continue;
+        }
+        if (runBenchmark((wait_strategy)i) != 0)
+        {
+            fprintf(stderr, "Falha na rodada da estratégia %s\n", wait_strategy_names[i]);
+            status = EXIT_FAILURE;
+        }
+    }
+    replayClose();
+    return status;
+}